@@ -149,6 +149,7 @@ void board_setDummyFunctions(EvalboardFunctionsTypeDef *channel)
 	channel->checkErrors       = periodicJob;
 	channel->enableDriver      = enableDriver;
 	channel->fwdTmclCommand    = NULL;
+	channel->readRegisters     = NULL;
 
 	channel->fullCover         = NULL;
 	channel->getMin            = dummy_getLimit;
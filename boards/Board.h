@@ -71,6 +71,7 @@ typedef struct
 	uint32_t (*GIO)                 (uint8_t type, uint8_t motor, int32_t *value);
 	void (*readRegister)          (uint8_t motor, uint16_t address, int32_t *value);  // Motor needed since some chips utilize it as a switch between low and high values
 	void (*writeRegister)         (uint8_t motor, uint16_t address, int32_t value);   // Motor needed since some chips utilize it as a switch between low and high values
+	void (*readRegisters)         (uint8_t motor, const uint16_t *addresses, int32_t *values, uint32_t count); // Read several registers in one go (e.g. pipelined SPI). NULL: Use readRegister for each
 	uint32_t (*getMeasuredSpeed)    (uint8_t motor, int32_t *value);
 	uint32_t (*userFunction)        (uint8_t type, uint8_t motor, int32_t *value);
 	bool (*fwdTmclCommand)          (TMCLCommandTypeDef *ActualCommand, TMCLReplyTypeDef *ActualReply);
@@ -41,6 +41,7 @@ static uint32_t getMin(uint8_t type, uint8_t motor, int32_t *value);
 static uint32_t getMax(uint8_t type, uint8_t motor, int32_t *value);
 static void writeRegister(uint8_t motor, uint16_t address, int32_t value);
 static void readRegister(uint8_t motor, uint16_t address, int32_t *value);
+static void readRegisters(uint8_t motor, const uint16_t *addresses, int32_t *values, uint32_t count);
 static void periodicJob(uint32_t tick);
 static uint32_t userFunction(uint8_t type, uint8_t motor, int32_t *value);
 static uint32_t getMeasuredSpeed(uint8_t motor, int32_t *value);
@@ -310,6 +311,61 @@ static uint32_t handleParameter(uint8_t readWrite, uint8_t motor, uint8_t type,
             StepDir_setFrequency(motor, *value);
         }
         break;
+    case 52: // StepDir ramp type: linear (0) / S-curve (1)
+        if(readWrite == READ) {
+            *value = StepDir_getRampType(motor);
+        } else if(readWrite == WRITE) {
+            if (!StepDir_setRampType(motor, *value))
+            {
+                errors |= TMC_ERROR_VALUE;
+            }
+        }
+        break;
+    case 53: // StepDir jerk
+        if(readWrite == READ) {
+            *value = StepDir_getJerk(motor);
+        } else if(readWrite == WRITE) {
+            StepDir_setJerk(motor, *value);
+        }
+        break;
+    case 54: // StepDir interrupt cycles per tick of this channel
+        if(readWrite == READ) {
+            *value = StepDir_getChannelCycles(motor);
+        } else if(readWrite == WRITE) {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 55: // StepDir interrupt cycles per tick
+        if(readWrite == READ) {
+            *value = StepDir_getInterruptCycles();
+        } else if(readWrite == WRITE) {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 56: // StepDir longest interrupt in cycles, write to reset
+        if(readWrite == READ) {
+            *value = StepDir_getInterruptMaxCycles();
+        } else if(readWrite == WRITE) {
+            StepDir_resetInterruptMaxCycles();
+        }
+        break;
+    case 57: // StepDir interrupt load [0.1%]
+        if(readWrite == READ) {
+            *value = StepDir_getInterruptLoad();
+        } else if(readWrite == WRITE) {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 58: // StepDir step output: interrupt (0) / timer (1)
+        if(readWrite == READ) {
+            *value = StepDir_getOutput(motor);
+        } else if(readWrite == WRITE) {
+            if (!StepDir_setOutput(motor, *value))
+            {
+                errors |= TMC_ERROR_VALUE;
+            }
+        }
+        break;
     case 140:
         // Microstep Resolution
         if(readWrite == READ) {
@@ -712,6 +768,27 @@ static void readRegister(uint8_t motor, uint16_t address, int32_t *value)
     *value = tmc2160_readRegister(DEFAULT_ICID, (uint8_t) address);
 }
 
+static void readRegisters(uint8_t motor, const uint16_t *addresses, int32_t *values, uint32_t count)
+{
+    bool pipelined = true;
+
+    // Write-only registers are answered from the shadow registers
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(!TMC_IS_READABLE(tmc2160_registerAccess[addresses[i] & 0x7F]))
+            pipelined = false;
+    }
+
+    if(pipelined)
+    {
+        spi_readIntPipelined(TMC2160_SPIChannel, addresses, values, count);
+        return;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+        readRegister(motor, addresses[i], &values[i]);
+}
+
 static void periodicJob(uint32_t tick)
 {
     static uint32_t old_tick = 0;
@@ -954,6 +1031,7 @@ void TMC2160_init(void)
     Evalboards.ch2.moveBy               = moveBy;
     Evalboards.ch2.writeRegister        = writeRegister;
     Evalboards.ch2.readRegister         = readRegister;
+    Evalboards.ch2.readRegisters        = readRegisters;
     Evalboards.ch2.periodicJob          = periodicJob;
     Evalboards.ch2.userFunction         = userFunction;
     Evalboards.ch2.getMeasuredSpeed     = getMeasuredSpeed;
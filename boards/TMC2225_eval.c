@@ -340,6 +340,82 @@ static uint32_t handleParameter(uint8_t readWrite, uint8_t motor, uint8_t type,
             StepDir_setFrequency(motor, *value);
         }
         break;
+    case 52: // StepDir ramp type: linear (0) / S-curve (1)
+        if (readWrite == READ)
+        {
+            *value = StepDir_getRampType(motor);
+        }
+        else if (readWrite == WRITE)
+        {
+            if (!StepDir_setRampType(motor, *value))
+            {
+                errors |= TMC_ERROR_VALUE;
+            }
+        }
+        break;
+    case 53: // StepDir jerk
+        if (readWrite == READ)
+        {
+            *value = StepDir_getJerk(motor);
+        }
+        else if (readWrite == WRITE)
+        {
+            StepDir_setJerk(motor, *value);
+        }
+        break;
+    case 54: // StepDir interrupt cycles per tick of this channel
+        if (readWrite == READ)
+        {
+            *value = StepDir_getChannelCycles(motor);
+        }
+        else if (readWrite == WRITE)
+        {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 55: // StepDir interrupt cycles per tick
+        if (readWrite == READ)
+        {
+            *value = StepDir_getInterruptCycles();
+        }
+        else if (readWrite == WRITE)
+        {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 56: // StepDir longest interrupt in cycles, write to reset
+        if (readWrite == READ)
+        {
+            *value = StepDir_getInterruptMaxCycles();
+        }
+        else if (readWrite == WRITE)
+        {
+            StepDir_resetInterruptMaxCycles();
+        }
+        break;
+    case 57: // StepDir interrupt load [0.1%]
+        if (readWrite == READ)
+        {
+            *value = StepDir_getInterruptLoad();
+        }
+        else if (readWrite == WRITE)
+        {
+            errors |= TMC_ERROR_TYPE;
+        }
+        break;
+    case 58: // StepDir step output: interrupt (0) / timer (1)
+        if (readWrite == READ)
+        {
+            *value = StepDir_getOutput(motor);
+        }
+        else if (readWrite == WRITE)
+        {
+            if (!StepDir_setOutput(motor, *value))
+            {
+                errors |= TMC_ERROR_VALUE;
+            }
+        }
+        break;
     case 140:
         // Microstep Resolution
         if (readWrite == READ)
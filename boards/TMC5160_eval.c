@@ -70,6 +70,7 @@ static uint32_t moveBy(uint8_t motor, int32_t *ticks);
 static uint32_t GAP(uint8_t type, uint8_t motor, int32_t *value);
 static uint32_t SAP(uint8_t type, uint8_t motor, int32_t value);
 static void readRegister(uint8_t motor, uint16_t address, int32_t *value);
+static void readRegisters(uint8_t motor, const uint16_t *addresses, int32_t *values, uint32_t count);
 static void writeRegister(uint8_t motor, uint16_t address, int32_t value);
 static uint32_t getMeasuredSpeed(uint8_t motor, int32_t *value);
 static void init_comm(TMC5160BusType mode);
@@ -825,6 +826,27 @@ static void readRegister(uint8_t motor, uint16_t address, int32_t *value)
     *value = tmc5160_readRegister(DEFAULT_ICID, address );
 }
 
+static void readRegisters(uint8_t motor, const uint16_t *addresses, int32_t *values, uint32_t count)
+{
+    bool pipelined = (activeBus == IC_BUS_SPI);
+
+    // Write-only registers are answered from the shadow registers
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(!TMC_IS_READABLE(tmc5160_registerAccess[addresses[i] & 0x7F]))
+            pipelined = false;
+    }
+
+    if(pipelined)
+    {
+        spi_readIntPipelined(TMC5160_SPIChannel, addresses, values, count);
+        return;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+        readRegister(motor, addresses[i], &values[i]);
+}
+
 static void periodicJob(uint32_t tick)
 {
     if(TMC5160.config->state != CONFIG_READY)
@@ -1193,6 +1215,7 @@ void TMC5160_init(void)
     Evalboards.ch1.moveBy               = moveBy;
     Evalboards.ch1.writeRegister        = writeRegister;
     Evalboards.ch1.readRegister         = readRegister;
+    Evalboards.ch1.readRegisters        = readRegisters;
     Evalboards.ch1.periodicJob          = periodicJob;
     Evalboards.ch1.userFunction         = userFunction;
     Evalboards.ch1.getMeasuredSpeed     = getMeasuredSpeed;
@@ -10,6 +10,7 @@
 #define ADC_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define N_O_ADC_CHANNELS 7
 
@@ -26,6 +27,12 @@ typedef struct
 	volatile uint16_t *AIN_EXT; // Only LB_V3
 	void (*init)();
 	void (*deInit)();
+	// Timer triggered conversions of a single input (indices as in TMCL GetInput),
+	// written into a circular buffer by DMA. The callback gets called from the DMA
+	// interrupt with the buffer half (0, 1) that has been filled.
+	// NULL if the hardware does not support it.
+	bool (*startCapture)(uint8_t input, uint32_t frequency, volatile uint16_t *buffer, uint32_t count, void (*callback)(uint32_t half));
+	void (*stopCapture)();
 } ADCTypeDef;
 
 extern ADCTypeDef ADCs;
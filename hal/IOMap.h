@@ -16,6 +16,7 @@ typedef struct
 	void (*init) (void);
 
 	IOPinTypeDef **pins; // Map Pin ID <=> Pin
+	uint8_t pinCount;
 
 	IOPinTypeDef ID_CLK;
 	IOPinTypeDef ID_CH0;
@@ -137,6 +137,9 @@ typedef struct
 	IO_States state;
 } IOPinTypeDef;
 
+// Called from the pin interrupt on every edge of the pin
+typedef void (*IOEdgeCallback)(IOPinTypeDef *pin);
+
 typedef struct
 {
 	void (*set)(IOPinTypeDef *pin);
@@ -150,6 +153,7 @@ typedef struct
 	void (*setToState)(IOPinTypeDef *pin, IO_States state);
 	IO_States (*getState)(IOPinTypeDef *pin);
 	unsigned char (*isHigh)(IOPinTypeDef *pin);
+	bool (*setEdgeCallback)(IOPinTypeDef *pin, IOEdgeCallback callback); // NULL callback: Remove it. False if the pin can't get an interrupt
 	void (*init)(void);
 	IOsHighLevelFunctionTypeDef HIGH_LEVEL_FUNCTIONS;
 } IOsTypeDef;
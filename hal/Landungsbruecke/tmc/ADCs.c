@@ -82,7 +82,9 @@ ADCTypeDef ADCs =
 	.DIO5    = &adc0_result[2],
 	.VM      = &adc0_result[0],
 	.init    = init,
-	.deInit  = deInit
+	.deInit  = deInit,
+	.startCapture = NULL, // Not supported
+	.stopCapture  = NULL
 };
 
 static void init(void)
@@ -85,6 +85,7 @@ IOPinMapTypeDef IOMap =
 {
 	.init    = init,
 	.pins    = &_pins[0],
+	.pinCount = sizeof(_pins) / sizeof(_pins[0]),
 	.ID_CLK  =  // IOPinTypeDef ID_CLK
 	{
 		.setBitRegister      = &(GPIOB_PSOR),        // uint32_t *setBitRegister;
@@ -20,6 +20,19 @@ static void setPinLow(IOPinTypeDef *pin);
 static void setPinState(IOPinTypeDef *pin, IO_States state);
 static IO_States getPinState(IOPinTypeDef *pin);
 static uint8_t isPinHigh(IOPinTypeDef *pin);
+static bool setEdgeCallback(IOPinTypeDef *pin, IOEdgeCallback callback);
+
+void __attribute__ ((interrupt)) PORTA_IRQHandler(void);
+void __attribute__ ((interrupt)) PORTB_IRQHandler(void);
+void __attribute__ ((interrupt)) PORTC_IRQHandler(void);
+void __attribute__ ((interrupt)) PORTD_IRQHandler(void);
+void __attribute__ ((interrupt)) PORTE_IRQHandler(void);
+
+// Pins with an edge interrupt
+#define EDGE_PINS 4
+
+static IOPinTypeDef *edgePins[EDGE_PINS];
+static IOEdgeCallback edgeCallbacks[EDGE_PINS];
 
 IOsTypeDef IOs =
 {
@@ -33,7 +46,8 @@ IOsTypeDef IOs =
 	.setLow      = setPinLow,
 	.setToState  = setPinState,
 	.getState    = getPinState,
-	.isHigh      = isPinHigh
+	.isHigh      = isPinHigh,
+	.setEdgeCallback = setEdgeCallback
 };
 
 static void init()
@@ -107,6 +121,9 @@ static void setPinConfiguration(IOPinTypeDef *pin)
 		break;
 	}
 
+	// Keep an edge interrupt configured by setEdgeCallback()
+	config |= PORT_PCR_REG(pin->portBase, pin->bit) & PORT_PCR_IRQC_MASK;
+
 	PORT_PCR_REG(pin->portBase, pin->bit) = config;
 }
 
@@ -231,3 +248,91 @@ static void resetPinConfiguration(IOPinTypeDef *pin)
 	}
 }
 
+static uint8_t portIRQ(PORT_MemMapPtr port)
+{
+	// PORT module registers are 0x1000 apart, starting with PORTA
+	return INT_PORTA + ((uint32_t) port - (uint32_t) PORTA_BASE_PTR) / 0x1000;
+}
+
+static bool setEdgeCallback(IOPinTypeDef *pin, IOEdgeCallback callback)
+{
+	if(IS_DUMMY_PIN(pin))
+		return false;
+
+	// Find the slot of the pin, or a free one
+	int32_t slot = -1;
+	for(uint8_t i = 0; i < EDGE_PINS; i++)
+	{
+		if(edgePins[i] == pin)
+		{
+			slot = i;
+			break;
+		}
+
+		if(!edgePins[i] && slot < 0)
+			slot = i;
+	}
+
+	if(!callback)
+	{
+		if(slot >= 0 && edgePins[slot] == pin)
+		{
+			PORT_PCR_REG(pin->portBase, pin->bit) &= ~(PORT_PCR_IRQC_MASK | PORT_PCR_ISF_MASK);
+			edgeCallbacks[slot]  = NULL;
+			edgePins[slot]       = NULL;
+		}
+		return true;
+	}
+
+	if(slot < 0)
+		return false;
+
+	edgePins[slot]       = pin;
+	edgeCallbacks[slot]  = callback;
+
+	// Interrupt on either edge, clear a stale flag (write 1 to clear)
+	PORT_PCR_REG(pin->portBase, pin->bit) = (PORT_PCR_REG(pin->portBase, pin->bit) & ~PORT_PCR_IRQC_MASK) | PORT_PCR_IRQC(0x0B) | PORT_PCR_ISF_MASK;
+	enable_irq(portIRQ(pin->portBase) - 16);
+
+	return true;
+}
+
+static void handleEdges(PORT_MemMapPtr port)
+{
+	uint32_t flags = PORT_ISFR_REG(port);
+
+	// Write 1 to clear
+	PORT_ISFR_REG(port) = flags;
+
+	for(uint8_t i = 0; i < EDGE_PINS; i++)
+	{
+		if(edgePins[i] && edgePins[i]->portBase == port && (flags & edgePins[i]->bitWeight) && edgeCallbacks[i])
+			edgeCallbacks[i](edgePins[i]);
+	}
+}
+
+void PORTA_IRQHandler(void)
+{
+	handleEdges(PORTA_BASE_PTR);
+}
+
+void PORTB_IRQHandler(void)
+{
+	handleEdges(PORTB_BASE_PTR);
+}
+
+void PORTC_IRQHandler(void)
+{
+	handleEdges(PORTC_BASE_PTR);
+}
+
+void PORTD_IRQHandler(void)
+{
+	handleEdges(PORTD_BASE_PTR);
+}
+
+void PORTE_IRQHandler(void)
+{
+	handleEdges(PORTE_BASE_PTR);
+}
+
@@ -22,6 +22,7 @@ static void txN(uint8_t *str, uint8_t number);
 static uint8_t rxN(uint8_t *ch, uint8_t number);
 static void clearBuffers(void);
 static uint32_t bytesAvailable();
+static uint32_t txSpaceAvailable();
 
 static volatile uint8_t
 	rxBuffer[BUFFER_SIZE],
@@ -39,7 +40,8 @@ RXTXTypeDef RS232 =
 	.txN             = txN,
 	.clearBuffers    = clearBuffers,
 	.baudRate        = 115200,
-	.bytesAvailable  = bytesAvailable
+	.bytesAvailable  = bytesAvailable,
+	.txSpaceAvailable = txSpaceAvailable
 };
 
 static RXTXBufferingTypeDef buffers =
@@ -185,3 +187,9 @@ static uint32_t bytesAvailable()
 	return available;
 }
 
+static uint32_t txSpaceAvailable()
+{
+	// One element stays unused to distinguish a full from an empty ring buffer
+	return (buffers.tx.read - buffers.tx.wrote - 1 + BUFFER_SIZE) % BUFFER_SIZE;
+}
+
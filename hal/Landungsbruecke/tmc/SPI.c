@@ -319,6 +319,32 @@ int32_t spi_readInt(SPIChannelTypeDef *SPIChannel, uint8_t address)
 	return value;
 }
 
+// Read several registers of a TMC chip with pipelined SPI datagrams: The reply
+// to a read datagram holds the value of the previously requested register, so
+// chaining the reads takes count + 1 transfers instead of 2 * count.
+void spi_readIntPipelined(SPIChannelTypeDef *SPIChannel, const uint16_t *addresses, int32_t *values, uint32_t count)
+{
+	uint8_t data[5];
+
+	if(count == 0)
+		return;
+
+	for(uint32_t i = 0; i <= count; i++)
+	{
+		// The final transfer repeats the last address, only its reply is used
+		data[0] = addresses[(i < count) ? i : (count - 1)] & 0x7F;
+		data[1] = 0;
+		data[2] = 0;
+		data[3] = 0;
+		data[4] = 0;
+
+		SPIChannel->readWriteArray(data, 5);
+
+		if(i > 0)
+			values[i-1] = ((uint32_t) data[1] << 24) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 8) | data[4];
+	}
+}
+
 int32_t spi_ch1_readInt(uint8_t address)
 {
 	return spi_readInt(SPIChannel_1_default, address);
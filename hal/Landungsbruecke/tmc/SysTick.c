@@ -38,6 +38,23 @@ uint32_t systick_getMicrosecondTick()
 	return DWT_CYCCNT / 48;
 }
 
+// Raw CYCCNT value. Unlike the µs counter, differences of this counter stay
+// valid across the counter overflow.
+uint32_t systick_getCycleTick()
+{
+	return DWT_CYCCNT;
+}
+
+uint32_t systick_cyclesToMicroseconds(uint32_t cycles)
+{
+	return cycles / 48;
+}
+
+uint32_t systick_getCycleFrequency()
+{
+	return 48000000;
+}
+
 /* Systick values are in milliseconds, accessing the value is faster. As a result
  * we have a random invisible delay of less than a millisecond whenever we use
  * systicks. This can result in a situation where we access the systick just before it changes:
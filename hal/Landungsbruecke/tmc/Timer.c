@@ -47,7 +47,10 @@ TimerTypeDef Timer =
 	.setFrequency = setFrequency,
 	.setFrequencyMin = setFrequencyMin,
 	.overflow_callback = NULL,
-	.setTimerAdcTrigger = setTimerAdcTrigger
+	.setTimerAdcTrigger = setTimerAdcTrigger,
+	.startStepOutput = NULL, // Not supported
+	.stopStepOutput  = NULL,
+	.fillStepSegment = NULL
 };
 
 static void init(void)
@@ -80,6 +80,9 @@ void tx(uint8_t ch)
 	CDC1_SendChar(ch);
 }
 
+// Once the transmit buffer is full, CDC1_SendChar() sends it and waits for the
+// transfer to finish. txN() therefore never drops data and the interface needs
+// no txSpaceAvailable().
 void txN(uint8_t *str, uint8_t number)
 {
 	for(int32_t i = 0; i < number; i++)
@@ -29,6 +29,7 @@ static void txN(uint8_t *str, uint8_t number);
 static uint8_t rxN(uint8_t *ch, uint8_t number);
 static void clearBuffers(void);
 static uint32_t bytesAvailable();
+static uint32_t txSpaceAvailable();
 
 // ring buffers (used in BufferingTypedef struct)
 static volatile uint8_t rxBuffer[BUFFER_SIZE];
@@ -54,7 +55,8 @@ RXTXTypeDef WLAN =
 	.txN             = txN,
 	.clearBuffers    = clearBuffers,
 	.baudRate        = 57600,
-	.bytesAvailable  = bytesAvailable
+	.bytesAvailable  = bytesAvailable,
+	.txSpaceAvailable = txSpaceAvailable
 
 };
 
@@ -229,6 +231,12 @@ static uint32_t bytesAvailable()
 	return available;
 }
 
+static uint32_t txSpaceAvailable()
+{
+	// One element stays unused to distinguish a full from an empty ring buffer
+	return (buffers.tx.read - buffers.tx.wrote - 1 + BUFFER_SIZE) % BUFFER_SIZE;
+}
+
 uint32_t checkReadyToSend()
 {
 	if(checkCmdModeEnabled())
@@ -9,8 +9,15 @@
 
 #define ADC1_DR_ADDRESS  ((uint32_t)0x4001204C)
 
+#define CAPTURE_TIMER_CLOCK    240000000
+#define CAPTURE_MAX_FREQUENCY  1000000
+
 static void init(void);
 static void deInit(void);
+static bool startCapture(uint8_t input, uint32_t frequency, volatile uint16_t *buffer, uint32_t count, void (*callback)(uint32_t half));
+static void stopCapture(void);
+
+static void (*captureCallback)(uint32_t half) = NULL;
 
 ADCTypeDef ADCs =
 {
@@ -23,6 +30,8 @@ ADCTypeDef ADCs =
 	.AIN_EXT = &ADCValue[6],
 	.init    = init,
 	.deInit  = deInit,
+	.startCapture = startCapture,
+	.stopCapture  = stopCapture,
 };
 
 void init(void)
@@ -90,3 +99,123 @@ static void deInit(void)
 {
 	adc_deinit();
 }
+
+/*
+ * Capture a single input at a fixed rate. ADC0 keeps scanning all inputs for
+ * ADCValue, the capture uses ADC1, triggered by TIMER7 and transferred by
+ * DMA1 channel 2.
+ */
+static bool startCapture(uint8_t input, uint32_t frequency, volatile uint16_t *buffer, uint32_t count, void (*callback)(uint32_t half))
+{
+	uint8_t adcChannel;
+
+	// Use same indices as in TMCL.c GetInput()
+	switch(input)
+	{
+	case 0: adcChannel = ADC_CHANNEL_14; break; // AIN0
+	case 1: adcChannel = ADC_CHANNEL_15; break; // AIN1
+	case 2: adcChannel = ADC_CHANNEL_8;  break; // AIN2
+	case 3: adcChannel = ADC_CHANNEL_0;  break; // DIO4
+	case 4: adcChannel = ADC_CHANNEL_1;  break; // DIO5
+	case 6: adcChannel = ADC_CHANNEL_3;  break; // VM
+	default:
+		return false;
+	}
+
+	if(frequency == 0 || frequency > CAPTURE_MAX_FREQUENCY)
+		return false;
+
+	if(count == 0 || count > 0xFFFF)
+		return false;
+
+	stopCapture();
+	captureCallback = callback;
+
+	rcu_periph_clock_enable(RCU_ADC1);
+	rcu_periph_clock_enable(RCU_TIMER7);
+
+	// DMA: ADC1 -> buffer, circular, interrupts on both buffer halves
+	dma_deinit(DMA1, DMA_CH2);
+
+	dma_single_data_parameter_struct dma_init_struct;
+	dma_single_data_para_struct_init(&dma_init_struct);
+	dma_init_struct.periph_addr = (uint32_t) (ADC1 + 0x4CU);
+	dma_init_struct.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+	dma_init_struct.memory0_addr = (uint32_t) buffer;
+	dma_init_struct.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+	dma_init_struct.periph_memory_width = DMA_PERIPH_WIDTH_16BIT;
+	dma_init_struct.circular_mode = DMA_CIRCULAR_MODE_ENABLE;
+	dma_init_struct.direction = DMA_PERIPH_TO_MEMORY;
+	dma_init_struct.number = count;
+	dma_init_struct.priority = DMA_PRIORITY_ULTRA_HIGH;
+	dma_single_data_mode_init(DMA1, DMA_CH2, &dma_init_struct);
+	dma_channel_subperipheral_select(DMA1, DMA_CH2, DMA_SUBPERI1);
+
+	dma_interrupt_flag_clear(DMA1, DMA_CH2, DMA_INT_FLAG_HTF | DMA_INT_FLAG_FTF);
+	dma_interrupt_enable(DMA1, DMA_CH2, DMA_CHXCTL_HTFIE | DMA_CHXCTL_FTFIE);
+	nvic_irq_enable(DMA1_Channel2_IRQn, 1, 0);
+
+	dma_channel_enable(DMA1, DMA_CH2);
+
+	// ADC1: One conversion per timer update event
+	adc_resolution_config(ADC1, ADC_RESOLUTION_12B);
+	adc_special_function_config(ADC1, ADC_SCAN_MODE, DISABLE);
+	adc_special_function_config(ADC1, ADC_CONTINUOUS_MODE, DISABLE);
+	adc_data_alignment_config(ADC1, ADC_DATAALIGN_RIGHT);
+	adc_channel_length_config(ADC1, ADC_ROUTINE_CHANNEL, 1);
+	adc_routine_channel_config(ADC1, 0, adcChannel, ADC_SAMPLETIME_15);
+	adc_external_trigger_source_config(ADC1, ADC_ROUTINE_CHANNEL, ADC_EXTTRIG_ROUTINE_T7_TRGO);
+	adc_external_trigger_config(ADC1, ADC_ROUTINE_CHANNEL, EXTERNAL_TRIGGER_RISING);
+	adc_dma_request_after_last_enable(ADC1);
+	adc_dma_mode_enable(ADC1);
+
+	adc_enable(ADC1);
+	adc_calibration_enable(ADC1);
+
+	// TIMER7: Update event at the sampling frequency
+	uint32_t ticks = CAPTURE_TIMER_CLOCK / frequency;
+	uint32_t prescaler = ticks / 0x10000;
+
+	timer_deinit(TIMER7);
+
+	timer_parameter_struct params;
+	timer_struct_para_init(&params);
+	params.prescaler = prescaler;
+	params.alignedmode = TIMER_COUNTER_EDGE;
+	params.counterdirection = TIMER_COUNTER_UP;
+	params.period = ticks / (prescaler + 1) - 1;
+	params.clockdivision = TIMER_CKDIV_DIV1;
+	params.repetitioncounter = 0;
+	timer_init(TIMER7, &params);
+
+	timer_master_output_trigger_source_select(TIMER7, TIMER_TRI_OUT_SRC_UPDATE);
+	timer_enable(TIMER7);
+
+	return true;
+}
+
+static void stopCapture(void)
+{
+	timer_disable(TIMER7);
+	dma_channel_disable(DMA1, DMA_CH2);
+	adc_disable(ADC1);
+
+	captureCallback = NULL;
+}
+
+void DMA1_Channel2_IRQHandler(void)
+{
+	if(dma_interrupt_flag_get(DMA1, DMA_CH2, DMA_INT_FLAG_HTF) == SET)
+	{
+		dma_interrupt_flag_clear(DMA1, DMA_CH2, DMA_INT_FLAG_HTF);
+		if(captureCallback)
+			captureCallback(0);
+	}
+
+	if(dma_interrupt_flag_get(DMA1, DMA_CH2, DMA_INT_FLAG_FTF) == SET)
+	{
+		dma_interrupt_flag_clear(DMA1, DMA_CH2, DMA_INT_FLAG_FTF);
+		if(captureCallback)
+			captureCallback(1);
+	}
+}
@@ -80,6 +80,7 @@ IOPinMapTypeDef IOMap =
 {
 	.init   = init,
 	.pins   = &_pins[0],
+	.pinCount = sizeof(_pins) / sizeof(_pins[0]),
 	.ID_CLK =  // IOPinTypeDef ID_CLK
 	{
 		.setBitRegister      = &(GPIO_BOP(GPIOC)),  // __IO uint16_t *setBitRegister
@@ -17,6 +17,21 @@ static void setPinLow(IOPinTypeDef *pin);
 static void setPinState(IOPinTypeDef *pin, IO_States state);
 static IO_States getPinState(IOPinTypeDef *pin);
 static unsigned char isPinHigh(IOPinTypeDef *pin);
+static bool setEdgeCallback(IOPinTypeDef *pin, IOEdgeCallback callback);
+
+void __attribute__ ((interrupt)) EXTI0_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI1_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI2_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI3_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI4_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI5_9_IRQHandler(void);
+void __attribute__ ((interrupt)) EXTI10_15_IRQHandler(void);
+
+// Each EXTI line serves the pin with its number on one of the GPIO ports
+#define EXTI_LINES 16
+
+static IOPinTypeDef *edgePins[EXTI_LINES];
+static IOEdgeCallback edgeCallbacks[EXTI_LINES];
 
 IOsTypeDef IOs =
 {
@@ -31,6 +46,7 @@ IOsTypeDef IOs =
 	.setToState            = setPinState,
 	.getState              = getPinState,
 	.isHigh                = isPinHigh,
+	.setEdgeCallback       = setEdgeCallback,
 	.HIGH_LEVEL_FUNCTIONS  =
 	{
 		.DEFAULT  = IO_DEFAULT,
@@ -169,3 +185,99 @@ static void resetPinConfiguration(IOPinTypeDef *pin)
 	pin->highLevelFunction  = IOs.HIGH_LEVEL_FUNCTIONS.DEFAULT;
 }
 
+static uint8_t extiIRQ(uint8_t line)
+{
+	if(line < 5)
+		return EXTI0_IRQn + line;
+
+	return (line < 10) ? EXTI5_9_IRQn : EXTI10_15_IRQn;
+}
+
+static bool setEdgeCallback(IOPinTypeDef *pin, IOEdgeCallback callback)
+{
+	if(IS_DUMMY_PIN(pin))
+		return false;
+
+	uint8_t line = pin->bit;
+	exti_line_enum extiLine = (exti_line_enum) BIT(line);
+
+	if(!callback)
+	{
+		// Only remove the interrupt of this pin, the line may serve another port
+		if(edgePins[line] == pin)
+		{
+			exti_interrupt_disable(extiLine);
+			edgeCallbacks[line]  = NULL;
+			edgePins[line]       = NULL;
+		}
+		return true;
+	}
+
+	// The line is in use by the same pin number of another port
+	if(edgePins[line] && edgePins[line] != pin)
+		return false;
+
+	exti_interrupt_disable(extiLine);
+	edgePins[line]       = pin;
+	edgeCallbacks[line]  = callback;
+
+	// GPIO port registers are 0x400 apart, starting with GPIOA
+	syscfg_exti_line_config(EXTI_SOURCE_GPIOA + (pin->port - GPIOA) / 0x400, EXTI_SOURCE_PIN0 + line);
+	exti_init(extiLine, EXTI_INTERRUPT, EXTI_TRIG_BOTH);
+	exti_interrupt_flag_clear(extiLine);
+	nvic_irq_enable(extiIRQ(line), 2, 0);
+
+	return true;
+}
+
+static void handleEdges(uint8_t first, uint8_t last)
+{
+	for(uint8_t line = first; line <= last; line++)
+	{
+		exti_line_enum extiLine = (exti_line_enum) BIT(line);
+
+		if(exti_interrupt_flag_get(extiLine) == RESET)
+			continue;
+
+		exti_interrupt_flag_clear(extiLine);
+
+		if(edgeCallbacks[line])
+			edgeCallbacks[line](edgePins[line]);
+	}
+}
+
+void EXTI0_IRQHandler(void)
+{
+	handleEdges(0, 0);
+}
+
+void EXTI1_IRQHandler(void)
+{
+	handleEdges(1, 1);
+}
+
+void EXTI2_IRQHandler(void)
+{
+	handleEdges(2, 2);
+}
+
+void EXTI3_IRQHandler(void)
+{
+	handleEdges(3, 3);
+}
+
+void EXTI4_IRQHandler(void)
+{
+	handleEdges(4, 4);
+}
+
+void EXTI5_9_IRQHandler(void)
+{
+	handleEdges(5, 9);
+}
+
+void EXTI10_15_IRQHandler(void)
+{
+	handleEdges(10, 15);
+}
+
@@ -41,6 +41,23 @@ uint32_t systick_getMicrosecondTick()
     return DWT->CYCCNT / 240;
 }
 
+// Raw CYCCNT value. Unlike the µs counter, differences of this counter stay
+// valid across the counter overflow.
+uint32_t systick_getCycleTick()
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t systick_cyclesToMicroseconds(uint32_t cycles)
+{
+    return cycles / 240;
+}
+
+uint32_t systick_getCycleFrequency()
+{
+    return 240000000;
+}
+
 void wait(uint32_t delay)	// wait for [delay] ms/systicks
 {
 	uint32_t startTick = systick;
@@ -14,6 +14,8 @@ TIMER_CHANNEL_2 = TIMER 3 Channel 0, RAMDebug
 TIMER_CHANNEL_3 = TIMER 4 Channel 0
 TIMER_CHANNEL_4 = TIMER 0 Channel 1, PWM output DIO9
 TIMER_CHANNEL_5 = TIMER 0 Channel 0, PWM output DIO7
+
+Hardware step output: TIMER 0 Channel 0 complementary output DIO6, DMA1 Channel 5
 */
 static uint32_t timerBaseClk;
 
@@ -32,6 +34,17 @@ static void setFrequencyMin(timer_channel channel, float freq_min);
  */
 static void setTimerAdcTrigger(timer_channel channel);
 
+static bool startStepOutput(IOPinTypeDef *stepPin, volatile StepSegmentTypeDef *segments, uint32_t count, void (*callback)(uint32_t half));
+static void stopStepOutput(void);
+static uint32_t fillStepSegment(volatile StepSegmentTypeDef *segment, uint32_t steps, uint32_t frequency);
+
+#define STEP_TIMER_CLOCK     240000000  // TIMER0 clock
+#define STEP_PULSE_WIDTH     240        // Step pulse width in timer clocks (1µs)
+#define STEP_MAX_PERIODS     256        // 8 bit repetition counter
+
+static IOPinTypeDef *stepOutputPin = NULL;
+static void (*stepCallback)(uint32_t half) = NULL;
+
 static uint16_t period_min_buf[] = { 0, 0, 0 };
 static float freq_min_buf[] = { 0.0f, 0.0f, 0.0f };
 
@@ -48,7 +61,10 @@ TimerTypeDef Timer =
 	.setFrequency = setFrequency,
 	.setFrequencyMin = setFrequencyMin,
 	.overflow_callback = NULL,
-    .setTimerAdcTrigger = setTimerAdcTrigger
+    .setTimerAdcTrigger = setTimerAdcTrigger,
+	.startStepOutput = startStepOutput,
+	.stopStepOutput  = stopStepOutput,
+	.fillStepSegment = fillStepSegment
 };
 
 static void init(void)
@@ -334,6 +350,162 @@ static void setTimerAdcTrigger(timer_channel channel)
     }
 }
 
+/*
+ * Hardware step pulse train on DIO6 (TIMER0 CH0_ON)
+ *
+ * TIMER0 runs in PWM mode and plays one segment per repetition cycle: (repetition + 1)
+ * periods with a step pulse at the start of each. On every update event, DMA1 channel 5
+ * writes the next segment into PSC, CAR, CREP and CH0CV with a DMA burst. The timer
+ * loads these at the following update event, so a segment starts playing one segment
+ * after it has been read.
+ *
+ * The pulse train changes prescaler and period of TIMER0, which the PWM outputs on
+ * DIO7 to DIO11 share. It can't be started while one of them is routed to the timer.
+ */
+static bool startStepOutput(IOPinTypeDef *stepPin, volatile StepSegmentTypeDef *segments, uint32_t count, void (*callback)(uint32_t half))
+{
+	if(stepPin != &HAL.IOs->pins->DIO6)
+		return false;
+
+	// Both buffer halves need at least two segments
+	if(count < 4 || count % 2 || count * 4 > 0xFFFF)
+		return false;
+
+	// TIMER0 PWM outputs in use?
+	for(uint8_t pin = 9; pin <= 13; pin++)
+	{
+		if((GPIO_CTL(GPIOE) & GPIO_MODE_MASK(pin)) == GPIO_MODE_SET(pin, GPIO_MODE_AF))
+			return false;
+	}
+
+	stopStepOutput();
+	stepCallback = callback;
+
+	rcu_periph_clock_enable(RCU_DMA1);
+	rcu_periph_clock_enable(RCU_TIMER0);
+
+	// DMA: buffer -> TIMER0 DMA burst register, circular, interrupts on both buffer halves
+	dma_deinit(DMA1, DMA_CH5);
+
+	dma_single_data_parameter_struct dma_init_struct;
+	dma_single_data_para_struct_init(&dma_init_struct);
+	dma_init_struct.periph_addr = (uint32_t) &TIMER_DMATB(TIMER0);
+	dma_init_struct.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+	dma_init_struct.memory0_addr = (uint32_t) segments;
+	dma_init_struct.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+	dma_init_struct.periph_memory_width = DMA_PERIPH_WIDTH_32BIT;
+	dma_init_struct.circular_mode = DMA_CIRCULAR_MODE_ENABLE;
+	dma_init_struct.direction = DMA_MEMORY_TO_PERIPH;
+	dma_init_struct.number = count * 4;
+	dma_init_struct.priority = DMA_PRIORITY_ULTRA_HIGH;
+	dma_single_data_mode_init(DMA1, DMA_CH5, &dma_init_struct);
+	dma_channel_subperipheral_select(DMA1, DMA_CH5, DMA_SUBPERI6);
+
+	dma_interrupt_flag_clear(DMA1, DMA_CH5, DMA_INT_FLAG_HTF | DMA_INT_FLAG_FTF);
+	dma_interrupt_enable(DMA1, DMA_CH5, DMA_CHXCTL_HTFIE | DMA_CHXCTL_FTFIE);
+	// Below the StepDir interrupt (TIMER2): Refilling half of the buffer must not delay its ticks
+	nvic_irq_enable(DMA1_Channel5_IRQn, 2, 0);
+
+	// TIMER0: Start with a short pause, the DMA delivers the first segment meanwhile
+	timer_disable(TIMER0);
+	timer_prescaler_config(TIMER0, 0, TIMER_PSC_RELOAD_UPDATE);
+	timer_autoreload_value_config(TIMER0, STEP_PULSE_WIDTH);
+	timer_repetition_value_config(TIMER0, 0);
+	timer_channel_output_pulse_value_config(TIMER0, TIMER_CH_0, 0);
+	timer_channel_output_mode_config(TIMER0, TIMER_CH_0, TIMER_OC_MODE_PWM0);
+	timer_channel_output_shadow_config(TIMER0, TIMER_CH_0, TIMER_OC_SHADOW_ENABLE);
+	timer_channel_output_state_config(TIMER0, TIMER_CH_0, TIMER_CCX_DISABLE);
+	timer_channel_complementary_output_polarity_config(TIMER0, TIMER_CH_0, TIMER_OCN_POLARITY_HIGH);
+	timer_channel_complementary_output_state_config(TIMER0, TIMER_CH_0, TIMER_CCXN_ENABLE);
+	timer_auto_reload_shadow_enable(TIMER0);
+	timer_primary_output_config(TIMER0, ENABLE);
+	timer_counter_value_config(TIMER0, 0);
+	timer_event_software_generate(TIMER0, TIMER_EVENT_SRC_UPG);
+	timer_flag_clear(TIMER0, TIMER_FLAG_UP);
+
+	timer_dma_transfer_config(TIMER0, TIMER_DMACFG_DMATA_PSC, TIMER_DMACFG_DMATC_4TRANSFER);
+	timer_dma_enable(TIMER0, TIMER_DMA_UPD);
+	dma_channel_enable(DMA1, DMA_CH5);
+
+	// Hand the pin over to the timer
+	stepOutputPin = stepPin;
+	HAL.IOs->config->setLow(stepPin);
+	gpio_af_set(stepPin->port, GPIO_AF_1, stepPin->bitWeight);
+	gpio_output_options_set(stepPin->port, GPIO_OTYPE_PP, GPIO_OSPEED_MAX, stepPin->bitWeight);
+	gpio_mode_set(stepPin->port, GPIO_MODE_AF, GPIO_PUPD_NONE, stepPin->bitWeight);
+
+	timer_enable(TIMER0);
+
+	return true;
+}
+
+static void stopStepOutput(void)
+{
+	if(!stepOutputPin)
+		return;
+
+	timer_dma_disable(TIMER0, TIMER_DMA_UPD);
+	dma_channel_disable(DMA1, DMA_CH5);
+	dma_interrupt_disable(DMA1, DMA_CH5, DMA_CHXCTL_HTFIE | DMA_CHXCTL_FTFIE);
+	stepCallback = NULL;
+
+	// Return the pin to the GPIO
+	HAL.IOs->config->toOutput(stepOutputPin);
+	HAL.IOs->config->setLow(stepOutputPin);
+	stepOutputPin = NULL;
+
+	// Restore the TIMER0 configuration of init()
+	timer_disable(TIMER0);
+	timer_channel_complementary_output_state_config(TIMER0, TIMER_CH_0, TIMER_CCXN_DISABLE);
+	timer_channel_output_state_config(TIMER0, TIMER_CH_0, TIMER_CCX_ENABLE);
+	timer_channel_output_shadow_config(TIMER0, TIMER_CH_0, TIMER_OC_SHADOW_DISABLE);
+	timer_channel_output_pulse_value_config(TIMER0, TIMER_CH_0, TIMER_MAX >> 1);
+	timer_prescaler_config(TIMER0, 0, TIMER_PSC_RELOAD_NOW);
+	timer_autoreload_value_config(TIMER0, TIMER_MAX);
+	timer_repetition_value_config(TIMER0, 0);
+	timer_event_software_generate(TIMER0, TIMER_EVENT_SRC_UPG);
+
+	if(Timer.initialized)
+		timer_enable(TIMER0);
+}
+
+static uint32_t fillStepSegment(volatile StepSegmentTypeDef *segment, uint32_t steps, uint32_t frequency)
+{
+	steps = MIN(steps, STEP_MAX_PERIODS);
+
+	// Without steps, the segment is a single pause period
+	uint32_t periods = MAX(steps, 1);
+	uint32_t cycles = (STEP_TIMER_CLOCK / frequency) / periods;
+
+	// Divide the timer clock down until the period fits into the 16 bit counter
+	uint32_t prescaler = (cycles - 1) >> 16;
+	uint32_t period = cycles / (prescaler + 1);
+
+	segment->prescaler  = prescaler;
+	segment->period     = period - 1;
+	segment->repetition = periods - 1;
+	segment->pulse      = (steps == 0) ? 0 : MAX(MIN(STEP_PULSE_WIDTH / (prescaler + 1), period / 2), 1);
+
+	return steps;
+}
+
+void DMA1_Channel5_IRQHandler(void)
+{
+	if(dma_interrupt_flag_get(DMA1, DMA_CH5, DMA_INT_FLAG_HTF) == SET)
+	{
+		dma_interrupt_flag_clear(DMA1, DMA_CH5, DMA_INT_FLAG_HTF);
+		if(stepCallback)
+			stepCallback(0);
+	}
+
+	if(dma_interrupt_flag_get(DMA1, DMA_CH5, DMA_INT_FLAG_FTF) == SET)
+	{
+		dma_interrupt_flag_clear(DMA1, DMA_CH5, DMA_INT_FLAG_FTF);
+		if(stepCallback)
+			stepCallback(1);
+	}
+}
+
 void TIMER3_IRQHandler(void)
 
 {
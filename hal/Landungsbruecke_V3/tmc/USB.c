@@ -10,9 +10,10 @@
 #include "hal/HAL.h"
 
 #define BUFFER_SIZE 2048 // KEEP THIS SIZE AS IT MATCHES BUFFERSIZE OF usbd_cdc_core.c
+#define TX_BUFFER_SIZE 1024 // Transmit data waiting for the IN endpoint
 
 // Specific functions
-static void USBSendData(uint8_t *Buffer, uint32_t Size);
+static void USBSendData(void);
 static uint32_t USBGetData(uint8_t *Buffer, size_t amount);
 static void InitUSB(void);
 static void DetachUSB(void);
@@ -26,11 +27,24 @@ static void txN(uint8_t *str, unsigned char number);
 static uint8_t rxN(uint8_t *str, unsigned char number);
 static void clearBuffers(void);
 static uint32_t bytesAvailable(void);
+static uint32_t txSpaceAvailable(void);
 
 static usb_core_driver cdc_acm;
-static uint8_t USBDataTxBuffer[256];
+static uint8_t USBDataTxBuffer[256]; // Data of the running IN transfer
 static volatile uint32_t available = 0;
 
+// txN() only queues the data, the IN transfers take it from here one after
+// another. Starting a transfer while the previous one is still running would
+// overwrite USBDataTxBuffer.
+static volatile uint8_t txBuffer[TX_BUFFER_SIZE];
+
+static BufferingTypeDef txBuffering =
+{
+	.read    = 0,
+	.wrote   = 0,
+	.buffer  = txBuffer
+};
+
 RXTXTypeDef USB =
 {
 	.init            = init,
@@ -41,7 +55,8 @@ RXTXTypeDef USB =
 	.txN             = txN,
 	.clearBuffers    = clearBuffers,
 	.baudRate        = 115200,
-	.bytesAvailable  = bytesAvailable
+	.bytesAvailable  = bytesAvailable,
+	.txSpaceAvailable = txSpaceAvailable
 };
 
 void usb_timer_irq (void);
@@ -54,6 +69,9 @@ void TIMER6_IRQHandler(void)
 void USBFS_IRQHandler(void)
 {
     usbd_isr(&cdc_acm);
+
+    // Continue with the queued data once the IN transfer is done
+    USBSendData();
 }
 
 static void InitUSB(void)
@@ -72,20 +90,33 @@ static void DetachUSB(void)
 
 /*******************************************************************
    Funktion: USBSendData()
-   Parameter: Buffer: Array mit den zu sendenden Daten
-              Size: Anzahl der zu sendenden Bytes
+   Parameter: ---
 
    R�ckgabewert:  ---
 
-   Zweck: Senden von Daten �ber USB.
+   Zweck: Startet die Uebertragung der gepufferten Daten, sobald der
+          IN-Endpunkt frei ist. Aufruf durch txN() und den USB-Interrupt.
 ********************************************************************/
-static void USBSendData(uint8_t *Buffer, uint32_t Size)
+static void USBSendData(void)
 {
-	uint32_t i;
-	
-	for(i=0; i<Size; i++) USBDataTxBuffer[i]=Buffer[i];
-	
-	usbd_ep_send((usb_dev *) &cdc_acm, CDC_DATA_IN_EP, USBDataTxBuffer, Size);
+	uint32_t size = 0;
+
+	if(USBD_CONFIGURED != cdc_acm.dev.cur_status)
+		return;
+
+	// packet_sent: The IN endpoint has finished the previous transfer (including a zero length packet)
+	usb_cdc_handler *cdc = (usb_cdc_handler *) (&cdc_acm)->dev.class_data[CDC_COM_INTERFACE];
+	if(!cdc->packet_sent || txBuffering.read == txBuffering.wrote)
+		return;
+
+	while(txBuffering.read != txBuffering.wrote && size < sizeof(USBDataTxBuffer))
+	{
+		USBDataTxBuffer[size++] = txBuffering.buffer[txBuffering.read];
+		txBuffering.read = (txBuffering.read + 1) % TX_BUFFER_SIZE;
+	}
+
+	cdc->packet_sent = 0U;
+	usbd_ep_send((usb_dev *) &cdc_acm, CDC_DATA_IN_EP, USBDataTxBuffer, size);
 }
 
 
@@ -140,7 +171,21 @@ static uint8_t rx(uint8_t *ch)
 
 static void txN(uint8_t *str, unsigned char number)
 {
-	USBSendData(str, number);
+	// Without a host the data would only pile up
+	if(USBD_CONFIGURED != cdc_acm.dev.cur_status)
+		return;
+
+	// Callers check txSpaceAvailable() first - data beyond the free space is lost
+	for(uint32_t i = 0; i < number && txSpaceAvailable() > 0; i++)
+	{
+		txBuffering.buffer[txBuffering.wrote] = str[i];
+		txBuffering.wrote = (txBuffering.wrote + 1) % TX_BUFFER_SIZE;
+	}
+
+	// The USB interrupt starts transfers as well
+	__disable_irq();
+	USBSendData();
+	__enable_irq();
 }
 
 static uint8_t rxN(uint8_t *str, unsigned char number)
@@ -155,9 +200,10 @@ static void clearBuffers(void)
 	// buffers.rx.read   = 0;
 	// buffers.rx.wrote  = 0;
 
-	// buffers.tx.read   = 0;
-	// buffers.tx.wrote  = 0;
-	// __enable_irq();
+	__disable_irq();
+	txBuffering.read   = 0;
+	txBuffering.wrote  = 0;
+	__enable_irq();
 }
 
 static uint32_t bytesAvailable(void)
@@ -167,6 +213,16 @@ static uint32_t bytesAvailable(void)
 	return cdc->receive_length;
 }
 
+static uint32_t txSpaceAvailable(void)
+{
+	// Nothing gets queued without a host, see txN()
+	if(USBD_CONFIGURED != cdc_acm.dev.cur_status)
+		return TX_BUFFER_SIZE - 1;
+
+	// One element stays unused to distinguish a full from an empty ring buffer
+	return (txBuffering.read - txBuffering.wrote - 1 + TX_BUFFER_SIZE) % TX_BUFFER_SIZE;
+}
+
 static void deInit(void)
 {
     DetachUSB();
@@ -26,6 +26,7 @@ static void txN(uint8_t *str, unsigned char number);
 static uint8_t rxN(uint8_t *ch, unsigned char number);
 static void clearBuffers(void);
 static uint32_t bytesAvailable();
+static uint32_t txSpaceAvailable();
 
 static volatile uint8_t rxBuffer[BUFFER_SIZE];
 static volatile uint8_t txBuffer[BUFFER_SIZE];
@@ -50,7 +51,8 @@ RXTXTypeDef WLAN =
 	.txN             = txN,
 	.clearBuffers    = clearBuffers,
 	.baudRate        = 115200,
-	.bytesAvailable  = bytesAvailable
+	.bytesAvailable  = bytesAvailable,
+	.txSpaceAvailable = txSpaceAvailable
 };
 
 static RXTXBufferingTypeDef buffers =
@@ -241,6 +243,12 @@ static uint32_t bytesAvailable()
 	return available;
 }
 
+static uint32_t txSpaceAvailable()
+{
+	// One element stays unused to distinguish a full from an empty ring buffer
+	return (buffers.tx.read - buffers.tx.wrote - 1 + BUFFER_SIZE) % BUFFER_SIZE;
+}
+
 uint32_t checkReadyToSend() {
 
 	if(checkCmdModeEnabled())
@@ -29,6 +29,7 @@ typedef struct
 	uint8_t (*rxN)(uint8_t *ch, unsigned char number);
 	void (*clearBuffers)(void);
 	uint32_t (*bytesAvailable)(void);
+	uint32_t (*txSpaceAvailable)(void); // Free space in the transmit buffer. NULL: txN() never drops data, it blocks until the data fits
 	uint32_t baudRate;
 } RXTXTypeDef;
 
@@ -43,6 +43,7 @@
 	bool spi_setMode(SPIChannelTypeDef *SPIChannel, uint8_t mode);
 	// read/write 32 bit value at address
 	int32_t spi_readInt(SPIChannelTypeDef *SPIChannel, uint8_t address);
+	void spi_readIntPipelined(SPIChannelTypeDef *SPIChannel, const uint16_t *addresses, int32_t *values, uint32_t count);
 	void spi_writeInt(SPIChannelTypeDef *SPIChannel, uint8_t address, int32_t value);
 
 	// for default channels
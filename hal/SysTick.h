@@ -14,6 +14,9 @@
 	void systick_init();
 	uint32_t systick_getTick();
 	uint32_t systick_getMicrosecondTick();
+	uint32_t systick_getCycleTick();
+	uint32_t systick_cyclesToMicroseconds(uint32_t cycles);
+	uint32_t systick_getCycleFrequency();
 	void wait(uint32_t delay);
 	uint32_t timeSince(uint32_t tick);
 	uint32_t timeDiff(uint32_t newTick, uint32_t oldTick);
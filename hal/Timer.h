@@ -10,6 +10,7 @@
 #define TIMER_H_
 
 #include "derivative.h"
+#include "IOs.h"
 
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
 #define TIMER_MAX 8000
@@ -25,6 +26,16 @@ typedef enum {
 	TIMER_CHANNEL_5
 } timer_channel;
 
+// One segment of a hardware step pulse train: Evenly spaced step pulses,
+// written into the timer registers by DMA. Use fillStepSegment() to set it up.
+typedef struct
+{
+	uint32_t prescaler;   // Timer clock divider - 1
+	uint32_t period;      // Pulse period in divided timer clocks - 1
+	uint32_t repetition;  // Pulse periods in this segment - 1
+	uint32_t pulse;       // Step pulse width in divided timer clocks, 0: no step pulses
+} StepSegmentTypeDef;
+
 typedef struct
 {
 	bool initialized;
@@ -39,6 +50,16 @@ typedef struct
 	void (*setFrequencyMin) (timer_channel channel, float freq_min);
 	void (*overflow_callback) (timer_channel channel);
     void (*setTimerAdcTrigger) (timer_channel channel);
+	// Hardware step pulse train on the given step pin, fed from a circular buffer of
+	// segments by DMA. The callback gets called from the DMA interrupt with the buffer
+	// half (0, 1) that has been sent and may be refilled.
+	// Returns false if the pin has no usable timer output.
+	// NULL if the hardware does not support it.
+	bool (*startStepOutput) (IOPinTypeDef *stepPin, volatile StepSegmentTypeDef *segments, uint32_t count, void (*callback)(uint32_t half));
+	void (*stopStepOutput) (void);
+	// Set up a segment lasting 1/frequency seconds. Returns the number of step pulses
+	// placed in it, which is less than requested if they don't fit.
+	uint32_t (*fillStepSegment) (volatile StepSegmentTypeDef *segment, uint32_t steps, uint32_t frequency);
 } TimerTypeDef;
 
 extern TimerTypeDef Timer;
@@ -36,6 +36,8 @@ EvalboardsTypeDef Evalboards;
 
 // Forward declaration
 void enterBootloader();
+void prepareBootloader();
+void startBootloader();
 
 /* Keep as is! This lines are important for the update functionality. */
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
@@ -174,6 +176,19 @@ int main(void)
 }
 
 void enterBootloader()
+{
+    prepareBootloader();
+
+    wait(500);
+
+    startBootloader();
+}
+
+/* First half of enterBootloader(): Stop the StepDir generator, shut down the boards */
+/* and the USB connection. The board functions are replaced by the dummy functions,  */
+/* so the main loop can keep running safely. Callers have to leave the host some     */
+/* time (500 ms) to notice the USB disconnect before calling startBootloader().      */
+void prepareBootloader()
 {
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall) || defined(LandungsbrueckeV3)
     if(Evalboards.ch1.id == ID_TMC4671)
@@ -191,21 +206,26 @@ void enterBootloader()
     Evalboards.ch1.enableDriver(DRIVER_DISABLE); // todo CHECK 2: the ch1/2 deInit() calls should already disable the drivers - keep this driver disabling to be sure or remove it and leave the disabling to deInit? (LH)
     Evalboards.ch2.enableDriver(DRIVER_DISABLE);
 
+    // todo: CHECK 2: Muss api_deInit hier dazu? (ED)
+    StepDir_deInit();
+
     Evalboards.ch1.deInit();
     Evalboards.ch2.deInit();
 
-    HAL.USB->deInit();
+    board_setDummyFunctions(&Evalboards.ch1);
+    board_setDummyFunctions(&Evalboards.ch2);
 
-    wait(500);
+    HAL.USB->deInit();
+}
 
+/* Second half of enterBootloader(): Shut down the remaining peripherals and reset into the bootloader. */
+void startBootloader()
+{
     HAL.Timer->deInit();
     HAL.RS232->deInit();
     HAL.WLAN->deInit();
     HAL.ADCs->deInit();
 
-    // todo: CHECK 2: Muss api_deInit hier dazu? (ED)
-    StepDir_deInit();
-
     IDDetection_deInit();
 
     HAL.NVIC_DeInit();
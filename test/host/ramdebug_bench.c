@@ -0,0 +1,134 @@
+/*******************************************************************************
+* Copyright © 2023 Analog Devices, Inc.
+*******************************************************************************/
+
+/*
+ * ramdebug_bench.c
+ *
+ * Host benchmark of the RAMDebug trigger evaluation. All trigger conditions
+ * watch an evalboard parameter with a threshold that is never reached, then
+ * handleTriggering() is called like the capture interrupt does while waiting
+ * for the trigger. Reported is the host CPU time per call, and on x86 the
+ * time stamp counter ticks per call, each of the fastest of several rounds.
+ *
+ * The evalboard GAP returns immediately, so the numbers show the overhead of
+ * evaluating the conditions only. RAMDEBUG_SRC selects the RAMDebug.c to
+ * compare (see the Makefile).
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_TSC
+#endif
+
+#include "hal/HAL.h"
+#include "boards/Board.h"
+#include "tmc/RAMDebug.h"
+
+#define BENCH_CALLS   1000000
+#define BENCH_ROUNDS  10
+
+// Not part of RAMDebug.h, the capture interrupt calls it
+extern RAMDebugState state;
+void handleTriggering();
+
+// === Stubbed timing ==========================================================
+
+uint32_t systick_getTick()
+{
+	return 0;
+}
+
+uint32_t systick_getCycleTick()
+{
+	return 0;
+}
+
+// === Stubbed evalboard =======================================================
+
+static uint32_t GAP(uint8_t type, uint8_t motor, int32_t *value)
+{
+	*value = type + motor;
+	return TMC_ERROR_NONE;
+}
+
+EvalboardsTypeDef Evalboards = { .ch1 = { .GAP = GAP }, .ch2 = { .GAP = GAP } };
+
+static ADCTypeDef adcs = { 0 };
+
+const HALTypeDef HAL = { .ADCs = &adcs };
+
+// === Benchmark ===============================================================
+
+static uint64_t nanoseconds(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static int run(uint32_t conditions)
+{
+	debug_init();
+
+	// Parameters never reach the threshold -> the trigger never fires
+	for (uint32_t i = 0; i < conditions; i++)
+	{
+		debug_selectTriggerCondition(i);
+		debug_setTriggerChannel(CAPTURE_PARAMETER, i);
+		debug_setTriggerCondition(TRIGGER_ABOVE_SIGNED);
+		debug_setTriggerThreshold(INT32_MAX);
+	}
+	debug_selectTriggerCondition(0);
+	debug_setTriggerCombine(TRIGGER_COMBINE_OR);
+
+	if (!debug_enableTrigger(TRIGGER_RISING_EDGE_SIGNED, INT32_MAX))
+	{
+		printf("ramdebug_bench: FAILED, trigger not armed\n");
+		return 1;
+	}
+	state = RAMDEBUG_TRIGGER;
+
+	uint64_t duration = UINT64_MAX;
+	uint64_t ticks    = UINT64_MAX;
+	for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		uint64_t start = nanoseconds();
+#ifdef BENCH_TSC
+		uint64_t startTicks = __rdtsc();
+#endif
+		for (uint32_t i = 0; i < BENCH_CALLS; i++)
+			handleTriggering();
+#ifdef BENCH_TSC
+		ticks = MIN(ticks, __rdtsc() - startTicks);
+#endif
+		duration = MIN(duration, nanoseconds() - start);
+	}
+
+	if (state != RAMDEBUG_TRIGGER)
+	{
+		printf("ramdebug_bench: FAILED, trigger fired\n");
+		return 1;
+	}
+
+	printf("ramdebug_bench: %u condition(s): %.1f ns host CPU", conditions, (double) duration / BENCH_CALLS);
+#ifdef BENCH_TSC
+	printf(", %.1f TSC ticks", (double) ticks / BENCH_CALLS);
+#endif
+	printf(" per trigger evaluation\n");
+
+	return 0;
+}
+
+int main(void)
+{
+	int result = 0;
+
+	result |= run(1);
+	result |= run(RAMDEBUG_TRIGGER_CONDITIONS);
+
+	return result;
+}
@@ -0,0 +1,299 @@
+/*******************************************************************************
+* Copyright © 2023 Analog Devices, Inc.
+*******************************************************************************/
+
+/*
+ * scurve_check.c
+ *
+ * Host check of the StepDir S-curve generator. StepDir.c is built into this
+ * file, so the StepDir interrupt is called directly tick by tick, with stubbed
+ * pins and a stubbed cycle counter. Each scenario drives channel 0 through a
+ * sequence of position and velocity ramps, including target changes during a
+ * ramp and reversals. On every tick it checks that
+ *   - the step pulses on the pins match the ramp position,
+ *   - velocity and acceleration stay within their limits,
+ *   - acceleration and velocity only change as far as jerk and acceleration allow,
+ *   - a position ramp started from standstill passes its target by one step at most.
+ * Every ramp has to settle at its target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal/HAL.h"
+
+// The DWT registers don't exist on the host - replace the cycle counter
+static struct
+{
+	volatile uint32_t CYCCNT;
+} fakeDWT;
+
+#undef DWT
+#define DWT (&fakeDWT)
+
+#include "tmc/StepDir.c"
+
+#define CHECK_CHANNEL       0
+#define CHECK_TIMEOUT       60    // s, per ramp
+#define CHECK_SETTLE_TICKS  1000  // Ticks at the target that count as settled
+#define CHECK_MAX_ERRORS    5     // Reported errors per scenario
+
+// === Stubbed HAL =============================================================
+
+static volatile uint32_t stepSet, dirSet, dirReset, unused;
+
+static IOPinTypeDef stepPin  = { .setBitRegister = &stepSet, .resetBitRegister = &unused,   .bitWeight = 1 };
+static IOPinTypeDef dirPin   = { .setBitRegister = &dirSet,  .resetBitRegister = &dirReset, .bitWeight = 1 };
+static IOPinTypeDef stallPin = { .setBitRegister = &unused,  .resetBitRegister = &unused,   .bitWeight = 1 };
+
+static void setLow(IOPinTypeDef *pin)
+{
+	UNUSED(pin);
+}
+
+static unsigned char isHigh(IOPinTypeDef *pin)
+{
+	UNUSED(pin);
+	return 0;
+}
+
+static IOsTypeDef ioConfig = { .setLow = setLow, .isHigh = isHigh };
+static const IOsFunctionsTypeDef ios = { .config = &ioConfig };
+static TimerTypeDef timer = { 0 };
+
+const HALTypeDef HAL = { .IOs = &ios, .Timer = &timer };
+
+FlagStatus timer_interrupt_flag_get(uint32_t timer_periph, uint32_t interrupt)
+{
+	UNUSED(timer_periph);
+	UNUSED(interrupt);
+	return SET;
+}
+
+// === Scenarios ===============================================================
+
+typedef enum {
+	MOVE_TO,  // value: Target position
+	ROTATE,   // value: Target velocity
+	END
+} CommandType;
+
+typedef struct
+{
+	CommandType type;
+	int32_t value;
+	uint32_t ticks;  // Ticks until the next command, 0: Until settled
+} Command;
+
+typedef struct
+{
+	const char *name;
+	uint32_t precision;
+	int32_t maxVelocity;
+	uint32_t acceleration;
+	uint32_t jerk;
+	Command commands[8];
+} Scenario;
+
+#define MS(precision, ms) ((precision) / 1000 * (ms))
+
+static const Scenario scenarios[] =
+{
+	{ "position ramps", 1 << 17, 50000, 100000, 1000000, {
+		{ MOVE_TO, 100000, 0 },
+		{ MOVE_TO, 100100, 0 },  // Short ramp, no constant acceleration or cruising
+		{ MOVE_TO, -12345, 0 },
+		{ MOVE_TO, -12346, 0 },  // Single step
+		{ END }
+	} },
+	{ "target changes", 1 << 17, 50000, 100000, 1000000, {
+		{ MOVE_TO, 200000, MS(1 << 17, 500) },
+		{ MOVE_TO, 16000, 0 },   // Closer than the braking distance -> passes and returns
+		{ MOVE_TO, 16010, 1000 },
+		{ MOVE_TO, 80000, 0 },   // Further away while accelerating
+		{ MOVE_TO, 150000, MS(1 << 17, 300) },
+		{ MOVE_TO, -50000, 0 },  // Reversal at full speed
+		{ END }
+	} },
+	{ "velocity ramps", 1 << 17, 50000, 100000, 1000000, {
+		{ ROTATE, 40000, 0 },
+		{ ROTATE, -30000, 0 },   // Reversal
+		{ ROTATE, 10000, MS(1 << 17, 450) },
+		{ ROTATE, -10000, MS(1 << 17, 100) },  // Reversal during a velocity change
+		{ ROTATE, 0, 0 },
+		{ MOVE_TO, 0, 0 },       // Back from velocity mode
+		{ END }
+	} },
+	// Few ticks per ramp with large jerk steps: The shortest ramps can pass the target
+	{ "low precision", 1 << 13, 3000, 200000, 5000000, {
+		{ MOVE_TO, 5000, 0 },
+		{ MOVE_TO, 5003, 0 },
+		{ MOVE_TO, 20000, MS(1 << 13, 400) },
+		{ MOVE_TO, 2000, 0 },
+		{ ROTATE, -2500, 0 },
+		{ ROTATE, 2500, MS(1 << 13, 20) },
+		{ MOVE_TO, 0, 0 },
+		{ END }
+	} },
+};
+
+// === Checks ==================================================================
+
+typedef struct
+{
+	const Scenario *scenario;
+	uint32_t ticks;
+	int32_t position;      // Position generated by the step pulses
+	int32_t startPosition; // Position when the current target was set
+	int32_t startVelocity; // Velocity when the current target was set
+	int32_t lastVelocity;
+	int32_t lastAcceleration;
+	int32_t maxOvershoot;
+	int8_t direction;      // Direction of the last movement
+	uint32_t reversals;
+	uint32_t errors;
+} CheckState;
+
+static void fail(CheckState *state, const char *message, int32_t value)
+{
+	if (state->errors++ < CHECK_MAX_ERRORS)
+		printf("scurve_check: %s: tick %u: %s (%d)\n", state->scenario->name, state->ticks, message, value);
+}
+
+// Runs one interrupt tick and checks it. Returns true when the ramp rests at its target.
+static bool tick(CheckState *state)
+{
+	StepDirectionTypedef *ch = &StepDir[CHECK_CHANNEL];
+	TMC_LinearRamp *ramp = &ch->ramp;
+	int32_t precision = ramp->precision;
+
+	stepSet = dirSet = dirReset = 0;
+	TIMER2_IRQHandler();
+	state->ticks++;
+
+	// Step pulses
+	if (stepSet)
+	{
+		if (!dirSet == !dirReset)
+			fail(state, "step without a single direction", 0);
+
+		state->position += (dirReset) ? 1 : -1;
+	}
+
+	if (state->position != ramp->rampPosition)
+		fail(state, "step pulses differ from the ramp position", state->position - ramp->rampPosition);
+
+	// Limits
+	int32_t velocity = ramp->rampVelocity;
+	int32_t acceleration = ch->sCurve.acceleration;
+
+	// A velocity change runs from the start velocity towards the target velocity
+	int32_t velocityLimit = (ramp->rampMode == TMC_RAMP_LINEAR_MODE_POSITION)
+			? (int32_t) ramp->maxVelocity
+			: MAX(abs(ramp->targetVelocity), abs(state->startVelocity));
+	if (abs(velocity) > velocityLimit)
+		fail(state, "velocity limit exceeded", velocity);
+
+	if ((uint32_t) abs(acceleration) > ch->sCurve.accelerationLimit)
+		fail(state, "acceleration limit exceeded", acceleration);
+
+	// Changes per tick, one more for the rounding. Homing starts and stops at the stop velocity.
+	int32_t maxVelocityChange = MAX(ch->sCurve.accelerationLimit / precision + 1, ramp->stopVelocity);
+	if (abs(velocity - state->lastVelocity) > maxVelocityChange)
+		fail(state, "velocity jump", velocity - state->lastVelocity);
+
+	// The last tick of a velocity change applies the first jerk step once more
+	// and clears the acceleration afterwards
+	int32_t maxAccelerationChange = MIN(ch->sCurve.jerkLimit / precision + 1, ch->sCurve.accelerationLimit);
+	if ((ch->sCurve.phase == SCURVE_IDLE) && (acceleration == 0))
+		maxAccelerationChange *= 2;
+	if (abs(acceleration - state->lastAcceleration) > maxAccelerationChange)
+		fail(state, "acceleration jump", acceleration - state->lastAcceleration);
+
+	if (velocity != 0)
+	{
+		int8_t direction = (velocity > 0) ? 1 : -1;
+		if (state->direction && (direction != state->direction))
+			state->reversals++;
+		state->direction = direction;
+	}
+
+	state->lastVelocity = velocity;
+	state->lastAcceleration = acceleration;
+
+	if (ramp->rampMode == TMC_RAMP_LINEAR_MODE_VELOCITY)
+		return (velocity == ramp->targetVelocity) && (ch->sCurve.phase == SCURVE_IDLE);
+
+	// Passing the target, seen from where the ramp started. A ramp started
+	// in motion may have to pass it.
+	if (state->startVelocity != 0)
+		return (state->position == ramp->targetPosition) && (velocity == 0) && (ch->sCurve.phase == SCURVE_IDLE);
+
+	int32_t overshoot = (ramp->targetPosition >= state->startPosition)
+			? state->position - ramp->targetPosition
+			: ramp->targetPosition - state->position;
+	state->maxOvershoot = MAX(state->maxOvershoot, overshoot);
+	if (overshoot > 1)
+		fail(state, "target passed", overshoot);
+
+	return (state->position == ramp->targetPosition) && (velocity == 0) && (ch->sCurve.phase == SCURVE_IDLE);
+}
+
+static void runCommand(CheckState *state, const Command *command)
+{
+	uint32_t precision = state->scenario->precision;
+
+	state->startPosition = state->position;
+	state->startVelocity = state->lastVelocity;
+	if (command->type == MOVE_TO)
+		StepDir_moveTo(CHECK_CHANNEL, command->value);
+	else
+		StepDir_rotate(CHECK_CHANNEL, command->value);
+
+	if (command->ticks)
+	{
+		for (uint32_t i = 0; i < command->ticks; i++)
+			tick(state);
+		return;
+	}
+
+	uint32_t settled = 0;
+	for (uint32_t i = 0; i < CHECK_TIMEOUT * precision; i++)
+	{
+		settled = (tick(state)) ? settled + 1 : 0;
+		if (settled == CHECK_SETTLE_TICKS)
+			return;
+	}
+
+	fail(state, "ramp did not settle", state->position);
+}
+
+static bool runScenario(const Scenario *scenario)
+{
+	CheckState state = { .scenario = scenario };
+
+	StepDir_init(scenario->precision);
+	StepDir_setPins(CHECK_CHANNEL, &stepPin, &dirPin, &stallPin);
+	StepDir_setRampType(CHECK_CHANNEL, STEPDIR_RAMP_SCURVE);
+	StepDir_setVelocityMax(CHECK_CHANNEL, scenario->maxVelocity);
+	StepDir_setAcceleration(CHECK_CHANNEL, scenario->acceleration);
+	StepDir_setJerk(CHECK_CHANNEL, scenario->jerk);
+
+	for (const Command *command = scenario->commands; command->type != END; command++)
+		runCommand(&state, command);
+
+	printf("scurve_check: %s: %s, %u ticks, %u reversals, target passed by %d steps at most\n",
+			scenario->name, (state.errors) ? "FAILED" : "ok", state.ticks, state.reversals, state.maxOvershoot);
+
+	return state.errors == 0;
+}
+
+int main(void)
+{
+	bool ok = true;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(scenarios); i++)
+		ok &= runScenario(&scenarios[i]);
+
+	return (ok) ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* Copyright © 2023 Analog Devices, Inc.
+*******************************************************************************/
+
+/*
+ * tmcl_bench.c
+ *
+ * Host benchmark of the TMCL command path. A burst of GAP datagrams is put
+ * into the USB receive path at once, then tmcl_process() is called like the
+ * main loop does until all replies have been sent. Reported are the main loop
+ * passes needed and the host CPU time per command.
+ *
+ * The evalboard GAP returns immediately, so the numbers show the overhead of
+ * parsing, queueing, dispatching and replying only. The cycle counter advances
+ * by a fixed amount per read: The time budget doesn't cut passes short and the
+ * cost of the host clock doesn't distort the comparison between revisions.
+ *
+ * The USB stub behaves like the LandungsbrueckeV3 transmit buffer: It holds
+ * BENCH_USB_TX_BUFFER bytes, reports its free space and passes on at most
+ * BENCH_USB_TX_PER_PASS bytes per main loop pass. Sending more than fits is
+ * data the firmware would lose and fails the benchmark. Before the benchmark,
+ * the host stops fetching for a while to check that the replies wait for free
+ * space instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal/HAL.h"
+#include "boards/Board.h"
+#include "tmc/TMCL.h"
+
+#define BENCH_COMMANDS  100000
+#define BENCH_LOOP_US   100     // Assumed duration of the rest of a main loop pass
+#define BENCH_USB_TX_BUFFER    1024  // Transmit buffer size of the LandungsbrueckeV3 USB
+#define BENCH_USB_TX_PER_PASS  256   // Bytes the host fetches per main loop pass
+#define BENCH_STALL_COMMANDS   1000
+#define BENCH_STALL_PASSES     100
+
+// === Stubbed timing ==========================================================
+
+static uint32_t cycleCounter = 0;
+
+uint32_t systick_getCycleTick()
+{
+	return cycleCounter += 24;
+}
+
+uint32_t systick_cyclesToMicroseconds(uint32_t cycles)
+{
+	return cycles / 240;
+}
+
+uint32_t systick_getMicrosecondTick()
+{
+	return systick_cyclesToMicroseconds(systick_getCycleTick());
+}
+
+uint32_t systick_getTick()
+{
+	return systick_getMicrosecondTick() / 1000;
+}
+
+uint32_t timeSince(uint32_t tick)
+{
+	return systick_getTick() - tick;
+}
+
+// === Stubbed interfaces and evalboard ========================================
+
+static uint8_t datagram[9];
+static uint32_t datagramsLeft = 0;
+static uint32_t replyBytes = 0;
+static uint32_t usbTxPending = 0;
+static uint32_t usbTxOverruns = 0;
+static uint32_t usbTxPerPass = BENCH_USB_TX_PER_PASS;
+
+static uint8_t usbRxN(uint8_t *data, unsigned char number)
+{
+	if(datagramsLeft == 0 || number != sizeof(datagram))
+		return 0;
+
+	memcpy(data, datagram, sizeof(datagram));
+	datagramsLeft--;
+	return 1;
+}
+
+static uint8_t noRxN(uint8_t *data, unsigned char number)
+{
+	UNUSED(data);
+	UNUSED(number);
+	return 0;
+}
+
+static void countTxN(uint8_t *data, unsigned char number)
+{
+	UNUSED(data);
+	replyBytes += number;
+}
+
+static uint32_t usbTxSpace(void)
+{
+	return BENCH_USB_TX_BUFFER - usbTxPending;
+}
+
+static void usbTxN(uint8_t *data, unsigned char number)
+{
+	if(number > usbTxSpace())
+	{
+		usbTxOverruns++;
+		return;
+	}
+
+	usbTxPending += number;
+	countTxN(data, number);
+}
+
+// The host fetches part of the transmit buffer while the rest of the pass runs
+static void usbTxDrain(void)
+{
+	usbTxPending -= MIN(usbTxPending, usbTxPerPass);
+}
+
+static void reset(uint8_t resetPeripherals)
+{
+	UNUSED(resetPeripherals);
+}
+
+static RXTXTypeDef usb   = { .rxN = usbRxN, .txN = usbTxN,   .txSpaceAvailable = usbTxSpace };
+static RXTXTypeDef other = { .rxN = noRxN,  .txN = countTxN };
+
+const HALTypeDef HAL = { .USB = &usb, .RS232 = &other, .WLAN = &other, .reset = reset };
+
+static uint32_t GAP(uint8_t type, uint8_t motor, int32_t *value)
+{
+	*value = type + motor;
+	return TMC_ERROR_NONE;
+}
+
+EvalboardsTypeDef Evalboards = { .ch1 = { .GAP = GAP }, .ch2 = { .GAP = GAP } };
+
+// === Benchmark ===============================================================
+
+static uint64_t nanoseconds(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+int main(void)
+{
+	// GAP 1, motor 0
+	uint8_t command[9] = { 1, TMCL_GAP, 1, 0, 0, 0, 0, 0, 0 };
+	for(uint8_t i = 0; i < 8; i++)
+		command[8] += command[i];
+	memcpy(datagram, command, sizeof(datagram));
+
+	tmcl_init();
+
+	// The host stops fetching: The replies have to wait for free space
+	datagramsLeft = BENCH_STALL_COMMANDS;
+	usbTxPerPass = 0;
+	for(uint32_t i = 0; i < BENCH_STALL_PASSES; i++)
+		tmcl_process();
+
+	usbTxPerPass = BENCH_USB_TX_PER_PASS;
+	for(uint32_t i = 0; i < BENCH_STALL_COMMANDS && replyBytes < BENCH_STALL_COMMANDS * sizeof(datagram); i++)
+	{
+		tmcl_process();
+		usbTxDrain();
+	}
+
+	if(usbTxOverruns || replyBytes != BENCH_STALL_COMMANDS * sizeof(datagram))
+	{
+		printf("tmcl_bench: FAILED, %u of %u replies sent while the host stalled, %u transmissions exceeded the free buffer space\n",
+				replyBytes / 9, BENCH_STALL_COMMANDS, usbTxOverruns);
+		return 1;
+	}
+
+	replyBytes = 0;
+	datagramsLeft = BENCH_COMMANDS;
+	uint32_t passes = 0;
+	uint64_t start = nanoseconds();
+	while(replyBytes < BENCH_COMMANDS * sizeof(datagram) && passes <= 2 * BENCH_COMMANDS)
+	{
+		tmcl_process();
+		usbTxDrain();
+		passes++;
+	}
+	uint64_t duration = nanoseconds() - start;
+
+	if(usbTxOverruns)
+	{
+		printf("tmcl_bench: FAILED, %u USB transmissions exceeded the free buffer space\n", usbTxOverruns);
+		return 1;
+	}
+
+	if(replyBytes != BENCH_COMMANDS * sizeof(datagram))
+	{
+		printf("tmcl_bench: FAILED, %u of %u replies sent\n", replyBytes / 9, BENCH_COMMANDS);
+		return 1;
+	}
+
+	double cpuPerCommand = (double) duration / BENCH_COMMANDS;
+	double passesPerCommand = (double) passes / BENCH_COMMANDS;
+	printf("tmcl_bench: %u GAP commands in %u main loop passes (%.2f commands per pass)\n", BENCH_COMMANDS, passes, 1 / passesPerCommand);
+	printf("tmcl_bench: %.1f ns host CPU per command\n", cpuPerCommand);
+	printf("tmcl_bench: %.0f commands/s with %u µs of other work per main loop pass\n",
+			1e9 / (passesPerCommand * BENCH_LOOP_US * 1000 + cpuPerCommand), BENCH_LOOP_US);
+
+	return 0;
+}
@@ -81,6 +81,9 @@ int32_t Board_assign(IdAssignmentTypeDef *ids)
     // This is currently done on completed motion controller reset/restore
     hookDriverSPI(ids);
 
+    // The channel handling each command may have changed
+    tmcl_resetRouting();
+
 
     out |= (ids->ch2.state  << 24) & 0xFF;
     out |= (ids->ch2.id     << 16) & 0xFF;
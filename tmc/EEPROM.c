@@ -121,6 +121,27 @@ end:
     Zweck: Schreiben eines Bytes in das EEPROM auf dem Evalboard.
 ********************************************************************/
 void eeprom_write_byte(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t value)
+{
+    eeprom_startWriteByte(SPIChannel, address, value);
+
+    // Warten bis Schreibvorgang beendet ist
+    while(!eeprom_isWriteDone(SPIChannel));
+}
+
+/*******************************************************************
+    Function: eeprom_startWriteByte
+    Parameters: Channel: SPI channel of the Eeprom
+                address: Address in the Eeprom (0..16383)
+                value: Value to write
+
+    Returns: ---
+
+    Purpose: Non-blocking variant of eeprom_write_byte(). Starts the
+    write cycle of the Eeprom and returns without waiting for it.
+    eeprom_isWriteDone() has to be polled until it returns true
+    before the Eeprom is accessed again.
+********************************************************************/
+void eeprom_startWriteByte(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t value)
 {
     // select CSN of eeprom
     IOPinTypeDef* io = SPIChannel->CSN;
@@ -151,24 +172,58 @@ void eeprom_write_byte(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t
     SPIChannel->readWrite(address & 0xFF, false);
     SPIChannel->readWrite(value, true);
 
-    // Warten bis Schreibvorgang beendet ist
-    do
-    {
-        SPIChannel->readWrite(0x05, false); //Befehl "Get Status"
-    } while(SPIChannel->readWrite(0x00, true) & 0x01);
+    // Restore the SPI mode
+    spi_setMode(SPIChannel, prevMode);
 
-    //block writing
-    SPIChannel->readWrite(0x04, true); //Befehl "Write Disable"
-    do
+    HAL.IOs->config->toInput(SPIChannel->CSN);
+    SPIChannel->CSN = io;
+}
+
+/*******************************************************************
+    Function: eeprom_isWriteDone
+    Parameters: Channel: SPI channel of the Eeprom
+
+    Returns: true when the write cycle started by eeprom_startWriteByte()
+             has finished, false otherwise
+
+    Purpose: Checks the write-in-progress bit once. After the write
+    cycle has finished, writing gets blocked again.
+********************************************************************/
+bool eeprom_isWriteDone(SPIChannelTypeDef *SPIChannel)
+{
+    // select CSN of eeprom
+    IOPinTypeDef* io = SPIChannel->CSN;
+    if(SPIChannel == &SPI.ch1)
+        SPIChannel->CSN = &HAL.IOs->pins->ID_CH0;
+    else
+        SPIChannel->CSN = &HAL.IOs->pins->ID_CH1;
+
+    IOs.toOutput(SPIChannel->CSN);
+
+    // Ensure we're in SPI mode 3
+    uint8_t prevMode = spi_getMode(SPIChannel);
+    spi_setMode(SPIChannel, 3);
+
+    SPIChannel->readWrite(0x05, false); // Befehl "Get Status"
+    bool done = (SPIChannel->readWrite(0x00, true) & 0x01) == 0;
+
+    if(done)
     {
-        SPIChannel->readWrite(0x05, false); //Befehl "Get Status"
-    } while((SPIChannel->readWrite(0x00, true) & 0x02) != 0x00); //Warte bis "Write Enable"-Bit zurückgesetzt wird
+        //block writing
+        SPIChannel->readWrite(0x04, true); //Befehl "Write Disable"
+        do
+        {
+            SPIChannel->readWrite(0x05, false); //Befehl "Get Status"
+        } while((SPIChannel->readWrite(0x00, true) & 0x02) != 0x00); //Warte bis "Write Enable"-Bit zurückgesetzt wird
+    }
 
     // Restore the SPI mode
     spi_setMode(SPIChannel, prevMode);
 
     HAL.IOs->config->toInput(SPIChannel->CSN);
     SPIChannel->CSN = io;
+
+    return done;
 }
 
 
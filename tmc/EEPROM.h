@@ -51,6 +51,8 @@ void eeprom_init(SPIChannelTypeDef *SPIChannel);
 uint8_t eeprom_check(SPIChannelTypeDef *SPIChannel);
 
 void eeprom_write_byte(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t value);
+void eeprom_startWriteByte(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t value);
+bool eeprom_isWriteDone(SPIChannelTypeDef *SPIChannel);
 void eeprom_write_array(SPIChannelTypeDef *SPIChannel, uint16_t address, uint8_t *data, uint16_t size);
 
 uint8_t eeprom_read_byte(SPIChannelTypeDef *SPIChannel, uint16_t address);
@@ -13,6 +13,7 @@
 #include "hal/HAL.h"
 
 #include <string.h>
+#include <math.h>
 
 // === RAM debugging ===========================================================
 
@@ -37,6 +38,53 @@ static uint32_t frequency   = RAMDEBUG_FREQUENCY;
 static uint32_t sampleCount = RAMDEBUG_BUFFER_ELEMENTS;
 static uint32_t sampleCountPre = 0;
 
+// Streaming
+// Instead of stopping after sampleCount samples, the capture keeps writing
+// into debug_buffer as a ring buffer and the main loop sends the samples out
+// as they come in. The sample counters are free running, the buffer index is
+// the counter modulo RAMDEBUG_BUFFER_ELEMENTS (a power of two, so the
+// counter overflow does not disturb the index).
+static bool streaming = false;
+static uint32_t streamSetSize   = 0; // Samples per sampling point (enabled channels)
+static uint32_t streamWritten   = 0;
+static uint32_t streamRead      = 0;
+static uint32_t streamOverflows = 0; // Sampling points dropped due to a full buffer
+
+// DMA capture of an analog input
+// debug_buffer is used as a ring of 16 bit conversions. The conversion
+// counters are free running.
+#define ADC_RING_SAMPLES  (RAMDEBUG_BUFFER_ELEMENTS * 2)
+#define ADC_HALF_SAMPLES  (ADC_RING_SAMPLES / 2)
+
+static struct {
+    uint8_t  input;
+    uint32_t frequency;   // 0: Disabled
+    bool     running;
+    bool     primed;      // Trigger state initialized with a conversion
+    uint32_t converted;   // Conversions handed over by the DMA interrupts
+    uint32_t start;       // Conversion number of the capture start
+    uint32_t end;
+    uint32_t slot;        // Trigger point within its word
+} adcCapture;
+
+// Statistics mode
+// The accumulators are indexed by the sample index within the sampling point.
+static bool statisticsMode = false;
+static uint32_t statisticsCount = 0;
+
+static struct {
+    int32_t  lowerBound;
+    uint8_t  shift;
+} histograms[RAMDEBUG_MAX_CHANNELS];
+
+static struct {
+    int32_t  min;
+    int32_t  max;
+    float    mean;
+    float    m2;       // Sum of the squared differences from the mean
+    uint32_t bins[RAMDEBUG_HISTOGRAM_BINS];
+} statistics[RAMDEBUG_MAX_CHANNELS];
+
 typedef struct {
     RAMDebugSource type;
     uint8_t eval_channel;
@@ -45,104 +93,396 @@ typedef struct {
 
 Channel channels[RAMDEBUG_MAX_CHANNELS];
 
+typedef struct {
+    RAMDebugEncoding encoding;
+    uint8_t          width;    // 1 - 32 bits, used by ENCODING_WIDTH and ENCODING_REPEAT
+} Encoding;
+
+static Encoding encodings[RAMDEBUG_MAX_CHANNELS];
+
+// Channel read plan
+// Register channels of the same evalboard channel and motor are read together
+// with the readRegisters() function of the board (e.g. pipelined SPI reads).
+// Stacked register channels sharing the same stack pointer register are read
+// together as well: The pointer is backed up and restored once per sampling
+// point and only written when it changes.
+// The plan gets built when arming a capture, as the channel configuration can
+// only change while idle.
+typedef struct {
+    uint8_t  eval_channel;
+    uint8_t  motor;
+    uint8_t  count;
+    uint16_t addresses[RAMDEBUG_MAX_CHANNELS];
+    uint8_t  slots[RAMDEBUG_MAX_CHANNELS];     // Sample index within the sampling point
+} ReadGroup;
+
+typedef struct {
+    uint8_t  eval_channel;
+    uint8_t  motor;
+    uint8_t  stackAddress;                     // Stack pointer register
+    uint8_t  count;
+    uint8_t  indices[RAMDEBUG_MAX_CHANNELS];   // Stack pointer value per channel
+    uint8_t  dataAddresses[RAMDEBUG_MAX_CHANNELS];
+    uint8_t  slots[RAMDEBUG_MAX_CHANNELS];
+} StackGroup;
+
+typedef struct ChannelReader {
+    uint32_t (*read)(const struct ChannelReader *reader);
+    EvalboardFunctionsTypeDef *board;
+    uint8_t  motor;
+    uint16_t address;                          // Parameter type or (data) register address
+    uint8_t  stackAddress;                     // Stacked registers: Stack pointer register
+    uint8_t  stackIndex;
+    volatile uint16_t *analogValue;
+} ChannelReader;
+
+static struct {
+    uint8_t    channelCount;                     // Enabled channels
+    uint8_t    channel[RAMDEBUG_MAX_CHANNELS];   // Channel index per sample
+    bool       grouped[RAMDEBUG_MAX_CHANNELS];   // Sample is read by a group
+    ChannelReader readers[RAMDEBUG_MAX_CHANNELS]; // Samples not read by a group
+    uint8_t    readerSlots[RAMDEBUG_MAX_CHANNELS];
+    uint8_t    readerCount;
+    ReadGroup  groups[RAMDEBUG_MAX_CHANNELS / 2];
+    uint8_t    groupCount;
+    StackGroup stackGroups[RAMDEBUG_MAX_CHANNELS];
+    uint8_t    stackGroupCount;
+    ChannelReader triggerReaders[RAMDEBUG_TRIGGER_CONDITIONS]; // Channel per trigger condition
+} readPlan;
+
+// Sample packing state
+static uint8_t storageWidths[RAMDEBUG_MAX_CHANNELS]; // 8, 16 or 32 bits
+
+static struct {
+    bool     enabled;
+    uint32_t pointBytes; // Bytes per sampling point, including padding
+    uint32_t slot;       // Sampling points already in the current word
+    uint32_t padding;    // Unused slots of the word closed by the trigger
+} packing;
+
+// Segmented capture state
+// Each segment is a ring buffer of its own. debug_start_index is the start of
+// the capture in the current segment.
+static struct {
+    uint8_t  configured;                            // Requested amount of segments
+    uint8_t  count;                                 // Segments of the armed capture
+    uint8_t  current;                               // Segment being filled
+    uint32_t size;                                  // Buffer words per segment
+    uint32_t start[RAMDEBUG_MAX_SEGMENTS];          // Buffer index of the capture start
+    uint32_t triggerTick[RAMDEBUG_MAX_SEGMENTS];    // Systick of the trigger event
+    uint32_t padding[RAMDEBUG_MAX_SEGMENTS];        // Packing padding before the trigger point
+} segments;
+
+#define SEGMENT_BASE  (segments.current * segments.size)
+
+// Sampling timing
+// debug_process() runs from the main loop, so the sampling points are not
+// spaced evenly. The intervals between the stored sampling points get measured
+// with the CPU cycle counter.
+static struct {
+    bool     started;
+    uint32_t lastSample;    // Cycle counter of the previous sampling point
+    uint32_t interval;      // Interval of the current sampling point
+    uint32_t missedTicks;
+    uint32_t lateSamples;
+    uint32_t intervalMin;
+    uint32_t intervalMax;
+    uint64_t intervalSum;
+    uint32_t intervalCount;
+    uint32_t readCyclesMax; // CPU cycles for reading a sampling point
+    uint64_t readCyclesSum;
+    uint32_t readCount;
+} timing;
+
+// Decimation state
+// The accumulators are indexed by the sample index within the sampling point.
+static uint8_t decimationModes[RAMDEBUG_MAX_CHANNELS];
+
+static struct {
+    bool     enabled;
+    bool     phase;                                // Peak detection: 0: Next point stores the minimum, 1: the maximum
+    bool     triggerPhase;
+    uint32_t count;                                // Readings since the last sampling point
+    uint32_t last[RAMDEBUG_MAX_CHANNELS];
+    int64_t  sum[RAMDEBUG_MAX_CHANNELS];
+    int32_t  min[RAMDEBUG_MAX_CHANNELS];
+    int32_t  max[RAMDEBUG_MAX_CHANNELS];
+    int32_t  previousMin[RAMDEBUG_MAX_CHANNELS];   // Of the previous interval, for the peak detection
+    int32_t  previousMax[RAMDEBUG_MAX_CHANNELS];
+} decimation;
+
+// Compressed capture state
+// Worst case sampling point: 5 varint bytes for each channel
+#define POINT_WORDS_MAX  ((RAMDEBUG_MAX_CHANNELS * 40 + 31) / 32)
+#define BLOCK_BITS       ((RAMDEBUG_BLOCK_WORDS - 1) * 32)
+#define ROUND_UP_BLOCK(x) ((((x) + RAMDEBUG_BLOCK_WORDS - 1) / RAMDEBUG_BLOCK_WORDS) * RAMDEBUG_BLOCK_WORDS)
+
+static struct {
+    bool     enabled;
+    uint32_t blockStart;                          // Buffer index of the current block
+    uint32_t bitPos;                              // Used bits of the current block bitstream
+    uint32_t previous[RAMDEBUG_MAX_CHANNELS];
+} compression;
+
+// Trigger conditions
+// Condition 0 is the classic trigger channel, conditions 1 - 3 are used when
+// their channel is set. The trigger configuration commands apply to the
+// selected condition.
 typedef struct {
     Channel          channel;
     RAMDebugTrigger  type;
     uint32_t         threshold;
+    uint32_t         thresholdHigh; // Upper window limit
+    uint32_t         hysteresis;
     uint32_t         mask;
     uint8_t          shift;
+    bool             above;         // Value is above the threshold (with hysteresis)
+    bool             inside;        // Value is within the window (with hysteresis)
 } Trigger;
 
-Trigger trigger;
+Trigger triggers[RAMDEBUG_TRIGGER_CONDITIONS];
+
+static struct {
+    uint8_t          selected;      // Condition configured by the trigger commands
+    RAMDebugCombine  combine;
+    uint32_t         holdoff;       // Trigger evaluations ignored after arming
+    uint32_t         minDuration;   // Evaluations the combined condition has to hold
+    uint32_t         evaluations;
+    uint32_t         duration;
+} triggerSettings;
 
-// Store whether the last sampling point was above or below the trigger threshold
-static bool wasAboveSigned   = 0;
-static bool wasAboveUnsigned = 0;
+// Condition configured by the trigger commands
+static inline Trigger *selectedTrigger()
+{
+    return &triggers[triggerSettings.selected];
+}
 
 // Function declarations
-static uint32_t readChannel(Channel channel);
+static void buildReadPlan();
+static uint32_t readSamplingPoint(uint32_t *samples);
+static uint32_t takeSamplingPoint(uint32_t *samples);
+static void accumulateSamplingPoint();
+static void resetDecimation();
+static void updateTiming();
+static void armTriggers();
+static bool nextSegment();
+static int32_t startAdcCapture();
+static void handleStatistics();
+static void resetStatistics();
+static void resetTiming();
+static void handleStreaming();
+static void handlePacked();
+static bool advanceWriteIndex();
+static void handleCompressed();
+static void startBlock(uint32_t index);
+static bool nextBlock();
 
 // === Capture and trigger logic ===============================================
 
-// This function only gets called by the interrupt handler.
-void handleTriggering()
+// Apply the mask/shift values to a trigger channel sample
+static void readTriggerValue(Trigger *condition, uint32_t sample, int32_t *value, uint32_t *value_raw)
 {
-    // Abort if not in the right state
-    if (state != RAMDEBUG_TRIGGER)
-        return;
-
-    // Read the trigger channel value and apply mask/shift values
-    uint32_t value_raw = readChannel(trigger.channel);
-    value_raw = (value_raw & trigger.mask) >> trigger.shift;
+    *value_raw = (sample & condition->mask) >> condition->shift;
 
     // Create a signed version of the trigger value
-    int32_t value = value_raw;
+    *value = *value_raw;
     // Create a mask with only the highest bit of the trigger channel mask set
-    uint32_t msbMask = (trigger.mask>>trigger.shift) ^ (trigger.mask>>(trigger.shift+1));
+    uint32_t msbMask = (condition->mask>>condition->shift) ^ (condition->mask>>(condition->shift+1));
     // Check if our value has that bit set.
-    if (value_raw & msbMask)
+    if (*value_raw & msbMask)
     {
         // If yes, sign-extend it
-        value |= ~(trigger.mask>>trigger.shift);
+        *value |= ~(condition->mask>>condition->shift);
     }
+}
 
-    bool isAboveSigned   = value > (int32_t)  trigger.threshold;
-    bool isAboveUnsigned = value_raw > (uint32_t) trigger.threshold;
+static bool isSignedTrigger(RAMDebugTrigger type)
+{
+    switch(type)
+    {
+    case TRIGGER_RISING_EDGE_UNSIGNED:
+    case TRIGGER_FALLING_EDGE_UNSIGNED:
+    case TRIGGER_DUAL_EDGE_UNSIGNED:
+    case TRIGGER_ABOVE_UNSIGNED:
+    case TRIGGER_BELOW_UNSIGNED:
+    case TRIGGER_WINDOW_INSIDE_UNSIGNED:
+    case TRIGGER_WINDOW_OUTSIDE_UNSIGNED:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Update the threshold and window states of a condition. Without hysteresis
+// the states follow the plain comparisons (value > threshold, low <= value <= high).
+static void updateTriggerState(Trigger *condition, uint32_t sample, bool initial)
+{
+    int32_t value;
+    uint32_t value_raw;
+    int64_t v, threshold, low, high;
+    int64_t hysteresis = (initial) ? 0 : condition->hysteresis;
+
+    readTriggerValue(condition, sample, &value, &value_raw);
 
-    switch(trigger.type)
+    if (isSignedTrigger(condition->type))
+    {
+        v         = value;
+        threshold = (int32_t) condition->threshold;
+        high      = (int32_t) condition->thresholdHigh;
+    }
+    else
+    {
+        v         = value_raw;
+        threshold = condition->threshold;
+        high      = condition->thresholdHigh;
+    }
+    low = threshold;
+
+    if (initial)
+    {
+        condition->above  = v > threshold;
+        condition->inside = (v >= low) && (v <= high);
+        return;
+    }
+
+    if (condition->above)
+        condition->above = v > threshold - hysteresis;
+    else
+        condition->above = v > threshold + hysteresis;
+
+    if (condition->inside)
+        condition->inside = (v >= low - hysteresis) && (v <= high + hysteresis);
+    else
+        condition->inside = (v >= low + hysteresis) && (v <= high - hysteresis);
+}
+
+static bool evaluateCondition(Trigger *condition, uint32_t sample)
+{
+    bool wasAbove = condition->above;
+
+    if (condition->type == TRIGGER_UNCONDITIONAL)
+        return true;
+
+    updateTriggerState(condition, sample, false);
+
+    switch(condition->type)
     {
-    case TRIGGER_UNCONDITIONAL:
-        state = RAMDEBUG_CAPTURE;
-        break;
     case TRIGGER_RISING_EDGE_SIGNED:
-        if (!wasAboveSigned && isAboveSigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
-    case TRIGGER_FALLING_EDGE_SIGNED:
-        if (wasAboveSigned && !isAboveSigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
-    case TRIGGER_DUAL_EDGE_SIGNED:
-        if (wasAboveSigned != isAboveSigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
     case TRIGGER_RISING_EDGE_UNSIGNED:
-        if (!wasAboveUnsigned && isAboveUnsigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
+        return !wasAbove && condition->above;
+    case TRIGGER_FALLING_EDGE_SIGNED:
     case TRIGGER_FALLING_EDGE_UNSIGNED:
-        if (wasAboveUnsigned && !isAboveUnsigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
+        return wasAbove && !condition->above;
+    case TRIGGER_DUAL_EDGE_SIGNED:
     case TRIGGER_DUAL_EDGE_UNSIGNED:
-        if (wasAboveUnsigned != isAboveUnsigned)
-        {
-            state = RAMDEBUG_CAPTURE;
-        }
-        break;
+        return wasAbove != condition->above;
+    case TRIGGER_ABOVE_SIGNED:
+    case TRIGGER_ABOVE_UNSIGNED:
+        return condition->above;
+    case TRIGGER_BELOW_SIGNED:
+    case TRIGGER_BELOW_UNSIGNED:
+        return !condition->above;
+    case TRIGGER_WINDOW_INSIDE_SIGNED:
+    case TRIGGER_WINDOW_INSIDE_UNSIGNED:
+        return condition->inside;
+    case TRIGGER_WINDOW_OUTSIDE_SIGNED:
+    case TRIGGER_WINDOW_OUTSIDE_UNSIGNED:
+        return !condition->inside;
     default:
-        break;
+        return false;
     }
+}
 
-    if (state == RAMDEBUG_CAPTURE)
+static bool qualifyTrigger(bool result);
+
+// Evaluate all used conditions and combine them. All conditions get evaluated
+// every time, so their edge detection stays up to date.
+static bool evaluateTriggers()
+{
+    bool result = (triggerSettings.combine == TRIGGER_COMBINE_AND);
+
+    for (uint32_t i = 0; i < RAMDEBUG_TRIGGER_CONDITIONS; i++)
     {
-        // Store the buffer index where we started capturing
-        debug_start_index = (debug_write_index - sampleCountPre) % RAMDEBUG_BUFFER_ELEMENTS;
+        if (i > 0 && triggers[i].channel.type == CAPTURE_DISABLED)
+            continue;
+
+        ChannelReader *reader = &readPlan.triggerReaders[i];
+        uint32_t sample = (triggers[i].type == TRIGGER_UNCONDITIONAL) ? 0 : reader->read(reader);
+        bool met = evaluateCondition(&triggers[i], sample);
+
+        if (triggerSettings.combine == TRIGGER_COMBINE_AND)
+            result = result && met;
+        else
+            result = result || met;
     }
 
-    // Store the last threshold comparison value
-    wasAboveSigned   = isAboveSigned;
-    wasAboveUnsigned = isAboveUnsigned;
+    return qualifyTrigger(result);
+}
+
+// Apply the holdoff and the minimum duration to the combined conditions
+static bool qualifyTrigger(bool result)
+{
+    if (triggerSettings.evaluations < triggerSettings.holdoff)
+    {
+        triggerSettings.evaluations++;
+        return false;
+    }
+
+    triggerSettings.duration = (result) ? triggerSettings.duration + 1 : 0;
+
+    return triggerSettings.duration >= MAX(triggerSettings.minDuration, 1);
+}
+
+// This function only gets called by the interrupt handler.
+void handleTriggering()
+{
+    // Abort if not in the right state
+    if (state != RAMDEBUG_TRIGGER)
+        return;
+
+    if (evaluateTriggers())
+    {
+        state = RAMDEBUG_CAPTURE;
+        decimation.triggerPhase = decimation.phase;
+    }
+
+    if (state == RAMDEBUG_CAPTURE)
+    {
+        if (compression.enabled)
+        {
+            // Let the capture begin with a new block, so the trigger point
+            // lies on a block boundary. An empty block already starts there,
+            // skipping it would leave a gap in front of the trigger point.
+            if (compression.bitPos > 0)
+            {
+                state = RAMDEBUG_TRIGGER;
+                nextBlock();
+                state = RAMDEBUG_CAPTURE;
+            }
+
+            debug_start_index = (compression.blockStart - ROUND_UP_BLOCK(sampleCountPre)) % RAMDEBUG_BUFFER_ELEMENTS;
+        }
+        else
+        {
+            if (packing.enabled && packing.slot > 0)
+            {
+                // Close the partially filled word
+                packing.padding = 4 / packing.pointBytes - packing.slot;
+                packing.slot = 0;
+
+                state = RAMDEBUG_TRIGGER;
+                advanceWriteIndex();
+                state = RAMDEBUG_CAPTURE;
+            }
+
+            // Store the buffer index where we started capturing
+            debug_start_index = SEGMENT_BASE + (debug_write_index - SEGMENT_BASE + segments.size - sampleCountPre) % segments.size;
+        }
+
+        segments.start[segments.current]       = debug_start_index;
+        segments.triggerTick[segments.current] = systick_getTick();
+        segments.padding[segments.current]     = packing.padding;
+    }
 }
 
 // This function only gets called by the interrupt handler.
@@ -156,37 +496,470 @@ void handleDebugging()
     if (state == RAMDEBUG_COMPLETE)
         return;
 
-    for (i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    if (statisticsMode)
     {
-        if (channels[i].type == CAPTURE_DISABLED)
-            continue;
+        if (state == RAMDEBUG_CAPTURE)
+            handleStatistics();
+
+        return;
+    }
+
+    if (streaming)
+    {
+        if (state == RAMDEBUG_CAPTURE)
+            handleStreaming();
+
+        return;
+    }
+
+    if (compression.enabled)
+    {
+        handleCompressed();
+        return;
+    }
+
+    if (packing.enabled)
+    {
+        handlePacked();
+        return;
+    }
 
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t count = takeSamplingPoint(samples);
+
+    for (i = 0; i < (int32_t) count; i++)
+    {
         // Add the sample value to the buffer
-        debug_buffer[debug_write_index] = readChannel(channels[i]);
+        debug_buffer[debug_write_index] = samples[i];
 
-        if (++debug_write_index == RAMDEBUG_BUFFER_ELEMENTS)
-        {
-            debug_write_index = 0;
+        if (!advanceWriteIndex())
+            break;
+    }
+}
 
-            // If we filled the entire buffer, the pretrigger phase is finished
-            if (state == RAMDEBUG_PRETRIGGER)
-            {
-                state = RAMDEBUG_TRIGGER;
-            }
+// Move on to the next buffer word. Returns false if that ended the capture
+// of the current segment.
+static bool advanceWriteIndex()
+{
+    if (++debug_write_index == SEGMENT_BASE + segments.size)
+    {
+        debug_write_index = SEGMENT_BASE;
+
+        // If we filled the entire segment, the pretrigger phase is finished
+        if (state == RAMDEBUG_PRETRIGGER)
+        {
+            state = RAMDEBUG_TRIGGER;
         }
+    }
 
-        if (state == RAMDEBUG_CAPTURE)
+    if (state == RAMDEBUG_CAPTURE)
+    {
+        uint32_t samplesWritten = (debug_write_index - debug_start_index + segments.size) % segments.size;
+        if (samplesWritten == 0 || samplesWritten >= sampleCount)
         {
-            uint32_t samplesWritten = (debug_write_index - debug_start_index + RAMDEBUG_BUFFER_ELEMENTS) % RAMDEBUG_BUFFER_ELEMENTS;
-            if (samplesWritten == 0 || samplesWritten >= sampleCount)
+            if (!nextSegment())
             {
                 // End the capture
                 state = RAMDEBUG_COMPLETE;
                 captureEnabled = false;
-                break;
             }
+            return false;
         }
     }
+
+    return true;
+}
+
+// Re-arm the trigger for the next segment. Returns false if all segments are filled.
+static bool nextSegment()
+{
+    if (segments.current + 1 >= segments.count)
+        return false;
+
+    segments.current++;
+    debug_write_index = SEGMENT_BASE;
+    packing.slot      = 0;
+    packing.padding   = 0;
+
+    armTriggers();
+    state = RAMDEBUG_PRETRIGGER;
+
+    return true;
+}
+
+static void handlePacked()
+{
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t point[RAMDEBUG_MAX_CHANNELS] = { 0 };
+    uint8_t *bytes = (uint8_t *) point;
+    uint32_t offset = 0;
+    uint32_t count = takeSamplingPoint(samples);
+
+    // Assemble the sampling point (little endian, like the buffer words)
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t value = samples[i];
+        for (uint32_t j = 0; j < storageWidths[readPlan.channel[i]] / 8; j++)
+        {
+            bytes[offset++] = value & 0xFF;
+            value >>= 8;
+        }
+    }
+
+    if (packing.pointBytes < 4)
+    {
+        // Several sampling points per word
+        if (packing.slot == 0)
+            debug_buffer[debug_write_index] = 0;
+
+        debug_buffer[debug_write_index] |= point[0] << (packing.slot * packing.pointBytes * 8);
+
+        if (++packing.slot < 4 / packing.pointBytes)
+            return;
+
+        packing.slot = 0;
+        advanceWriteIndex();
+        return;
+    }
+
+    for (uint32_t i = 0; i < packing.pointBytes / 4; i++)
+    {
+        debug_buffer[debug_write_index] = point[i];
+
+        if (!advanceWriteIndex())
+            break;
+    }
+}
+
+static void resetStatistics()
+{
+    statisticsCount = 0;
+    memset(statistics, 0, sizeof(statistics));
+}
+
+// Feed one sampling point into the statistics
+static void handleStatistics()
+{
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t count = takeSamplingPoint(samples);
+
+    statisticsCount++;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t value = samples[i];
+        uint8_t channel = readPlan.channel[i];
+
+        if (statisticsCount == 1)
+        {
+            statistics[i].min = value;
+            statistics[i].max = value;
+        }
+        else
+        {
+            statistics[i].min = MIN(statistics[i].min, value);
+            statistics[i].max = MAX(statistics[i].max, value);
+        }
+
+        // Welford's algorithm
+        float delta = (float) value - statistics[i].mean;
+        statistics[i].mean += delta / statisticsCount;
+        statistics[i].m2   += delta * ((float) value - statistics[i].mean);
+
+        int64_t bin = ((int64_t) value - histograms[channel].lowerBound) >> histograms[channel].shift;
+        bin = MAX(bin, 0);
+        bin = MIN(bin, RAMDEBUG_HISTOGRAM_BINS - 1);
+        statistics[i].bins[bin]++;
+    }
+}
+
+// Write one sampling point into the stream buffer. If the main loop did not
+// send out the older samples fast enough, the whole sampling point is dropped.
+static void handleStreaming()
+{
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t written = streamWritten;
+
+    if ((streamWritten - streamRead) + streamSetSize > RAMDEBUG_BUFFER_ELEMENTS)
+    {
+        streamOverflows++;
+        if (decimation.enabled)
+            resetDecimation();
+        return;
+    }
+
+    uint32_t count = takeSamplingPoint(samples);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        debug_buffer[written % RAMDEBUG_BUFFER_ELEMENTS] = samples[i];
+        written++;
+    }
+
+    // Publish the sampling point only once it is complete
+    streamWritten     = written;
+    debug_write_index = written % RAMDEBUG_BUFFER_ELEMENTS;
+}
+
+// Append the lowest count bits of value to a zeroed bitstream
+static inline void putBits(uint32_t *words, uint32_t *bitPos, uint32_t value, uint8_t count)
+{
+    uint32_t index = *bitPos / 32;
+    uint32_t shift = *bitPos % 32;
+
+    if (count < 32)
+        value &= (1UL << count) - 1;
+
+    words[index] |= value << shift;
+    if (shift + count > 32)
+        words[index + 1] |= value >> (32 - shift);
+
+    *bitPos += count;
+}
+
+// Encode a sampling point into a zeroed bitstream, updating the previous values.
+// Returns the amount of bits used.
+static uint32_t encodePoint(uint32_t *samples, uint32_t *previous, uint32_t *words)
+{
+    uint32_t bitPos = 0;
+    uint32_t j = 0;
+
+    for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    {
+        if (channels[i].type == CAPTURE_DISABLED)
+            continue;
+
+        uint32_t value = samples[j++];
+
+        switch (encodings[i].encoding)
+        {
+        case ENCODING_WIDTH:
+            putBits(words, &bitPos, value, encodings[i].width);
+            break;
+        case ENCODING_DELTA:
+        {
+            int32_t delta = (int32_t) (value - previous[i]);
+            uint32_t zigzag = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+            do {
+                uint32_t byte = zigzag & 0x7F;
+                zigzag >>= 7;
+                putBits(words, &bitPos, (zigzag) ? (byte | 0x80) : byte, 8);
+            } while (zigzag);
+            break;
+        }
+        case ENCODING_REPEAT:
+            if (encodings[i].width < 32)
+                value &= (1UL << encodings[i].width) - 1;
+
+            if (value == previous[i])
+            {
+                putBits(words, &bitPos, 1, 1);
+            }
+            else
+            {
+                putBits(words, &bitPos, 0, 1);
+                putBits(words, &bitPos, value, encodings[i].width);
+            }
+            break;
+        case ENCODING_RAW:
+        default:
+            putBits(words, &bitPos, value, 32);
+            break;
+        }
+
+        previous[i] = value;
+    }
+
+    return bitPos;
+}
+
+static void startBlock(uint32_t index)
+{
+    memset(&debug_buffer[index], 0, RAMDEBUG_BLOCK_WORDS * sizeof(uint32_t));
+    memset(compression.previous, 0, sizeof(compression.previous));
+
+    compression.blockStart = index;
+    compression.bitPos     = 0;
+    debug_write_index      = index + 1;
+}
+
+// Advance to the next block. Returns false if that ended the capture.
+static bool nextBlock()
+{
+    uint32_t next = (compression.blockStart + RAMDEBUG_BLOCK_WORDS) % RAMDEBUG_BUFFER_ELEMENTS;
+
+    // If we filled the entire buffer, the pretrigger phase is finished
+    if (next == 0 && state == RAMDEBUG_PRETRIGGER)
+    {
+        state = RAMDEBUG_TRIGGER;
+    }
+
+    if (state == RAMDEBUG_CAPTURE)
+    {
+        uint32_t samplesWritten = (next - debug_start_index + RAMDEBUG_BUFFER_ELEMENTS) % RAMDEBUG_BUFFER_ELEMENTS;
+        if (samplesWritten == 0 || samplesWritten >= sampleCount)
+        {
+            // End the capture
+            state = RAMDEBUG_COMPLETE;
+            captureEnabled = false;
+            debug_write_index = next;
+            return false;
+        }
+    }
+
+    startBlock(next);
+
+    return true;
+}
+
+static void handleCompressed()
+{
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t previous[RAMDEBUG_MAX_CHANNELS];
+    uint32_t point[POINT_WORDS_MAX] = { 0 };
+    uint32_t bits;
+
+    takeSamplingPoint(samples);
+
+    memcpy(previous, compression.previous, sizeof(previous));
+    bits = encodePoint(samples, previous, point);
+
+    if (compression.bitPos + bits > BLOCK_BITS)
+    {
+        // Sampling points do not span blocks. Encode again for the new block,
+        // the previous values got reset.
+        if (!nextBlock())
+            return;
+
+        memset(point, 0, sizeof(point));
+        memcpy(previous, compression.previous, sizeof(previous));
+        bits = encodePoint(samples, previous, point);
+    }
+
+    for (uint32_t i = 0; i < bits; i += 32)
+    {
+        putBits(&debug_buffer[compression.blockStart + 1], &compression.bitPos, point[i / 32], MIN(bits - i, 32));
+    }
+
+    memcpy(compression.previous, previous, sizeof(previous));
+    debug_buffer[compression.blockStart]++;
+    debug_write_index = (compression.blockStart + 1 + (compression.bitPos + 31) / 32) % RAMDEBUG_BUFFER_ELEMENTS;
+}
+
+static void resetTiming()
+{
+    timing.started       = false;
+    timing.interval      = 0;
+    timing.missedTicks   = 0;
+    timing.lateSamples   = 0;
+    timing.intervalMin   = UINT32_MAX;
+    timing.intervalMax   = 0;
+    timing.intervalSum   = 0;
+    timing.intervalCount = 0;
+    timing.readCyclesMax = 0;
+    timing.readCyclesSum = 0;
+    timing.readCount     = 0;
+}
+
+static void updateTiming()
+{
+    uint32_t now = systick_getCycleTick();
+
+    if (!timing.started)
+    {
+        timing.started    = true;
+        timing.lastSample = now;
+        return;
+    }
+
+    timing.interval   = now - timing.lastSample;
+    timing.lastSample = now;
+
+    timing.intervalMin = MIN(timing.intervalMin, timing.interval);
+    timing.intervalMax = MAX(timing.intervalMax, timing.interval);
+    timing.intervalSum += timing.interval;
+    timing.intervalCount++;
+
+    // Nominal interval: prescaler * cycle frequency / sampling frequency
+    uint64_t nominal = (uint64_t) prescaler * systick_getCycleFrequency() / MAX(frequency, 1);
+    if (timing.interval > nominal + nominal / 2)
+        timing.lateSamples++;
+}
+
+static void resetDecimation()
+{
+    decimation.count = 0;
+    for (uint32_t i = 0; i < readPlan.channelCount; i++)
+    {
+        decimation.sum[i] = 0;
+        decimation.min[i] = INT32_MAX;
+        decimation.max[i] = INT32_MIN;
+    }
+}
+
+static void accumulateSamplingPoint()
+{
+    uint32_t samples[RAMDEBUG_MAX_CHANNELS];
+    uint32_t count = readSamplingPoint(samples);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t value = samples[i];
+
+        decimation.last[i] = samples[i];
+        decimation.sum[i] += value;
+        decimation.min[i] = MIN(decimation.min[i], value);
+        decimation.max[i] = MAX(decimation.max[i], value);
+    }
+
+    decimation.count++;
+}
+
+// Get the sampling point to store. Without decimation the channels are read,
+// otherwise the accumulated readings get evaluated and reset.
+static uint32_t takeSamplingPoint(uint32_t *samples)
+{
+    if (!decimation.enabled)
+        return readSamplingPoint(samples);
+
+    // No reading since the last sampling point (e.g. prescaler changed)
+    if (decimation.count == 0)
+        accumulateSamplingPoint();
+
+    for (uint32_t i = 0; i < readPlan.channelCount; i++)
+    {
+        uint8_t channel = readPlan.channel[i];
+
+        // Timestamps always belong to the stored sampling point
+        switch ((channels[channel].type == CAPTURE_TIMESTAMP) ? DECIMATION_SKIP : decimationModes[channel])
+        {
+        case DECIMATION_AVERAGE:
+            samples[i] = (int32_t) (decimation.sum[i] / (int64_t) decimation.count);
+            break;
+        case DECIMATION_MIN:
+            samples[i] = decimation.min[i];
+            break;
+        case DECIMATION_MAX:
+            samples[i] = decimation.max[i];
+            break;
+        case DECIMATION_PEAK:
+            samples[i] = (decimation.phase)
+                    ? MAX(decimation.max[i], decimation.previousMax[i])
+                    : MIN(decimation.min[i], decimation.previousMin[i]);
+            break;
+        case DECIMATION_SKIP:
+        default:
+            samples[i] = decimation.last[i];
+            break;
+        }
+
+        decimation.previousMin[i] = decimation.min[i];
+        decimation.previousMax[i] = decimation.max[i];
+    }
+
+    decimation.phase = !decimation.phase;
+    resetDecimation();
+
+    return readPlan.channelCount;
 }
 
 void debug_process()
@@ -215,7 +988,7 @@ void debug_process()
         // index wraps back to zero and does not allow this check to succeed.
         // For that case the moving write pointer logic takes care of updating
         // the state.
-        if (debug_write_index >= sampleCountPre)
+        if (debug_write_index - SEGMENT_BASE >= sampleCountPre)
         {
             state = RAMDEBUG_TRIGGER;
         }
@@ -224,7 +997,23 @@ void debug_process()
     handleTriggering();
 
     // Increment and check the prescaler counter
-    if (++prescalerCount < prescaler)
+    bool store = ++prescalerCount >= prescaler;
+
+    // Streams and statistics only use sampling points after the trigger
+    bool storing = !((streaming || statisticsMode) && state != RAMDEBUG_CAPTURE);
+
+    if (store && storing)
+        updateTiming();
+
+    // Decimating channels get read on every call
+    if (decimation.enabled && storing)
+    {
+        processing = true;
+        accumulateSamplingPoint();
+        processing = false;
+    }
+
+    if (!store)
         return;
 
     processing = true;
@@ -236,84 +1025,314 @@ void debug_process()
     processing = false;
 }
 
-static inline uint32_t readChannel(Channel channel)
+// Channel readers
+// The channel configuration gets resolved once into a read function with its
+// arguments (board functions, motor, addresses), so reading a sampling point
+// is a loop of direct calls.
+static uint32_t readDisabledChannel(const ChannelReader *reader)
+{
+    UNUSED(reader);
+    return 0;
+}
+
+static uint32_t readParameterChannel(const ChannelReader *reader)
+{
+    uint32_t sample = 0;
+    reader->board->GAP(reader->address, reader->motor, (int32_t *)&sample);
+    return sample;
+}
+
+static uint32_t readRegisterChannel(const ChannelReader *reader)
+{
+    uint32_t sample = 0;
+    reader->board->readRegister(reader->motor, reader->address, (int32_t *)&sample);
+    return sample;
+}
+
+static uint32_t readStackedRegisterChannel(const ChannelReader *reader)
+{
+    uint32_t sample = 0;
+
+    // Backup the stacked address
+    uint32_t oldAddress = 0;
+    reader->board->readRegister(reader->motor, reader->stackAddress, (int32_t *)&oldAddress);
+
+    // Write the new stacked address
+    reader->board->writeRegister(reader->motor, reader->stackAddress, reader->stackIndex);
+
+    // Read the stacked data register
+    reader->board->readRegister(reader->motor, reader->address, (int32_t *)&sample);
+
+    // Restore the stacked address
+    reader->board->writeRegister(reader->motor, reader->stackAddress, oldAddress);
+
+    return sample;
+}
+
+static uint32_t readSystickChannel(const ChannelReader *reader)
+{
+    UNUSED(reader);
+    return systick_getTick();//systick_getTimer10ms();
+}
+
+static uint32_t readTimestampChannel(const ChannelReader *reader)
+{
+    UNUSED(reader);
+    return timing.interval;
+}
+
+static uint32_t readAnalogChannel(const ChannelReader *reader)
+{
+    return *reader->analogValue;
+}
+
+static void compileChannel(Channel channel, ChannelReader *reader)
 {
-    uint32_t sample = 0;
+    reader->read         = readDisabledChannel;
+    reader->board        = (channel.eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1);
+    reader->motor        = channel.address >> 24;
+    reader->address      = channel.address;
+    reader->stackAddress = channel.address >> 8;
+    reader->stackIndex   = channel.address >> 16;
+    reader->analogValue  = NULL;
 
     switch (channel.type)
     {
     case CAPTURE_PARAMETER:
-    {
-        uint8_t motor   = (channel.address >> 24) & 0xFF;
-        uint8_t type    = (channel.address >> 0) & 0xFF;
-
-        ((channel.eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1))->GAP(type, motor, (int32_t *)&sample);
-
+        reader->read    = readParameterChannel;
+        reader->address = channel.address & 0xFF;
         break;
-    }
     case CAPTURE_REGISTER:
-    {
-        uint8_t motor = channel.address >> 24;
-
-        ((channel.eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1))->readRegister(motor, channel.address, (int32_t *)&sample);
-
+        reader->read    = readRegisterChannel;
         break;
-    }
     case CAPTURE_STACKED_REGISTER:
-    {
-        uint8_t motor                  = channel.address >> 24;
-        uint8_t stackedRegisterValue   = channel.address >> 16;
-        uint8_t stackedRegisterAddress = channel.address >> 8;
-        uint8_t dataRegisterAddress    = channel.address >> 0;
-
-        EvalboardFunctionsTypeDef *ch = (channel.eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1);
-
-        // Backup the stacked address
-        uint32_t oldAddress = 0;
-        ch->readRegister(motor, stackedRegisterAddress, (int32_t *)&oldAddress);
-
-        // Write the new stacked address
-        ch->writeRegister(motor, stackedRegisterAddress, stackedRegisterValue);
-
-        // Read the stacked data register
-        ch->readRegister(motor, dataRegisterAddress, (int32_t *)&sample);
-
-        // Restore the stacked address
-        ch->writeRegister(motor, stackedRegisterAddress, oldAddress);
+        reader->read    = readStackedRegisterChannel;
+        reader->address = channel.address & 0xFF;
         break;
-    }
     case CAPTURE_SYSTICK:
-        sample = systick_getTick();//systick_getTimer10ms();
+        reader->read    = readSystickChannel;
+        break;
+    case CAPTURE_TIMESTAMP:
+        reader->read    = readTimestampChannel;
         break;
     case CAPTURE_ANALOG_INPUT:
         // Use same indices as in TMCL.c GetInput()
         switch(channel.address) {
         case 0:
-            sample = *HAL.ADCs->AIN0;
+            reader->analogValue = HAL.ADCs->AIN0;
             break;
         case 1:
-            sample = *HAL.ADCs->AIN1;
+            reader->analogValue = HAL.ADCs->AIN1;
             break;
         case 2:
-            sample = *HAL.ADCs->AIN2;
+            reader->analogValue = HAL.ADCs->AIN2;
             break;
         case 3:
-            sample = *HAL.ADCs->DIO4;
+            reader->analogValue = HAL.ADCs->DIO4;
             break;
         case 4:
-            sample = *HAL.ADCs->DIO5;
+            reader->analogValue = HAL.ADCs->DIO5;
             break;
         case 6:
-            sample = *HAL.ADCs->VM;
+            reader->analogValue = HAL.ADCs->VM;
             break;
         }
+
+        if (reader->analogValue)
+            reader->read = readAnalogChannel;
         break;
     default:
-        sample = 0;
         break;
     }
+}
 
-    return sample;
+// Single reads outside of a capture. Captures and triggers use the readers
+// compiled by buildReadPlan() when the capture gets armed.
+static inline uint32_t readChannel(Channel channel)
+{
+    ChannelReader reader;
+
+    compileChannel(channel, &reader);
+
+    return reader.read(&reader);
+}
+
+static void buildReadPlan()
+{
+    memset(&readPlan, 0, sizeof(readPlan));
+
+    for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    {
+        if (channels[i].type != CAPTURE_DISABLED)
+            readPlan.channel[readPlan.channelCount++] = i;
+    }
+
+    for (uint32_t slot = 0; slot < readPlan.channelCount; slot++)
+    {
+        Channel *channel = &channels[readPlan.channel[slot]];
+
+        if (channel->type != CAPTURE_REGISTER || readPlan.grouped[slot])
+            continue;
+
+        // Collect the register channels of the same evalboard channel and motor
+        ReadGroup group = {
+            .eval_channel = channel->eval_channel,
+            .motor        = channel->address >> 24,
+            .count        = 0
+        };
+
+        for (uint32_t other = slot; other < readPlan.channelCount; other++)
+        {
+            Channel *candidate = &channels[readPlan.channel[other]];
+
+            if (candidate->type != CAPTURE_REGISTER
+            || candidate->eval_channel != group.eval_channel
+            || (candidate->address >> 24) != group.motor)
+                continue;
+
+            group.addresses[group.count] = candidate->address;
+            group.slots[group.count]     = other;
+            group.count++;
+        }
+
+        // A single register gains nothing from being grouped
+        if (group.count < 2)
+            continue;
+
+        for (uint32_t j = 0; j < group.count; j++)
+            readPlan.grouped[group.slots[j]] = true;
+
+        readPlan.groups[readPlan.groupCount++] = group;
+    }
+
+    for (uint32_t slot = 0; slot < readPlan.channelCount; slot++)
+    {
+        Channel *channel = &channels[readPlan.channel[slot]];
+
+        if (channel->type != CAPTURE_STACKED_REGISTER || readPlan.grouped[slot])
+            continue;
+
+        // Collect the stacked register channels using the same stack pointer register
+        StackGroup *group = &readPlan.stackGroups[readPlan.stackGroupCount++];
+        group->eval_channel = channel->eval_channel;
+        group->motor        = channel->address >> 24;
+        group->stackAddress = channel->address >> 8;
+        group->count        = 0;
+
+        for (uint32_t other = slot; other < readPlan.channelCount; other++)
+        {
+            Channel *candidate = &channels[readPlan.channel[other]];
+
+            if (candidate->type != CAPTURE_STACKED_REGISTER
+            || candidate->eval_channel != group->eval_channel
+            || (uint8_t) (candidate->address >> 24) != group->motor
+            || (uint8_t) (candidate->address >> 8) != group->stackAddress)
+                continue;
+
+            group->indices[group->count]       = candidate->address >> 16;
+            group->dataAddresses[group->count] = candidate->address;
+            group->slots[group->count]         = other;
+            group->count++;
+
+            readPlan.grouped[other] = true;
+        }
+    }
+
+    for (uint32_t slot = 0; slot < readPlan.channelCount; slot++)
+    {
+        if (readPlan.grouped[slot])
+            continue;
+
+        compileChannel(channels[readPlan.channel[slot]], &readPlan.readers[readPlan.readerCount]);
+        readPlan.readerSlots[readPlan.readerCount] = slot;
+        readPlan.readerCount++;
+    }
+
+    // The trigger channels get evaluated on every call as well
+    for (uint32_t i = 0; i < RAMDEBUG_TRIGGER_CONDITIONS; i++)
+        compileChannel(triggers[i].channel, &readPlan.triggerReaders[i]);
+}
+
+static void readStackGroup(StackGroup *group, uint32_t *samples)
+{
+    EvalboardFunctionsTypeDef *ch = (group->eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1);
+
+    // Backup the stack pointer
+    uint32_t oldIndex = 0;
+    ch->readRegister(group->motor, group->stackAddress, (int32_t *)&oldIndex);
+
+    uint32_t index = oldIndex;
+    for (uint32_t i = 0; i < group->count; i++)
+    {
+        if (index != group->indices[i])
+        {
+            index = group->indices[i];
+            ch->writeRegister(group->motor, group->stackAddress, index);
+        }
+
+        ch->readRegister(group->motor, group->dataAddresses[i], (int32_t *)&samples[group->slots[i]]);
+    }
+
+    // Restore the stack pointer
+    if (index != oldIndex)
+        ch->writeRegister(group->motor, group->stackAddress, oldIndex);
+}
+
+// Read all enabled channels, following the read plan.
+// Returns the amount of samples.
+static uint32_t readSamplingPoint(uint32_t *samples)
+{
+    uint32_t startCycles = systick_getCycleTick();
+
+    for (uint32_t i = 0; i < readPlan.readerCount; i++)
+    {
+        ChannelReader *reader = &readPlan.readers[i];
+        samples[readPlan.readerSlots[i]] = reader->read(reader);
+    }
+
+    for (uint32_t i = 0; i < readPlan.groupCount; i++)
+    {
+        ReadGroup *group = &readPlan.groups[i];
+        EvalboardFunctionsTypeDef *ch = (group->eval_channel == 1) ? (&Evalboards.ch2) : (&Evalboards.ch1);
+        int32_t values[RAMDEBUG_MAX_CHANNELS];
+
+        if (ch->readRegisters)
+        {
+            ch->readRegisters(group->motor, group->addresses, values, group->count);
+        }
+        else
+        {
+            for (uint32_t j = 0; j < group->count; j++)
+                ch->readRegister(group->motor, group->addresses[j], &values[j]);
+        }
+
+        for (uint32_t j = 0; j < group->count; j++)
+            samples[group->slots[j]] = values[j];
+    }
+
+    for (uint32_t i = 0; i < readPlan.stackGroupCount; i++)
+        readStackGroup(&readPlan.stackGroups[i], samples);
+
+    // Cost of reading a sampling point
+    uint32_t cycles = systick_getCycleTick() - startCycles;
+    timing.readCyclesMax = MAX(timing.readCyclesMax, cycles);
+    timing.readCyclesSum += cycles;
+    timing.readCount++;
+
+    return readPlan.channelCount;
+}
+
+// Sample a single value outside of a capture, using the same channel
+// configuration format as the capture channels.
+uint32_t debug_readChannel(uint8_t type, uint8_t eval_channel, uint32_t address)
+{
+    Channel channel = {
+        .type          = type,
+        .eval_channel  = eval_channel,
+        .address       = address
+    };
+
+    return readChannel(channel);
 }
 
 // === Interfacing with the debugger ===========================================
@@ -324,6 +1343,14 @@ void debug_init()
     // Disable data capture before changing the configuration
     captureEnabled = false;
 
+    if (adcCapture.running)
+    {
+        HAL.ADCs->stopCapture();
+        adcCapture.running = false;
+    }
+    adcCapture.frequency = 0;
+    adcCapture.slot      = 0;
+
     // Reset the RAMDebug state
     state = RAMDEBUG_IDLE;
 
@@ -339,19 +1366,58 @@ void debug_init()
     sampleCount = RAMDEBUG_BUFFER_ELEMENTS;
     sampleCountPre = 0;
 
+    // Reset the segmentation
+    segments.configured = 1;
+    segments.count      = 1;
+    segments.current    = 0;
+    segments.size       = RAMDEBUG_BUFFER_ELEMENTS;
+
+    // Reset the statistics mode
+    statisticsMode  = false;
+    resetStatistics();
+    for (i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    {
+        histograms[i].lowerBound = 0;
+        histograms[i].shift      = 0;
+    }
+
+    // Reset the streaming mode
+    streaming       = false;
+    streamSetSize   = 0;
+    streamWritten   = 0;
+    streamRead      = 0;
+    streamOverflows = 0;
+
     // Reset the channel configuration
     for (i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
     {
         channels[i].type = CAPTURE_DISABLED;
         channels[i].eval_channel = 0;
         channels[i].address = 0;
+        encodings[i].encoding = ENCODING_RAW;
+        encodings[i].width = 32;
+        storageWidths[i] = 32;
+        decimationModes[i] = DECIMATION_SKIP;
     }
+    compression.enabled = false;
+    packing.enabled = false;
 
     // Reset the trigger
-    trigger.channel.type     = CAPTURE_DISABLED;
-    trigger.channel.address  = 0;
-    trigger.mask             = 0xFFFFFFFF;
-    trigger.shift            = 0;
+    for (i = 0; i < RAMDEBUG_TRIGGER_CONDITIONS; i++)
+    {
+        triggers[i].channel.type     = CAPTURE_DISABLED;
+        triggers[i].channel.address  = 0;
+        triggers[i].type             = TRIGGER_UNCONDITIONAL;
+        triggers[i].threshold        = 0;
+        triggers[i].thresholdHigh    = 0;
+        triggers[i].hysteresis       = 0;
+        triggers[i].mask             = 0xFFFFFFFF;
+        triggers[i].shift            = 0;
+    }
+    triggerSettings.selected    = 0;
+    triggerSettings.combine     = TRIGGER_COMBINE_AND;
+    triggerSettings.holdoff     = 0;
+    triggerSettings.minDuration = 0;
 
     global_enable = true;
 }
@@ -450,7 +1516,7 @@ int32_t debug_getChannelType(uint8_t index, uint8_t *type)
 {
     if (index == 0xFF)
     {
-        *type = trigger.channel.type;
+        *type = selectedTrigger()->channel.type;
         return 1;
     }
 
@@ -466,7 +1532,7 @@ int32_t debug_getChannelAddress(uint8_t index, uint32_t *address)
 {
     if (index == 0xFF)
     {
-        *address = trigger.channel.address;
+        *address = selectedTrigger()->channel.address;
         return 1;
     }
 
@@ -489,7 +1555,7 @@ bool debug_setTriggerType(uint8_t type)
     // ToDo: Type-specific address verification logic?
 
     // Store the trigger configuration
-    trigger.channel.type     = type;
+    selectedTrigger()->channel.type     = type;
 
     return true;
 }
@@ -502,7 +1568,7 @@ bool debug_setTriggerEvalChannel(uint8_t eval_channel)
     // ToDo: Type-specific address verification logic?
 
     // Store the trigger configuration
-    trigger.channel.eval_channel     = eval_channel;
+    selectedTrigger()->channel.eval_channel     = eval_channel;
 
     return true;
 }
@@ -515,42 +1581,326 @@ bool debug_setTriggerAddress(uint32_t address)
     // ToDo: Type-specific address verification logic?
 
     // Store the trigger configuration
-    trigger.channel.address     = address;
+    selectedTrigger()->channel.address     = address;
 
     return true;
 }
 
 void debug_setTriggerMaskShift(uint32_t mask, uint8_t shift)
 {
-    trigger.mask  = mask;
-    trigger.shift = shift;
+    selectedTrigger()->mask  = mask;
+    selectedTrigger()->shift = shift;
+}
+
+bool debug_selectTriggerCondition(uint8_t index)
+{
+    if (index >= RAMDEBUG_TRIGGER_CONDITIONS)
+        return false;
+
+    triggerSettings.selected = index;
+
+    return true;
+}
+
+bool debug_setTriggerCondition(uint8_t type)
+{
+    if (type >= TRIGGER_END)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    selectedTrigger()->type = type;
+
+    return true;
+}
+
+bool debug_setTriggerThreshold(uint32_t threshold)
+{
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    selectedTrigger()->threshold = threshold;
+
+    return true;
+}
+
+bool debug_setTriggerThresholdHigh(uint32_t threshold)
+{
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    selectedTrigger()->thresholdHigh = threshold;
+
+    return true;
+}
+
+bool debug_setTriggerHysteresis(uint32_t hysteresis)
+{
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    selectedTrigger()->hysteresis = hysteresis;
+
+    return true;
+}
+
+bool debug_setTriggerCombine(uint8_t combine)
+{
+    if (combine >= TRIGGER_COMBINE_END)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    triggerSettings.combine = combine;
+
+    return true;
+}
+
+void debug_setTriggerHoldoff(uint32_t evaluations)
+{
+    triggerSettings.holdoff = evaluations;
+}
+
+void debug_setTriggerMinDuration(uint32_t evaluations)
+{
+    triggerSettings.minDuration = evaluations;
+}
+
+// Handle a buffer half filled by the ADC DMA. Called from the DMA interrupt.
+static void handleAdcHalf(uint32_t half)
+{
+    uint16_t *conversions = (uint16_t *) debug_buffer + half * ADC_HALF_SAMPLES;
+    uint32_t pretrigger = 2 * sampleCountPre;
+
+    // The DMA interrupts alternate between the halves
+    if (half != (adcCapture.converted / ADC_HALF_SAMPLES) % 2)
+        return;
+
+    for (uint32_t i = 0; i < ADC_HALF_SAMPLES; i++)
+    {
+        uint32_t n = adcCapture.converted + i;
+
+        if (state == RAMDEBUG_PRETRIGGER)
+        {
+            if (n < pretrigger)
+                continue;
+
+            state = RAMDEBUG_TRIGGER;
+        }
+
+        if (state != RAMDEBUG_TRIGGER)
+            break;
+
+        if (!adcCapture.primed)
+        {
+            updateTriggerState(&triggers[0], conversions[i], true);
+            adcCapture.primed = true;
+        }
+
+        if (qualifyTrigger(evaluateCondition(&triggers[0], conversions[i])))
+        {
+            state = RAMDEBUG_CAPTURE;
+
+            // Start the capture on a word boundary
+            adcCapture.start = (n - pretrigger) & ~1UL;
+            adcCapture.slot  = n - pretrigger - adcCapture.start;
+            adcCapture.end   = adcCapture.start + 2 * sampleCount;
+
+            debug_start_index  = (adcCapture.start % ADC_RING_SAMPLES) / 2;
+            segments.start[0]  = debug_start_index;
+            segments.triggerTick[0] = systick_getTick();
+        }
+    }
+
+    adcCapture.converted += ADC_HALF_SAMPLES;
+
+    if (state == RAMDEBUG_CAPTURE)
+    {
+        uint32_t end = MIN(adcCapture.converted, adcCapture.end);
+
+        debug_write_index = (end % ADC_RING_SAMPLES) / 2;
+
+        if (adcCapture.converted >= adcCapture.end)
+        {
+            HAL.ADCs->stopCapture();
+            adcCapture.running = false;
+            state = RAMDEBUG_COMPLETE;
+        }
+    }
+}
+
+static int32_t startAdcCapture()
+{
+    if (streaming || statisticsMode || HAL.ADCs->startCapture == NULL)
+        return 0;
+
+    segments.count = 1;
+    segments.size  = RAMDEBUG_BUFFER_ELEMENTS;
+
+    sampleCount    = MIN(sampleCount, RAMDEBUG_ADC_MAX_SAMPLES);
+    sampleCountPre = MIN(sampleCountPre, sampleCount);
+
+    adcCapture.primed    = false;
+    adcCapture.converted = 0;
+    adcCapture.slot      = 0;
+    debug_write_index    = 0;
+
+    // The DMA interrupts may hit right away
+    state = RAMDEBUG_PRETRIGGER;
+
+    if (!HAL.ADCs->startCapture(adcCapture.input, adcCapture.frequency, (uint16_t *) debug_buffer, ADC_RING_SAMPLES, handleAdcHalf))
+    {
+        state = RAMDEBUG_IDLE;
+        return 0;
+    }
+
+    adcCapture.running = true;
+
+    return 1;
+}
+
+// Initialize the trigger helper variables. Uses the trigger readers of the read plan.
+static void armTriggers()
+{
+    for (uint32_t i = 0; i < RAMDEBUG_TRIGGER_CONDITIONS; i++)
+    {
+        ChannelReader *reader = &readPlan.triggerReaders[i];
+
+        if (triggers[i].type != TRIGGER_UNCONDITIONAL && triggers[i].channel.type != CAPTURE_DISABLED)
+            updateTriggerState(&triggers[i], reader->read(reader), true);
+    }
+    triggerSettings.evaluations = 0;
+    triggerSettings.duration    = 0;
 }
 
-int32_t debug_enableTrigger(uint8_t type, uint32_t threshold)
-{
-    // Parameter validation
-    if (type >= TRIGGER_END)
-        return 0;
+int32_t debug_enableTrigger(uint8_t type, uint32_t threshold)
+{
+    // Parameter validation
+    if (type >= TRIGGER_END)
+        return 0;
+
+    if (state != RAMDEBUG_IDLE)
+        return 0;
+
+    // Do not allow the edge triggers with channel still missing
+    if (type != TRIGGER_UNCONDITIONAL && triggers[0].channel.type == CAPTURE_DISABLED && adcCapture.frequency == 0)
+        return 0;
+
+    // Store the trigger configuration. Arming always configures condition 0.
+    triggers[0].type = type;
+    triggers[0].threshold = threshold;
+
+    buildReadPlan();
+    armTriggers();
+    resetTiming();
+
+    decimation.enabled = false;
+    for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    {
+        if (channels[i].type != CAPTURE_DISABLED && decimationModes[i] != DECIMATION_SKIP)
+            decimation.enabled = true;
+    }
+    decimation.phase        = false;
+    decimation.triggerPhase = false;
+    resetDecimation();
+    for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+    {
+        // The first peak detection values only cover their own interval
+        decimation.previousMin[i] = INT32_MAX;
+        decimation.previousMax[i] = INT32_MIN;
+    }
+
+    // Streams are sent raw, only buffered captures get compressed or packed
+    compression.enabled = false;
+    packing.enabled = false;
+    packing.padding = 0;
+
+    segments.count   = segments.configured;
+    segments.current = 0;
+    segments.size    = RAMDEBUG_BUFFER_ELEMENTS / segments.count;
+
+    if (adcCapture.frequency != 0)
+        return startAdcCapture();
+
+    if (statisticsMode)
+    {
+        resetStatistics();
+
+        // Statistics have no pretrigger phase and do not use the buffer
+        segments.count = 1;
+        segments.size  = RAMDEBUG_BUFFER_ELEMENTS;
+        state = RAMDEBUG_TRIGGER;
+    }
+    else if (streaming)
+    {
+        // Count the samples per sampling point for the stream framing
+        streamSetSize = 0;
+        for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+        {
+            if (channels[i].type != CAPTURE_DISABLED)
+                streamSetSize++;
+        }
+
+        // A stream has no pretrigger phase and uses the entire buffer
+        segments.count = 1;
+        segments.size  = RAMDEBUG_BUFFER_ELEMENTS;
+        state = RAMDEBUG_TRIGGER;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+        {
+            if (channels[i].type != CAPTURE_DISABLED && encodings[i].encoding != ENCODING_RAW)
+                compression.enabled = true;
+        }
+
+        if (compression.enabled)
+        {
+            // Compressed captures use a single segment
+            segments.count = 1;
+            segments.size  = RAMDEBUG_BUFFER_ELEMENTS;
+
+            // Compressed captures consist of whole blocks
+            sampleCount = MIN(ROUND_UP_BLOCK(sampleCount), RAMDEBUG_BUFFER_ELEMENTS);
+            startBlock(0);
+        }
+        else
+        {
+            sampleCount    = MIN(sampleCount, segments.size);
+            sampleCountPre = MIN(sampleCountPre, sampleCount);
+            debug_write_index = 0;
 
-    if (state != RAMDEBUG_IDLE)
-        return 0;
+            uint32_t pointBytes = 0;
+            for (uint32_t i = 0; i < RAMDEBUG_MAX_CHANNELS; i++)
+            {
+                if (channels[i].type == CAPTURE_DISABLED)
+                    continue;
 
-    // Do not allow the edge triggers with channel still missing
-    if (type != TRIGGER_UNCONDITIONAL && trigger.channel.type == CAPTURE_DISABLED)
-        return 0;
+                pointBytes += storageWidths[i] / 8;
+                if (storageWidths[i] != 32)
+                    packing.enabled = true;
+            }
 
-    // Store the trigger configuration
-    trigger.type = type;
-    trigger.threshold = threshold;
+            // 1 and 2 byte sampling points share words, the others get padded to whole words
+            packing.pointBytes = (pointBytes <= 2) ? pointBytes : ((pointBytes + 3) & ~3UL);
+            packing.slot       = 0;
 
-    // Initialize the trigger helper variable
-    // Read out the trigger value and apply the mask/shift
-    int32_t triggerValue = (readChannel(trigger.channel) & trigger.mask) >> trigger.shift;
-    wasAboveSigned   = (int32_t)  triggerValue > (int32_t)  trigger.threshold;
-    wasAboveUnsigned = (uint32_t) triggerValue > (uint32_t) trigger.threshold;
+            if (packing.enabled && packing.pointBytes > 4)
+            {
+                // Keep the capture start and end on sampling point boundaries
+                uint32_t pointWords = packing.pointBytes / 4;
+                uint32_t maxCount   = segments.size - segments.size % pointWords;
 
-    // Enable the trigger
-    state = RAMDEBUG_PRETRIGGER;
+                sampleCount    = MIN(((sampleCount + pointWords - 1) / pointWords) * pointWords, maxCount);
+                sampleCountPre = MIN(((sampleCountPre + pointWords - 1) / pointWords) * pointWords, sampleCount);
+            }
+        }
+
+        // Enable the trigger
+        state = RAMDEBUG_PRETRIGGER;
+    }
 
     // Enable the capturing IRQ
     captureEnabled = true;
@@ -589,23 +1939,37 @@ uint32_t debug_getPretriggerSampleCount()
     return sampleCountPre;
 }
 
+// Buffer index of a sample of a segment
+static uint32_t segmentIndex(uint32_t segment, uint32_t index)
+{
+    uint32_t base = segment * segments.size;
+
+    return base + (segments.start[segment] - base + index) % segments.size;
+}
+
 bool debug_getSample(uint32_t index, uint32_t *value)
 {
-    if (index >= sampleCount)
+    if (streaming || statisticsMode)
+        return false;
+
+    if (sampleCount == 0 || index >= sampleCount * segments.count)
         return false;
 
-    if (state != RAMDEBUG_COMPLETE)
+    uint32_t segment = index / sampleCount;
+    index %= sampleCount;
+
+    if (state != RAMDEBUG_COMPLETE && segment >= segments.current)
     {
-        if (state != RAMDEBUG_CAPTURE)
+        if (segment > segments.current || state != RAMDEBUG_CAPTURE)
             return false;
 
         // If we are in CAPTURE state and the user requested data
         // thats already captured, allow the access
-        if (index > ((debug_write_index - debug_start_index) % RAMDEBUG_BUFFER_ELEMENTS))
+        if (index > ((debug_write_index - debug_start_index + segments.size) % segments.size))
             return false;
     }
 
-    *value = debug_buffer[(index + debug_start_index) % RAMDEBUG_BUFFER_ELEMENTS];
+    *value = debug_buffer[segmentIndex(segment, index)];
 
     return true;
 }
@@ -632,11 +1996,53 @@ bool debug_getInfo(uint32_t type, uint32_t *infoValue)
         break;
     case RAMDEBUG_INFO_SAMPLING_FREQ:
         // PWM/Sampling Frequency
-        *infoValue = frequency; // RAMDEBUG_FREQUENCY;
+        *infoValue = (adcCapture.frequency) ? adcCapture.frequency : frequency; // RAMDEBUG_FREQUENCY;
         break;
     case RAMDEBUG_INFO_SAMPLE_NUMBER:
         *infoValue = debug_write_index;
         break;
+    case RAMDEBUG_INFO_BLOCK_WORDS:
+        *infoValue = (compression.enabled) ? RAMDEBUG_BLOCK_WORDS : 0;
+        break;
+    case RAMDEBUG_INFO_POINT_BYTES:
+        if (adcCapture.frequency)
+            *infoValue = sizeof(uint16_t);
+        else
+            *infoValue = (packing.enabled) ? packing.pointBytes : 0;
+        break;
+    case RAMDEBUG_INFO_TRIGGER_PADDING:
+        *infoValue = packing.padding;
+        break;
+    case RAMDEBUG_INFO_DECIMATION_PHASE:
+        *infoValue = decimation.triggerPhase;
+        break;
+    case RAMDEBUG_INFO_CYCLE_FREQUENCY:
+        *infoValue = systick_getCycleFrequency();
+        break;
+    case RAMDEBUG_INFO_MISSED_TICKS:
+        *infoValue = timing.missedTicks;
+        break;
+    case RAMDEBUG_INFO_INTERVAL_MIN:
+        *infoValue = (timing.intervalCount) ? timing.intervalMin : 0;
+        break;
+    case RAMDEBUG_INFO_INTERVAL_MAX:
+        *infoValue = timing.intervalMax;
+        break;
+    case RAMDEBUG_INFO_INTERVAL_MEAN:
+        *infoValue = (timing.intervalCount) ? timing.intervalSum / timing.intervalCount : 0;
+        break;
+    case RAMDEBUG_INFO_LATE_SAMPLES:
+        *infoValue = timing.lateSamples;
+        break;
+    case RAMDEBUG_INFO_TRIGGER_SLOT:
+        *infoValue = adcCapture.slot;
+        break;
+    case RAMDEBUG_INFO_READ_CYCLES_MAX:
+        *infoValue = timing.readCyclesMax;
+        break;
+    case RAMDEBUG_INFO_READ_CYCLES_MEAN:
+        *infoValue = (timing.readCount) ? timing.readCyclesSum / timing.readCount : 0;
+        break;
     default:
         return false;
     }
@@ -651,6 +2057,10 @@ void debug_useNextProcess(bool enable)
 
 void debug_nextProcess(void)
 {
+    // The previous tick has not been processed yet
+    if (next_process && captureEnabled)
+        timing.missedTicks++;
+
     next_process = true;
 }
 
@@ -671,13 +2081,25 @@ bool debug_bulkDownload(uint32_t index, uint32_t *samplesToSend)
     if (extraDataLimit < (2*sizeof(uint32_t)))
         return false;
 
-    uint32_t indexInBuffer = (index + debug_start_index) % RAMDEBUG_BUFFER_ELEMENTS;
+    // Streamed samples are sent out by the main loop
+    if (streaming || statisticsMode)
+        return false;
+
+    if (sampleCount == 0 || index >= sampleCount * segments.count)
+        return false;
+
+    // A download does not span segments
+    uint32_t segment = index / sampleCount;
+    index %= sampleCount;
+
+    uint32_t base = segment * segments.size;
+    uint32_t indexInBuffer = segmentIndex(segment, index);
     uint32_t leftSamples = sampleCount - index;
 
     *samplesToSend = MIN(leftSamples, extraDataLimit / sizeof(uint32_t));
 
     uint32_t extraBytes = *samplesToSend * sizeof(uint32_t);
-    uint32_t bytesUntilWraparound = (RAMDEBUG_BUFFER_ELEMENTS - indexInBuffer) * 4;
+    uint32_t bytesUntilWraparound = (base + segments.size - indexInBuffer) * 4;
 
     tmcl_appendData((uint8_t *) &debug_buffer[indexInBuffer], MIN(extraBytes, bytesUntilWraparound));
 
@@ -685,8 +2107,333 @@ bool debug_bulkDownload(uint32_t index, uint32_t *samplesToSend)
     {
         // We only copied data until the end of the ring buffer.
         // Copy the rest in from the start of the ring buffer.
-        tmcl_appendData((uint8_t *) &debug_buffer[0], extraBytes - bytesUntilWraparound);
+        tmcl_appendData((uint8_t *) &debug_buffer[base], extraBytes - bytesUntilWraparound);
+    }
+
+    return true;
+}
+
+bool debug_setChannelEncoding(uint8_t index, uint8_t encoding, uint8_t width)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    if (encoding >= ENCODING_END)
+        return false;
+
+    if (width == 0 || width > 32)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    encodings[index].encoding = encoding;
+    encodings[index].width    = width;
+
+    return true;
+}
+
+bool debug_getChannelEncoding(uint8_t index, uint8_t *encoding, uint8_t *width)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    *encoding = encodings[index].encoding;
+    *width    = encodings[index].width;
+
+    return true;
+}
+
+bool debug_setStorageWidth(uint8_t index, uint8_t width)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    if (width != 8 && width != 16 && width != 32)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    storageWidths[index] = width;
+
+    return true;
+}
+
+bool debug_setChannelDecimation(uint8_t index, uint8_t mode)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    if (mode >= DECIMATION_END)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    decimationModes[index] = mode;
+
+    return true;
+}
+
+bool debug_getChannelDecimation(uint8_t index, uint8_t *mode)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    *mode = decimationModes[index];
+
+    return true;
+}
+
+bool debug_setAdcCapture(uint8_t input, uint32_t frequency)
+{
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    if (frequency != 0 && HAL.ADCs->startCapture == NULL)
+        return false;
+
+    adcCapture.input     = input;
+    adcCapture.frequency = frequency;
+
+    return true;
+}
+
+uint32_t debug_getAdcCapture(uint8_t *input)
+{
+    *input = adcCapture.input;
+
+    return adcCapture.frequency;
+}
+
+bool debug_setSegments(uint8_t count)
+{
+    if (count == 0 || count > RAMDEBUG_MAX_SEGMENTS)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    segments.configured = count;
+
+    return true;
+}
+
+uint8_t debug_getSegments()
+{
+    return segments.configured;
+}
+
+uint8_t debug_getFilledSegments()
+{
+    return (state == RAMDEBUG_COMPLETE) ? segments.count : segments.current;
+}
+
+bool debug_getSegmentInfo(uint8_t index, uint32_t *triggerTick, uint32_t *padding)
+{
+    if (index >= debug_getFilledSegments())
+        return false;
+
+    *triggerTick = segments.triggerTick[index];
+    *padding     = segments.padding[index];
+
+    return true;
+}
+
+// Storage width and byte offset of a channel within a sampling point
+bool debug_getStorageLayout(uint8_t index, uint8_t *width, uint8_t *offset)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    *width  = storageWidths[index];
+    *offset = 0;
+
+    for (uint32_t i = 0; i < index; i++)
+    {
+        if (channels[i].type != CAPTURE_DISABLED)
+            *offset += storageWidths[i] / 8;
+    }
+
+    return true;
+}
+
+// Enable: Switch to streaming mode. Has to be done before starting the capture.
+// Disable: End a running stream capture (samples not sent yet are still sent)
+// or leave the streaming mode when idle.
+bool debug_setStreaming(bool enable)
+{
+    if (enable)
+    {
+        if (state != RAMDEBUG_IDLE || statisticsMode)
+            return false;
+
+        streaming       = true;
+        streamWritten   = 0;
+        streamRead      = 0;
+        streamOverflows = 0;
+        debug_write_index = 0;
+
+        return true;
+    }
+
+    if (state == RAMDEBUG_IDLE)
+    {
+        streaming = false;
+        return true;
+    }
+
+    if (!streaming)
+        return false;
+
+    captureEnabled = false;
+    state = RAMDEBUG_COMPLETE;
+
+    return true;
+}
+
+bool debug_isStreaming(void)
+{
+    return streaming;
+}
+
+uint32_t debug_getStreamSetSize(void)
+{
+    return streamSetSize;
+}
+
+uint32_t debug_getStreamPending(void)
+{
+    return streamWritten - streamRead;
+}
+
+uint32_t debug_getStreamOverflows(void)
+{
+    return streamOverflows;
+}
+
+// Append up to maxSamples pending stream samples as extra data and release
+// them from the buffer. Only whole sampling points are appended.
+// Returns the amount of appended samples.
+uint32_t debug_streamAppend(uint32_t maxSamples)
+{
+    if (!streaming || streamSetSize == 0)
+        return 0;
+
+    uint32_t count = MIN(streamWritten - streamRead, maxSamples);
+    count -= count % streamSetSize;
+
+    uint32_t indexInBuffer = streamRead % RAMDEBUG_BUFFER_ELEMENTS;
+    uint32_t samplesUntilWraparound = RAMDEBUG_BUFFER_ELEMENTS - indexInBuffer;
+
+    tmcl_appendData((uint8_t *) &debug_buffer[indexInBuffer], MIN(count, samplesUntilWraparound) * sizeof(uint32_t));
+
+    if (count > samplesUntilWraparound)
+    {
+        tmcl_appendData((uint8_t *) &debug_buffer[0], (count - samplesUntilWraparound) * sizeof(uint32_t));
+    }
+
+    streamRead += count;
+
+    return count;
+}
+
+// Enable: Switch to the statistics mode. Has to be done before starting the capture.
+// Disable: End a running statistics capture (the results stay available)
+// or leave the statistics mode when idle.
+bool debug_setStatistics(bool enable)
+{
+    if (enable)
+    {
+        if (state != RAMDEBUG_IDLE || streaming)
+            return false;
+
+        statisticsMode = true;
+        resetStatistics();
+
+        return true;
+    }
+
+    if (state == RAMDEBUG_IDLE)
+    {
+        statisticsMode = false;
+        return true;
     }
 
+    if (!statisticsMode)
+        return false;
+
+    captureEnabled = false;
+    state = RAMDEBUG_COMPLETE;
+
+    return true;
+}
+
+bool debug_isStatistics(void)
+{
+    return statisticsMode;
+}
+
+uint32_t debug_getStatisticsCount(void)
+{
+    return statisticsCount;
+}
+
+bool debug_setHistogram(uint8_t index, int32_t lowerBound, uint8_t shift)
+{
+    if (index >= RAMDEBUG_MAX_CHANNELS)
+        return false;
+
+    if (shift > 31)
+        return false;
+
+    if (state != RAMDEBUG_IDLE)
+        return false;
+
+    histograms[index].lowerBound = lowerBound;
+    histograms[index].shift      = shift;
+
     return true;
 }
+
+// Append the statistics block as extra data. Returns the amount of words.
+uint32_t debug_statisticsAppend(void)
+{
+    uint32_t block[1 + 5 * RAMDEBUG_MAX_CHANNELS];
+    uint32_t count = 0;
+
+    block[count++] = statisticsCount;
+
+    for (uint32_t i = 0; i < readPlan.channelCount; i++)
+    {
+        float variance = (statisticsCount) ? statistics[i].m2 / statisticsCount : 0.0f;
+        float values[3];
+
+        values[0] = statistics[i].mean;
+        values[1] = sqrtf(variance);
+        values[2] = sqrtf(statistics[i].mean * statistics[i].mean + variance);
+
+        block[count++] = statistics[i].min;
+        block[count++] = statistics[i].max;
+        memcpy(&block[count], values, sizeof(values));
+        count += 3;
+    }
+
+    if (!tmcl_appendData((uint8_t *) block, count * sizeof(uint32_t)))
+        return 0;
+
+    return count;
+}
+
+// Append the histogram of a capture channel as extra data
+bool debug_histogramAppend(uint8_t index)
+{
+    for (uint32_t i = 0; i < readPlan.channelCount; i++)
+    {
+        if (readPlan.channel[i] == index)
+            return tmcl_appendData((uint8_t *) statistics[i].bins, sizeof(statistics[i].bins));
+    }
+
+    return false;
+}
@@ -17,6 +17,10 @@
 #define RAMDEBUG_MAX_CHANNELS     8
 #define RAMDEBUG_BUFFER_SIZE      32768
 #define RAMDEBUG_BUFFER_ELEMENTS  (RAMDEBUG_BUFFER_SIZE / 4)
+#define RAMDEBUG_BLOCK_WORDS      32 // Block size of compressed captures
+#define RAMDEBUG_TRIGGER_CONDITIONS 4
+#define RAMDEBUG_MAX_SEGMENTS     16 // Multi-shot captures
+#define RAMDEBUG_HISTOGRAM_BINS   16
 
 
 // Capture state
@@ -39,6 +43,7 @@ typedef enum {
     CAPTURE_SYSTICK             = 4,
     CAPTURE_RAMDEBUG_PARAMETER  = 5, // For modules that do not support registers
     CAPTURE_ANALOG_INPUT        = 6,
+    CAPTURE_TIMESTAMP           = 7, // CPU cycles since the previous sampling point
 
     CAPTURE_END
 } RAMDebugSource;
@@ -52,16 +57,130 @@ typedef enum {
     TRIGGER_RISING_EDGE_UNSIGNED   = 4,
     TRIGGER_FALLING_EDGE_UNSIGNED  = 5,
     TRIGGER_DUAL_EDGE_UNSIGNED     = 6,
+    // Level conditions, mainly for compound triggers
+    TRIGGER_ABOVE_SIGNED             = 7,
+    TRIGGER_BELOW_SIGNED             = 8,
+    TRIGGER_ABOVE_UNSIGNED           = 9,
+    TRIGGER_BELOW_UNSIGNED           = 10,
+    TRIGGER_WINDOW_INSIDE_SIGNED     = 11, // threshold <= value <= upper threshold
+    TRIGGER_WINDOW_OUTSIDE_SIGNED    = 12,
+    TRIGGER_WINDOW_INSIDE_UNSIGNED   = 13,
+    TRIGGER_WINDOW_OUTSIDE_UNSIGNED  = 14,
 
     TRIGGER_END
 } RAMDebugTrigger;
 
+// Combination of the trigger conditions
+typedef enum {
+    TRIGGER_COMBINE_AND  = 0,
+    TRIGGER_COMBINE_OR   = 1,
+
+    TRIGGER_COMBINE_END
+} RAMDebugCombine;
+
+// Sample encoding per channel
+// If any capture channel uses an encoding other than ENCODING_RAW, the
+// capture is stored compressed: The buffer is split into blocks of
+// RAMDEBUG_BLOCK_WORDS words. The first word of a block holds the amount of
+// sampling points in the block, the remaining words hold a bitstream (LSB
+// first) with the encoded channels of each sampling point in channel order.
+// The previous value used by ENCODING_DELTA and ENCODING_REPEAT starts out as
+// 0 in every block, so every block can be decoded on its own. The sample
+// counts are counted in buffer words and rounded up to whole blocks.
+typedef enum {
+    ENCODING_RAW     = 0, // 32 bit value
+    ENCODING_WIDTH   = 1, // Lowest <width> bits of the value
+    ENCODING_DELTA   = 2, // Zig-zag varint (7 bits per byte, MSB: more bytes follow) of the difference to the previous value
+    ENCODING_REPEAT  = 3, // 1 bit: 1: Previous value repeated, 0: Followed by the lowest <width> bits of the value
+
+    ENCODING_END
+} RAMDebugEncoding;
+
+// Sample packing
+// Uncompressed captures store each channel with its storage width of 8, 16
+// or 32 bits (the lowest bits of the value). A sampling point holds the
+// channels in channel order at the offsets reported by the storage layout.
+// Sampling points of 1 or 2 bytes are packed into a word (lowest bytes
+// first), larger ones are padded to whole words. Sample counts stay in
+// buffer words (rounded up to whole sampling points). If the trigger hits while a word is partially filled, that
+// word is closed, so the trigger point always starts a new word.
+
+// Decimation modes
+// With a prescaler the channels get read on every debug_process() call. A
+// decimating channel stores a value calculated from all readings since the
+// previous sampling point instead of the last reading. The values are
+// interpreted as signed. The peak detection stores the minimum and the
+// maximum alternately, each over the current and the previous sampling
+// interval, so every reading shows up in both the lower and the upper
+// envelope. The phase of the trigger point is reported by
+// RAMDEBUG_INFO_DECIMATION_PHASE.
+typedef enum {
+    DECIMATION_SKIP     = 0, // Last reading
+    DECIMATION_AVERAGE  = 1,
+    DECIMATION_MIN      = 2,
+    DECIMATION_MAX      = 3,
+    DECIMATION_PEAK     = 4, // Alternating minimum and maximum
+
+    DECIMATION_END
+} RAMDebugDecimation;
+
+// Segmented captures
+// The buffer can be split into segments of RAMDEBUG_BUFFER_ELEMENTS / count
+// words. Every segment holds a complete capture with its own pretrigger
+// window. Once a segment is filled, the trigger gets armed again for the next
+// segment, until all segments are filled. The sample count applies to each
+// segment. Downloads return the segments one after another, segment n
+// starting at sample index n * sample count. Compressed captures and streams
+// only use a single segment.
+
+// DMA capture of an analog input
+// Instead of the capture channels, a single analog input (indices as in TMCL
+// GetInput) gets converted at a fixed rate, triggered by a hardware timer.
+// The DMA writes the 16 bit conversions directly into the buffer, two per
+// word (lower half first), like a packed capture with 2 byte sampling
+// points. Trigger condition 0 is evaluated on the conversions in the DMA
+// interrupts, its channel setting is not used. The sample counts stay in
+// buffer words. The capture starts at a word boundary, the position of the
+// trigger point within its word is reported by RAMDEBUG_INFO_TRIGGER_SLOT.
+// The DMA only gets stopped in the interrupt after the capture end, while it
+// already fills the next buffer half, so the capture start needs a distance
+// to the data the DMA writes meanwhile. Captures are limited to a quarter of
+// the buffer, which leaves half of a buffer half for the interrupt latency.
+#define RAMDEBUG_ADC_MAX_SAMPLES  (RAMDEBUG_BUFFER_ELEMENTS / 4)
+
+// Statistics mode
+// Instead of storing the sampling points, the capture feeds running
+// statistics of each enabled channel, until it gets stopped. The buffer is
+// not used. The values are interpreted as signed. Mean and variance are
+// accumulated with Welford's algorithm in single precision.
+// Statistics block: Amount of sampling points, followed by minimum,
+// maximum, mean, standard deviation and RMS of each enabled channel in
+// channel order. Mean, standard deviation and RMS are IEEE 754 single
+// precision values.
+// Each channel also has a histogram of RAMDEBUG_HISTOGRAM_BINS bins. Bin n
+// counts the values from lower bound + n * 2^shift, values outside of the
+// bins are counted in the first or last bin.
+
 // RAMDebug info parameters.
 typedef enum{
     RAMDEBUG_INFO_MAX_CHANNELS,
     RAMDEBUG_INFO_BUFFER_SIZE,
     RAMDEBUG_INFO_SAMPLING_FREQ,
     RAMDEBUG_INFO_SAMPLE_NUMBER,
+    RAMDEBUG_INFO_BLOCK_WORDS,   // Block size of the armed capture, 0: Not compressed
+    RAMDEBUG_INFO_POINT_BYTES,   // Bytes per sampling point of the armed capture, 0: Not packed
+    RAMDEBUG_INFO_TRIGGER_PADDING, // Unused sampling point slots in the word before the trigger point
+    RAMDEBUG_INFO_DECIMATION_PHASE, // Peak detection value of the trigger point. 0: Minimum, 1: Maximum
+    // Sampling timing of the last capture. Intervals are in CPU cycles.
+    RAMDEBUG_INFO_CYCLE_FREQUENCY,  // CPU cycles per second
+    RAMDEBUG_INFO_MISSED_TICKS,     // Sampling ticks that came in while the previous one was still pending
+    RAMDEBUG_INFO_INTERVAL_MIN,
+    RAMDEBUG_INFO_INTERVAL_MAX,
+    RAMDEBUG_INFO_INTERVAL_MEAN,
+    RAMDEBUG_INFO_LATE_SAMPLES,     // Sampling points more than half a sampling period late
+    RAMDEBUG_INFO_TRIGGER_SLOT,     // DMA capture: Conversion of the trigger point within its word
+    RAMDEBUG_INFO_READ_CYCLES_MAX,  // CPU cycles for reading a sampling point
+    RAMDEBUG_INFO_READ_CYCLES_MEAN,
 
     RAMDEBUG_INFO_END_
 } RAMDebugInfo;
@@ -82,6 +201,14 @@ bool debug_setTriggerEvalChannel(uint8_t eval_channel);
 bool debug_setTriggerAddress(uint32_t address);
 void debug_setTriggerMaskShift(uint32_t mask, uint8_t shift);
 int32_t debug_enableTrigger(uint8_t type, uint32_t threshold);
+bool debug_selectTriggerCondition(uint8_t index);
+bool debug_setTriggerCondition(uint8_t type);
+bool debug_setTriggerThreshold(uint32_t threshold);
+bool debug_setTriggerThresholdHigh(uint32_t threshold);
+bool debug_setTriggerHysteresis(uint32_t hysteresis);
+bool debug_setTriggerCombine(uint8_t combine);
+void debug_setTriggerHoldoff(uint32_t evaluations);
+void debug_setTriggerMinDuration(uint32_t evaluations);
 
 void debug_setPrescaler(uint32_t divider);
 void debug_setSampleCount(uint32_t count);
@@ -95,6 +222,35 @@ RAMDebugState debug_getState(void);
 bool debug_getInfo(uint32_t type, uint32_t *infoValue);
 bool debug_bulkDownload(uint32_t index, uint32_t *samplesToSend);
 
+bool debug_setChannelEncoding(uint8_t index, uint8_t encoding, uint8_t width);
+bool debug_getChannelEncoding(uint8_t index, uint8_t *encoding, uint8_t *width);
+bool debug_setStorageWidth(uint8_t index, uint8_t width);
+bool debug_setChannelDecimation(uint8_t index, uint8_t mode);
+bool debug_setSegments(uint8_t count);
+bool debug_setAdcCapture(uint8_t input, uint32_t frequency);
+uint32_t debug_getAdcCapture(uint8_t *input);
+uint8_t debug_getSegments();
+uint8_t debug_getFilledSegments();
+bool debug_getSegmentInfo(uint8_t index, uint32_t *triggerTick, uint32_t *padding);
+bool debug_getChannelDecimation(uint8_t index, uint8_t *mode);
+bool debug_getStorageLayout(uint8_t index, uint8_t *width, uint8_t *offset);
+
+bool debug_setStreaming(bool enable);
+bool debug_isStreaming(void);
+uint32_t debug_getStreamSetSize(void);
+uint32_t debug_getStreamPending(void);
+uint32_t debug_getStreamOverflows(void);
+uint32_t debug_streamAppend(uint32_t maxSamples);
+
+bool debug_setStatistics(bool enable);
+bool debug_isStatistics(void);
+uint32_t debug_getStatisticsCount(void);
+bool debug_setHistogram(uint8_t index, int32_t lowerBound, uint8_t shift);
+uint32_t debug_statisticsAppend(void);
+bool debug_histogramAppend(uint8_t index);
+
+uint32_t debug_readChannel(uint8_t type, uint8_t eval_channel, uint32_t address);
+
 void debug_useNextProcess(bool enable);
 void debug_nextProcess(void);
 void debug_setGlobalEnable(bool enable);
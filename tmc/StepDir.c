@@ -58,6 +58,38 @@
  *   position differences. Decreasing acceleration or moving the target position
  *   towards the actual position might result in bigger misses of the target.
  *
+ * S-curve ramps:
+ *   Instead of the linear ramp, a jerk-limited ramp can be selected per channel
+ *   (setRampType()). Every velocity change then runs through up to three phases:
+ *   The acceleration rises with the jerk (jerk up), stays at the acceleration
+ *   limit (constant) and falls back to zero (jerk down). A positioning ramp thus
+ *   consists of seven segments: three for accelerating, cruising and three for
+ *   decelerating. Since the acceleration never jumps, the motor gets less
+ *   excited by the ramp and settles faster at the same peak acceleration.
+ *
+ *   The generator works online in the interrupt, using fixed point accumulators
+ *   for acceleration, velocity and position with the same precision as the
+ *   linear ramp. The jerk down phase mirrors the jerk up phase, so it is started
+ *   once the velocity gained during the jerk up phase would carry the velocity
+ *   to its target. Per tick, this takes two 64 bit multiplications to rebuild
+ *   the fine velocity and position from the accumulators, and up to three
+ *   divisions by the precision (a runtime value): One each for the jerk,
+ *   velocity and position accumulators.
+ *   Positioning ramps starting from standstill additionally check whether the
+ *   accelerating half of the ramp would cover half of the distance, which takes
+ *   another 64 bit multiplication per tick until the acceleration starts falling.
+ *   The deceleration is started once the remaining distance reaches the
+ *   distance needed for the acceleration, as the deceleration mirrors it.
+ *   Distances are tracked with the resolution of the position accumulator.
+ *
+ *   Acceleration and jerk are latched at the start of each velocity change. In
+ *   position mode, a maximum velocity increase only takes effect with the next
+ *   ramp while a decrease slows the motor down immediately. Moving the target
+ *   position within the deceleration distance leads to overshooting, followed
+ *   by a new ramp to the target. Rounding errors of the jerk phases are absorbed
+ *   at the end of each velocity change, the remaining position error (if any)
+ *   is driven with a new, short ramp.
+ *
  * StallGuard:
  *   The StepDir generator supports the StallGuard feature, either by a input pin
  *   signal or with external monitoring. The function periodicJob() will check,
@@ -78,6 +110,46 @@
  *   to any value.
  *   Position mode will start a new ramp towards the target after a stall.
  *
+ * Channels:
+ *   The number of channels is set at build time (STEPDIR_CHANNELS, up to 32).
+ *   The interrupt only processes the channels marked in a bitmask of active
+ *   channels. A channel drops out of the mask once it is halted, or once its
+ *   ramp has come to a rest (target position or target velocity zero reached,
+ *   no acceleration update pending). Main code functions changing the ramp or
+ *   clearing a halting condition put the channel back into the mask. Channels
+ *   at rest therefore cost the interrupt nothing.
+ *
+ *   The interrupt measures its own duration with the DWT cycle counter, both
+ *   in total and per channel. The averages over 2^STEPDIR_CYCLE_WINDOW ticks
+ *   and the longest interrupt are available from the getters (and the board
+ *   APs). The load is the average share of the interrupt period spent in the
+ *   interrupt, so 1000 (100%) means the channels saturate the core at the
+ *   current interrupt frequency.
+ *
+ * Timer step output:
+ *   One channel can hand its step pulses to a hardware timer instead of the
+ *   interrupt (setOutput(), only at standstill). The ramp of that channel is
+ *   then calculated at STEPDIR_SEGMENT_FREQUENCY (2^13 Hz) in the DMA interrupt
+ *   of the timer. Each calculation fills one segment of a ring buffer with the
+ *   timer settings for its steps, spread evenly over the segment. The DMA
+ *   loads the segments into the timer on its own, so the step rate no longer
+ *   depends on the interrupt frequency and the channel costs the interrupt
+ *   nothing. The interrupt drops the channel from its mask.
+ *
+ *   The ring buffer holds STEPDIR_SEGMENTS segments, half of it gets refilled
+ *   per DMA interrupt. Ramp changes and stalls (also the StallGuard pin, checked
+ *   once per segment) therefore take effect with a latency of up to
+ *   STEPDIR_SEGMENTS segments (~2ms), steps already in the buffer still get sent.
+ *   The direction pin can only be changed once the buffer contains no more
+ *   steps of the old direction, which pauses the ramp for a few segments when
+ *   reversing. Switching back to the interrupt waits for the buffer to run empty.
+ *   The DMA interrupt has a lower priority than the StepDir interrupt, so the
+ *   refill doesn't add jitter to the channels still stepped by the interrupt.
+ *
+ *   The timer output depends on the HAL: On the Landungsbrücke V3, TIMER0 drives
+ *   the step pin if it is DIO6. It is not available while TIMER0 drives any PWM
+ *   outputs. The Landungsbrücke has no timer output.
+ *
  * Emergency Stop:
  *   The stop function implements an emergency stop. This will result in the
  *   channel immediately stopping any movements. No parameters are updated to
@@ -90,6 +162,8 @@
  * Landungsbrücke, the worst case of two motors/channels (TMC2041) is able to
  * still run at 2^17 Hz. Since the bulk of the calculation is per-motor/channel,
  * using a chip with only one motor/channel would allow a frequency of 2^18 Hz.
+ * The same budget limits the number of simultaneously moving channels, check
+ * the interrupt load when adding channels.
  * (Note that quite a few calculations have to divide by the frequency, so
  *  choosing a power of two simplifies those to right-shifts.)
  *
@@ -97,6 +171,11 @@
  * The maximum velocity therefore is equal to the interrupt frequency:
  *   Max Velocity: 2^17 pps = 131072 pps
  *
+ * The timer output sends the steps of a segment with a constant period, which
+ * gets rounded down to timer clock cycles. This shortens the segment, speeding
+ * the motor up by up to 0.1% at the highest velocity:
+ *   Max Velocity (timer output): 2^18 pps = 262144 pps
+ *
  * Each tick the acceleration value gets added to the velocity accumulator
  * variable (uint32_t). The upper 15 digits are added to the velocity, the lower
  * 17 digits are kept in the accumulator between ticks. The maximum
@@ -124,23 +203,45 @@
 
 #include "StepDir.h"
 #include "hal/derivative.h"
+#include "hal/SysTick.h"
 
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
 	#define TIMER_INTERRUPT FTM1_IRQHandler
+	#define CYCLE_COUNTER   DWT_CYCCNT
 #elif defined(LandungsbrueckeV3)
 	#define TIMER_INTERRUPT TIMER2_IRQHandler
+	#define CYCLE_COUNTER   (DWT->CYCCNT)
 #endif
 
-#define STEP_DIR_CHANNELS 2
-
 // Reset value for stallguard threshold. Since Stallguard is motor/application-specific we can't choose a good value here,
 // so this value is rather randomly chosen. Leaving it at zero means stall detection turned off.
 #define STALLGUARD_THRESHOLD 0
 
-StepDirectionTypedef StepDir[STEP_DIR_CHANNELS];
+StepDirectionTypedef StepDir[STEPDIR_CHANNELS];
 
 IOPinTypeDef DummyPin = { .bitWeight = DUMMY_BITWEIGHT };
 
+// Channels the interrupt has to process (see "Channels" at the top).
+// Only the main code sets bits, only the interrupt clears them.
+static volatile uint32_t activeChannels = 0;
+
+// Interrupt cycle measurement (see "Channels" at the top)
+static uint32_t interruptFrequency = STEPDIR_FREQUENCY;
+static StepDirStallCallback stallCallback = NULL;
+static uint32_t interruptTicks     = 0;
+static uint32_t interruptCycleSum  = 0;
+static volatile uint32_t interruptCycles    = 0;
+static volatile uint32_t interruptMaxCycles = 0;
+
+// Timer step output (see "Timer step output" at the top)
+static volatile StepSegmentTypeDef segments[STEPDIR_SEGMENTS];
+static StepDirectionTypedef *timerChannel = NULL; // Channel using the timer output
+static uint32_t timerPrecision;    // Ramp precision to restore when returning to the interrupt
+static int8_t   timerDirection;    // Direction of the last step pulses written into the buffer
+static int8_t   timerFlip;         // Direction pin change due at the next buffer refill (0: none)
+static uint32_t timerIdleRun;      // Segments without step pulses written in a row
+static int32_t  timerPendingSteps; // Steps waiting for a direction change or for room in a segment
+
 // Helper functions
 static int32_t calculateStepDifference(int32_t velocity, uint32_t oldAccel, uint32_t newAccel);
 // These helper functions are for optimizing the interrupt without duplicating
@@ -150,9 +251,30 @@ static int32_t calculateStepDifference(int32_t velocity, uint32_t oldAccel, uint
 // necessary safety checks.
 static inline void checkStallguard(StepDirectionTypedef *channel, bool stallSignalActive);
 static inline void stop(StepDirectionTypedef *channel, StepDirStop stopType);
+static inline int32_t computeSCurve(StepDirectionTypedef *channel);
+static void resetSCurve(StepDirectionTypedef *channel);
+static inline bool isIdle(StepDirectionTypedef *channel);
+static inline void syncAcceleration(StepDirectionTypedef *channel);
+static void fillSegments(uint32_t half);
+
+// Highest velocity the step output of a channel can generate
+static inline int32_t maxStepRate(StepDirectionTypedef *channel)
+{
+	return (channel->output == STEPDIR_OUTPUT_TIMER) ? STEPDIR_TIMER_MAX_VELOCITY : STEPDIR_MAX_VELOCITY;
+}
+
+// Wake a channel up after the main code changed its state.
+// The interrupt only sets channels inactive, so the read-modify-write
+// can at worst wake up a channel that has just gone idle.
+static inline void activate(uint8_t channel)
+{
+	activeChannels |= 1UL << channel;
+}
 
 void TIMER_INTERRUPT()
 {
+	uint32_t tickStart = CYCLE_COUNTER;
+
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
 	FTM1_SC &= ~FTM_SC_TOF_MASK; // clear timer overflow flag
 #elif defined(LandungsbrueckeV3)
@@ -161,14 +283,25 @@ void TIMER_INTERRUPT()
 	timer_interrupt_flag_clear(TIMER2, TIMER_INT_FLAG_UP);
 #endif
 
-	for (uint8_t ch = 0; ch < STEP_DIR_CHANNELS; ch++)
+	uint32_t pending = activeChannels;
+	while (pending)
 	{
+		uint8_t ch = __builtin_ctz(pending);
+		pending &= pending - 1;
+
+		uint32_t channelStart = CYCLE_COUNTER;
+
 		// Temporary variable for the current channel
 		StepDirectionTypedef *currCh = &StepDir[ch];
 
-		// If any halting condition is present, abort immediately
-		if (currCh->haltingCondition)
+		// If any halting condition is present, abort immediately.
+		// Clearing the halting condition wakes the channel up again.
+		// Channels using the timer output get calculated in fillSegments().
+		if (currCh->haltingCondition || (currCh->output != STEPDIR_OUTPUT_INTERRUPT))
+		{
+			activeChannels &= ~(1UL << ch);
 			continue;
+		}
 
 		// Reset step output (falling edge of last pulse)
 
@@ -186,7 +319,9 @@ void TIMER_INTERRUPT()
 		checkStallguard(currCh, isStallSignalHigh);
 
 		// Compute ramp
-		int32_t dx = tmc_ramp_linear_compute(&currCh->ramp);
+		int32_t dx = (currCh->rampType == STEPDIR_RAMP_SCURVE)
+				? computeSCurve(currCh)
+				: tmc_ramp_linear_compute(&currCh->ramp);
 
 		// Step
 		if (dx == 0) // No change in position -> skip step generation
@@ -200,56 +335,166 @@ void TIMER_INTERRUPT()
 
 skipStep:
 		// Synchronised Acceleration update
-		switch(currCh->syncFlag)
+		syncAcceleration(currCh);
+
+		// Nothing left to do until the main code changes the channel
+		if ((dx == 0) && isIdle(currCh))
+			activeChannels &= ~(1UL << ch);
+
+		currCh->cycleSum += CYCLE_COUNTER - channelStart;
+	}
+
+	// Interrupt load measurement
+	uint32_t cycles = CYCLE_COUNTER - tickStart;
+	interruptCycleSum += cycles;
+	if (cycles > interruptMaxCycles)
+		interruptMaxCycles = cycles;
+
+	if (++interruptTicks == (1UL << STEPDIR_CYCLE_WINDOW))
+	{	// Publish the averages of this measurement window
+		interruptCycles   = interruptCycleSum >> STEPDIR_CYCLE_WINDOW;
+		interruptCycleSum = 0;
+		interruptTicks    = 0;
+
+		for (uint8_t ch = 0; ch < STEPDIR_CHANNELS; ch++)
+		{
+			StepDir[ch].cycles   = StepDir[ch].cycleSum >> STEPDIR_CYCLE_WINDOW;
+			StepDir[ch].cycleSum = 0;
+		}
+	}
+}
+
+// Interrupt side of the acceleration updating sync mechanism (see acceleration setter for details)
+static inline void syncAcceleration(StepDirectionTypedef *channel)
+{
+	switch(channel->syncFlag)
+	{
+	case SYNC_SNAPSHOT_REQUESTED:
+		// Apply the new acceleration
+		tmc_ramp_linear_set_acceleration(&channel->ramp, channel->newAcceleration);
+		// Save a snapshot of the velocity
+		channel->oldVelocity  = tmc_ramp_linear_get_rampVelocity(&channel->ramp);
+
+		channel->syncFlag = SYNC_SNAPSHOT_SAVED;
+		break;
+	case SYNC_UPDATE_DATA:
+		channel->ramp.accelerationSteps += channel->stepDifference;
+		channel->syncFlag = SYNC_IDLE;
+		break;
+	default:
+		break;
+	}
+}
+
+// Refill one half of the timer step output buffer (called from the DMA interrupt).
+// Each segment gets the steps of one ramp calculation at STEPDIR_SEGMENT_FREQUENCY.
+static void fillSegments(uint32_t half)
+{
+	StepDirectionTypedef *channel = timerChannel;
+	uint32_t start = CYCLE_COUNTER;
+
+	if (!channel)
+		return;
+
+	// The last segments before the buffer half written last time are playing now.
+	// They contain no steps, so a pending direction change can be applied.
+	if (timerFlip)
+	{
+		*((timerFlip > 0) ? channel->dirPin->resetBitRegister : channel->dirPin->setBitRegister) = channel->dirPin->bitWeight;
+		timerFlip = 0;
+	}
+
+	for (uint32_t i = 0; i < STEPDIR_SEGMENTS / 2; i++)
+	{
+		int32_t steps = timerPendingSteps;
+		timerPendingSteps = 0;
+
+		if ((steps == 0) && (channel->haltingCondition == 0))
 		{
-		case SYNC_SNAPSHOT_REQUESTED:
-			// Apply the new acceleration
-			tmc_ramp_linear_set_acceleration(&currCh->ramp, currCh->newAcceleration);
-			// Save a snapshot of the velocity
-			currCh->oldVelocity  = tmc_ramp_linear_get_rampVelocity(&currCh->ramp);
+			checkStallguard(channel, HAL.IOs->config->isHigh(channel->stallGuardPin) == 1);
 
-			currCh->syncFlag = SYNC_SNAPSHOT_SAVED;
-			break;
-		case SYNC_UPDATE_DATA:
-			currCh->ramp.accelerationSteps += currCh->stepDifference;
-			currCh->syncFlag = SYNC_IDLE;
-			break;
-		default:
-			break;
+			if (channel->haltingCondition == 0)
+			{
+				steps = (channel->rampType == STEPDIR_RAMP_SCURVE)
+						? computeSCurve(channel)
+						: tmc_ramp_linear_compute(&channel->ramp);
+			}
+
+			syncAcceleration(channel);
+		}
+
+		// Direction changes have to wait until the steps of the old direction
+		// have been sent. That is the case at the next refill if the two segments
+		// before this buffer half and all segments before this one contain no steps.
+		// Otherwise the steps wait (and the ramp pauses) until that holds.
+		int8_t direction = (steps > 0) ? 1 : -1;
+		if ((steps != 0) && (direction != timerDirection))
+		{
+			if (timerIdleRun >= i + 2)
+			{
+				timerDirection = direction;
+				timerFlip      = direction;
+			}
+			else
+			{
+				timerPendingSteps = steps;
+				steps = 0;
+			}
 		}
+
+		uint32_t placed = HAL.Timer->fillStepSegment(&segments[half * STEPDIR_SEGMENTS / 2 + i], abs(steps), STEPDIR_SEGMENT_FREQUENCY);
+		if (steps != 0)
+			timerPendingSteps += steps - direction * (int32_t) placed;
+
+		timerIdleRun = (placed == 0) ? timerIdleRun + 1 : 0;
 	}
+
+	channel->cycleSum += CYCLE_COUNTER - start;
+}
+
+// Switch the ramp of a channel to a different calculation rate
+static void setRampPrecision(StepDirectionTypedef *channel, uint32_t precision)
+{
+	tmc_ramp_linear_set_precision(&channel->ramp, precision);
+	channel->ramp.accumulatorVelocity = 0;
+	channel->ramp.accumulatorPosition = 0;
+	resetSCurve(channel);
 }
 
 void StepDir_rotate(uint8_t channel, int32_t velocity)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	// Set the rampmode first - other way around might cause issues
 	tmc_ramp_linear_set_mode(&StepDir[channel].ramp, TMC_RAMP_LINEAR_MODE_VELOCITY);
 	switch(StepDir[channel].mode) {
 	case STEPDIR_INTERNAL:
-		tmc_ramp_linear_set_targetVelocity(&StepDir[channel].ramp, MIN(STEPDIR_MAX_VELOCITY, velocity));
+		tmc_ramp_linear_set_targetVelocity(&StepDir[channel].ramp, MIN(maxStepRate(&StepDir[channel]), velocity));
 		break;
 	case STEPDIR_EXTERNAL:
 	default:
 		tmc_ramp_linear_set_targetVelocity(&StepDir[channel].ramp, velocity);
 		break;
 	}
+
+	activate(channel);
 }
 
 void StepDir_moveTo(uint8_t channel, int32_t position)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	tmc_ramp_linear_set_mode(&StepDir[channel].ramp, TMC_RAMP_LINEAR_MODE_POSITION);
 	tmc_ramp_linear_set_targetPosition(&StepDir[channel].ramp, position);
+
+	activate(channel);
 }
 
 void StepDir_periodicJob(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	// Check stallguard velocity threshold
@@ -270,7 +515,7 @@ void StepDir_stop(uint8_t channel, StepDirStop stopType)
 
 uint8_t StepDir_getStatus(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	uint8_t status = StepDir[channel].haltingCondition;
@@ -288,7 +533,7 @@ uint8_t StepDir_getStatus(uint8_t channel)
 // Register the pins to be used by a StepDir channel. NULL will leave the pin unchanged
 void StepDir_setPins(uint8_t channel, IOPinTypeDef *stepPin, IOPinTypeDef *dirPin, IOPinTypeDef *stallPin)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	if (stepPin)
@@ -325,23 +570,31 @@ void StepDir_setPins(uint8_t channel, IOPinTypeDef *stepPin, IOPinTypeDef *dirPi
 	{
 		StepDir[channel].stallGuardPin = stallPin;
 	}
+
+	activate(channel);
 }
 
 void StepDir_stallGuard(uint8_t channel, bool stall)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	checkStallguard(&StepDir[channel], stall);
 }
 
+// The callback runs in the StepDir interrupt and has to return quickly
+void StepDir_setStallCallback(StepDirStallCallback callback)
+{
+	stallCallback = callback;
+}
+
 // ===== Setters =====
 // The setters are responsible to access their respective variables while keeping the ramp generation stable
 
 // Set actual and target position (Not during an active position ramp)
 void StepDir_setActualPosition(uint8_t channel, int32_t actualPosition)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	if (tmc_ramp_linear_get_mode(&StepDir[channel].ramp) == TMC_RAMP_LINEAR_MODE_POSITION)
@@ -374,7 +627,7 @@ void StepDir_setActualPosition(uint8_t channel, int32_t actualPosition)
 
 void StepDir_setAcceleration(uint8_t channel, uint32_t acceleration)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	if (tmc_ramp_linear_get_mode(&StepDir[channel].ramp) == TMC_RAMP_LINEAR_MODE_VELOCITY)
@@ -387,6 +640,13 @@ void StepDir_setAcceleration(uint8_t channel, uint32_t acceleration)
 	if (acceleration == 0)
 		return;
 
+	if (StepDir[channel].rampType == STEPDIR_RAMP_SCURVE)
+	{	// The S-curve generator latches the acceleration at the start of each
+		// velocity change and measures its deceleration distance -> no sync required
+		tmc_ramp_linear_set_acceleration(&StepDir[channel].ramp, acceleration);
+		return;
+	}
+
 	// Store the old acceleration
 	uint32_t oldAcceleration = tmc_ramp_linear_get_acceleration(&StepDir[channel].ramp);
 
@@ -400,6 +660,7 @@ void StepDir_setAcceleration(uint8_t channel, uint32_t acceleration)
 		// a snapshot from the interrupt
 		StepDir[channel].newAcceleration = acceleration;
 		StepDir[channel].syncFlag = SYNC_SNAPSHOT_REQUESTED;
+		activate(channel);
 		// Wait for the flag update from the interrupt.
 		while (ACCESS_ONCE(StepDir[channel].syncFlag) != SYNC_SNAPSHOT_SAVED); // todo CHECK 2: Timeout to prevent deadlock? (LH) #1
 	}
@@ -416,6 +677,7 @@ void StepDir_setAcceleration(uint8_t channel, uint32_t acceleration)
 	{
 		StepDir[channel].stepDifference = stepDifference;
 		StepDir[channel].syncFlag = SYNC_UPDATE_DATA;
+		activate(channel);
 
 		// Wait for interrupt to set flag to SYNC_IDLE
 		while (ACCESS_ONCE(StepDir[channel].syncFlag) != SYNC_IDLE); // todo CHECK 2: Timeout to prevent deadlock? (LH) #2
@@ -428,7 +690,7 @@ void StepDir_setAcceleration(uint8_t channel, uint32_t acceleration)
 
 void StepDir_setVelocityMax(uint8_t channel, int32_t velocityMax)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	tmc_ramp_linear_set_maxVelocity(&StepDir[channel].ramp, velocityMax);
@@ -437,16 +699,18 @@ void StepDir_setVelocityMax(uint8_t channel, int32_t velocityMax)
 // Set the velocity threshold for active StallGuard. Also reset the stall flag
 void StepDir_setStallGuardThreshold(uint8_t channel, int32_t stallGuardThreshold)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	StepDir[channel].stallGuardThreshold = stallGuardThreshold;
 	StepDir[channel].haltingCondition &= ~STATUS_STALLED;
+
+	activate(channel);
 }
 
 void StepDir_setMode(uint8_t channel, StepDirMode mode)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	StepDir[channel].mode = mode;
@@ -459,7 +723,7 @@ void StepDir_setMode(uint8_t channel, StepDirMode mode)
 
 void StepDir_setFrequency(uint8_t channel, uint32_t frequency)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
 	StepDir[channel].frequency = frequency;
@@ -467,16 +731,122 @@ void StepDir_setFrequency(uint8_t channel, uint32_t frequency)
 
 void StepDir_setPrecision(uint8_t channel, uint32_t precision)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return;
 
+	// The timer output calculates the ramp at its own rate, apply the
+	// precision once the channel returns to the interrupt
+	if (StepDir[channel].output == STEPDIR_OUTPUT_TIMER)
+	{
+		timerPrecision = precision;
+		return;
+	}
+
 	tmc_ramp_linear_set_precision(&StepDir[channel].ramp, precision);
 }
 
+// Select the linear or the S-curve ramp generator (only while standing still).
+// Returns false if the ramp type was not applied.
+bool StepDir_setRampType(uint8_t channel, StepDirRampType rampType)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return false;
+
+	if (rampType != STEPDIR_RAMP_LINEAR && rampType != STEPDIR_RAMP_SCURVE)
+		return false;
+
+	// The generators don't share their intermediate state -> only switch at standstill
+	if ((StepDir[channel].haltingCondition == 0) && (tmc_ramp_linear_get_rampVelocity(&StepDir[channel].ramp) != 0))
+		return false;
+
+	resetSCurve(&StepDir[channel]);
+	StepDir[channel].rampType = rampType;
+
+	return true;
+}
+
+void StepDir_setJerk(uint8_t channel, uint32_t jerk)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return;
+
+	// A jerk of zero would never start a velocity change
+	if (jerk == 0)
+		return;
+
+	StepDir[channel].sCurve.jerk = MIN(jerk, STEPDIR_MAX_JERK);
+}
+
+// Select the step pulse generation (only while standing still).
+// Only one channel can use the timer output, and only if the HAL supports
+// a timer output on its step pin. Returns false if the output was not applied.
+bool StepDir_setOutput(uint8_t channel, StepDirOutput output)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return false;
+
+	StepDirectionTypedef *ch = &StepDir[channel];
+
+	if (output != STEPDIR_OUTPUT_INTERRUPT && output != STEPDIR_OUTPUT_TIMER)
+		return false;
+
+	if (output == ch->output)
+		return true;
+
+	// The ramp calculation rate changes with the output -> only switch at standstill
+	if ((ch->haltingCondition == 0) && (tmc_ramp_linear_get_rampVelocity(&ch->ramp) != 0))
+		return false;
+
+	bool applied = true;
+
+	if (output == STEPDIR_OUTPUT_TIMER)
+	{
+		if (timerChannel || !HAL.Timer->startStepOutput)
+			return false;
+
+		// Take the channel out of the interrupt before handing it to the DMA interrupt
+		ch->output = STEPDIR_OUTPUT_TIMER;
+		timerPrecision = tmc_ramp_linear_get_precision(&ch->ramp);
+		setRampPrecision(ch, STEPDIR_SEGMENT_FREQUENCY);
+
+		for (uint32_t i = 0; i < STEPDIR_SEGMENTS; i++)
+			HAL.Timer->fillStepSegment(&segments[i], 0, STEPDIR_SEGMENT_FREQUENCY);
+
+		timerDirection    = 1;
+		timerFlip         = 0;
+		timerIdleRun      = STEPDIR_SEGMENTS;
+		timerPendingSteps = 0;
+		*ch->dirPin->resetBitRegister = ch->dirPin->bitWeight;
+
+		timerChannel = ch;
+		if (HAL.Timer->startStepOutput(ch->stepPin, segments, STEPDIR_SEGMENTS, fillSegments))
+			return true;
+
+		// No timer output on this pin -> back to the interrupt
+		timerChannel = NULL;
+		applied = false;
+	}
+	else
+	{
+		// Steps still waiting in the buffer would get lost
+		if ((timerPendingSteps != 0) || (timerIdleRun < STEPDIR_SEGMENTS + 2))
+			return false;
+
+		HAL.Timer->stopStepOutput();
+		timerChannel = NULL;
+	}
+
+	setRampPrecision(ch, timerPrecision);
+	ch->output = STEPDIR_OUTPUT_INTERRUPT;
+	activate(channel);
+
+	return applied;
+}
+
 // ===== Getters =====
 int32_t StepDir_getActualPosition(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_rampPosition(&StepDir[channel].ramp);
@@ -484,7 +854,7 @@ int32_t StepDir_getActualPosition(uint8_t channel)
 
 int32_t StepDir_getTargetPosition(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_targetPosition(&StepDir[channel].ramp);
@@ -492,7 +862,7 @@ int32_t StepDir_getTargetPosition(uint8_t channel)
 
 int32_t StepDir_getActualVelocity(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_rampVelocity(&StepDir[channel].ramp);
@@ -500,7 +870,7 @@ int32_t StepDir_getActualVelocity(uint8_t channel)
 
 int32_t StepDir_getTargetVelocity(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_targetVelocity(&StepDir[channel].ramp);
@@ -508,7 +878,7 @@ int32_t StepDir_getTargetVelocity(uint8_t channel)
 
 uint32_t StepDir_getAcceleration(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_acceleration(&StepDir[channel].ramp);
@@ -516,7 +886,7 @@ uint32_t StepDir_getAcceleration(uint8_t channel)
 
 int32_t StepDir_getVelocityMax(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return tmc_ramp_linear_get_maxVelocity(&StepDir[channel].ramp);
@@ -524,7 +894,7 @@ int32_t StepDir_getVelocityMax(uint8_t channel)
 
 int32_t StepDir_getStallGuardThreshold(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return StepDir[channel].stallGuardThreshold;
@@ -532,7 +902,7 @@ int32_t StepDir_getStallGuardThreshold(uint8_t channel)
 
 StepDirMode StepDir_getMode(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return StepDir[channel].mode;
@@ -540,7 +910,7 @@ StepDirMode StepDir_getMode(uint8_t channel)
 
 uint32_t StepDir_getFrequency(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	return StepDir[channel].frequency;
@@ -548,7 +918,7 @@ uint32_t StepDir_getFrequency(uint8_t channel)
 
 uint32_t StepDir_getPrecision(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return 0;
 
 	return tmc_ramp_linear_get_precision(&StepDir[channel].ramp);
@@ -556,7 +926,7 @@ uint32_t StepDir_getPrecision(uint8_t channel)
 
 int32_t StepDir_getMaxAcceleration(uint8_t channel)
 {
-	if (channel >= STEP_DIR_CHANNELS)
+	if (channel >= STEPDIR_CHANNELS)
 		return -1;
 
 	if (StepDir[channel].mode == STEPDIR_INTERNAL)
@@ -566,6 +936,64 @@ int32_t StepDir_getMaxAcceleration(uint8_t channel)
 	return s32_MAX;
 }
 
+StepDirRampType StepDir_getRampType(uint8_t channel)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return -1;
+
+	return StepDir[channel].rampType;
+}
+
+uint32_t StepDir_getJerk(uint8_t channel)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return 0;
+
+	return StepDir[channel].sCurve.jerk;
+}
+
+StepDirOutput StepDir_getOutput(uint8_t channel)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return -1;
+
+	return StepDir[channel].output;
+}
+
+// ===== Interrupt load =====
+// Average interrupt cycles per tick spent on the given channel
+uint32_t StepDir_getChannelCycles(uint8_t channel)
+{
+	if (channel >= STEPDIR_CHANNELS)
+		return 0;
+
+	return StepDir[channel].cycles;
+}
+
+// Average interrupt cycles per tick, including all channels
+uint32_t StepDir_getInterruptCycles(void)
+{
+	return interruptCycles;
+}
+
+// Longest interrupt in cycles since the last reset
+uint32_t StepDir_getInterruptMaxCycles(void)
+{
+	return interruptMaxCycles;
+}
+
+void StepDir_resetInterruptMaxCycles(void)
+{
+	interruptMaxCycles = 0;
+}
+
+// Average share of the CPU time spent in the interrupt in 0.1%.
+// 1000 means the interrupt saturates the core.
+uint32_t StepDir_getInterruptLoad(void)
+{
+	return ((uint64_t) interruptCycles * interruptFrequency * 1000) / systick_getCycleFrequency();
+}
+
 // ===================
 
 void StepDir_init(uint32_t precision)
@@ -576,8 +1004,15 @@ void StepDir_init(uint32_t precision)
 		precision = STEPDIR_FREQUENCY;
 	}
 
+	// Hand the steps back to the interrupt
+	if (timerChannel)
+	{
+		HAL.Timer->stopStepOutput();
+		timerChannel = NULL;
+	}
+
 	// StepDir Channel initialisation
-	for (uint8_t i = 0; i < STEP_DIR_CHANNELS; i++)
+	for (uint8_t i = 0; i < STEPDIR_CHANNELS; i++)
 	{
 		StepDir[i].oldVelAccu           = 0;
 		StepDir[i].oldVelocity          = 0;
@@ -594,13 +1029,28 @@ void StepDir_init(uint32_t precision)
 
 		StepDir[i].mode                 = STEPDIR_INTERNAL;
 		StepDir[i].frequency            = precision;
+		StepDir[i].output               = STEPDIR_OUTPUT_INTERRUPT;
 
 		tmc_ramp_linear_init(&StepDir[i].ramp);
 		tmc_ramp_linear_set_precision(&StepDir[i].ramp, precision);
 		tmc_ramp_linear_set_maxVelocity(&StepDir[i].ramp, STEPDIR_DEFAULT_VELOCITY);
 		tmc_ramp_linear_set_acceleration(&StepDir[i].ramp, STEPDIR_DEFAULT_ACCELERATION);
+
+		StepDir[i].rampType             = STEPDIR_RAMP_LINEAR;
+		StepDir[i].sCurve.jerk          = STEPDIR_DEFAULT_JERK;
+		resetSCurve(&StepDir[i]);
+
+		StepDir[i].cycleSum             = 0;
+		StepDir[i].cycles               = 0;
+
+		activate(i);
 	}
 
+	interruptTicks     = 0;
+	interruptCycleSum  = 0;
+	interruptCycles    = 0;
+	interruptMaxCycles = 0;
+
 	// Chip-specific hardware peripheral initialisation
 	#if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
 		// enable clock for FTM1
@@ -616,6 +1066,7 @@ void StepDir_init(uint32_t precision)
 		// actually using the bus clock
 		FTM1_CNTIN = 0;
 		FTM1_MOD   = (48000000 / precision) - 1;
+		interruptFrequency = precision;
 
 		// Select Bus clock as clock source, set prescaler divisor to 2^0 = 1,
 		// enable timer overflow interrupt
@@ -643,6 +1094,13 @@ void StepDir_init(uint32_t precision)
 
 void StepDir_deInit()
 {
+	if (timerChannel)
+	{
+		HAL.Timer->stopStepOutput();
+		timerChannel->output = STEPDIR_OUTPUT_INTERRUPT;
+		timerChannel = NULL;
+	}
+
 	#if defined(Landungsbruecke) || defined(LandungsbrueckeSmall)
 		// Only disable the module if it has been enabled before
 		if (SIM_SCGC6 & SIM_SCGC6_FTM1_MASK)
@@ -664,6 +1122,10 @@ void StepDir_deInit()
 			SIM_SCGC6 |= SIM_SCGC6_FTM1_MASK;
 			SIM_SCGC6 &= ~SIM_SCGC6_FTM1_MASK;
 		}
+	#elif defined(LandungsbrueckeV3)
+		nvic_irq_disable(TIMER2_IRQn);
+		timer_interrupt_disable(TIMER2, TIMER_INT_UP);
+		timer_disable(TIMER2);
 	#endif
 }
 
@@ -752,11 +1214,356 @@ static inline void stop(StepDirectionTypedef *channel, StepDirStop stopType)
 		channel->haltingCondition |= STATUS_EMERGENCY_STOP;
 		break;
 	case STOP_STALL:
+		// Only report the transition into the stalled state
+		if (!(channel->haltingCondition & STATUS_STALLED) && stallCallback)
+			stallCallback(channel - StepDir);
+
 		channel->haltingCondition |= STATUS_STALLED;
 		tmc_ramp_linear_set_rampVelocity(&channel->ramp, 0);
 		channel->ramp.accumulatorVelocity = 0;
 		tmc_ramp_linear_set_targetVelocity(&channel->ramp, 0);
 		channel->ramp.accelerationSteps = 0;
+		resetSCurve(channel);
 		break;
 	}
 }
+
+static void resetSCurve(StepDirectionTypedef *channel)
+{
+	StepDirSCurveTypedef *sCurve = &channel->sCurve;
+
+	sCurve->phase                    = SCURVE_IDLE;
+	sCurve->direction                = 0;
+	sCurve->braking                  = false;
+	sCurve->mirror                   = false;
+	sCurve->homing                   = false;
+	sCurve->acceleration             = 0;
+	sCurve->accumulatorAcceleration  = 0;
+	sCurve->accumulatorVelocity      = 0;
+	sCurve->accumulatorPosition      = 0;
+	sCurve->jerkTicks                = 0;
+	sCurve->constantTicks            = 0;
+	sCurve->mirrorJerkTicks          = 0;
+	sCurve->mirrorConstantTicks      = 0;
+	sCurve->jerkGain                 = 0;
+	sCurve->startVelocity            = 0;
+	sCurve->startVelocityFine        = 0;
+	sCurve->jerkGainFine             = 0;
+	sCurve->startPosition            = 0;
+	sCurve->jerkDistance             = 0;
+	sCurve->decelerationDistance     = 0;
+}
+
+// A channel is idle once its ramp has come to a rest and no acceleration
+// update is pending. Computing the ramp would not change anything then.
+static inline bool isIdle(StepDirectionTypedef *channel)
+{
+	TMC_LinearRamp *ramp = &channel->ramp;
+
+	if ((ramp->rampVelocity != 0) || (channel->syncFlag != SYNC_IDLE) || channel->stallGuardActive)
+		return false;
+
+	if (channel->sCurve.phase != SCURVE_IDLE)
+		return false;
+
+	if (ramp->rampMode == TMC_RAMP_LINEAR_MODE_VELOCITY)
+		return ramp->targetVelocity == 0;
+
+	return ramp->rampPosition == ramp->targetPosition;
+}
+
+// Acceleration change of one tick for the latched jerk, keeping the remainder
+// in the accumulator like the velocity and position calculation does.
+static inline int32_t jerkStep(StepDirSCurveTypedef *sCurve, uint32_t precision)
+{
+	sCurve->accumulatorAcceleration += sCurve->jerkLimit;
+	uint32_t da = sCurve->accumulatorAcceleration / precision;
+	sCurve->accumulatorAcceleration -= da * precision;
+
+	return sCurve->direction * (int32_t) da;
+}
+
+// Exact inverse of jerkStep(): Returns the acceleration change of the last
+// jerkStep() and restores the accumulator from before it. This lets the jerk
+// down phase replay the acceleration values of the jerk up phase backwards.
+static inline int32_t jerkStepBack(StepDirSCurveTypedef *sCurve, uint32_t precision)
+{
+	uint32_t da = 0;
+	if (sCurve->accumulatorAcceleration < sCurve->jerkLimit)
+		da = (sCurve->jerkLimit - sCurve->accumulatorAcceleration + precision - 1) / precision;
+	sCurve->accumulatorAcceleration += da * precision - sCurve->jerkLimit;
+
+	return sCurve->direction * (int32_t) da;
+}
+
+// Velocity -> position
+// The position accumulator is kept within [0, precision)
+static inline int32_t integratePosition(StepDirectionTypedef *channel, int32_t velocity, int32_t precision)
+{
+	StepDirSCurveTypedef *sCurve = &channel->sCurve;
+
+	sCurve->accumulatorPosition += velocity;
+	int32_t dx = sCurve->accumulatorPosition / precision;
+	sCurve->accumulatorPosition -= dx * precision;
+	if (sCurve->accumulatorPosition < 0)
+	{
+		sCurve->accumulatorPosition += precision;
+		dx--;
+	}
+	channel->ramp.rampPosition += dx;
+
+	return dx;
+}
+
+// Interrupt part of the S-curve generator (see "S-curve ramps" at the top).
+// Returns the position change of this tick like tmc_ramp_linear_compute().
+static inline int32_t computeSCurve(StepDirectionTypedef *channel)
+{
+	TMC_LinearRamp *ramp = &channel->ramp;
+	StepDirSCurveTypedef *sCurve = &channel->sCurve;
+	int32_t precision = ramp->precision;
+	int32_t velocity = ramp->rampVelocity;
+	int64_t velocityFine = (int64_t) velocity * precision + sCurve->accumulatorVelocity;
+	int32_t maxVelocity = MIN(ramp->maxVelocity, (uint32_t) s32_MAX);
+
+	// Position mode works with the accumulator resolution. Aiming at the middle
+	// of the target step leaves half a step of tolerance for rounding errors.
+	int64_t position = (int64_t) ramp->rampPosition * precision + sCurve->accumulatorPosition;
+	int64_t remaining = (int64_t) ramp->targetPosition * precision + precision / 2 - position;
+
+	// At low calculation rates, the shortest possible ramp can travel further
+	// than a barely missed target is away, so ramping back would pass it again.
+	// Once a ramp has passed the target, home in at the stop velocity instead,
+	// like the linear ramp does.
+	int32_t homingSteps = ramp->targetPosition - ramp->rampPosition;
+	bool wasHoming = sCurve->homing;
+	sCurve->homing = sCurve->homing && (ramp->rampMode == TMC_RAMP_LINEAR_MODE_POSITION) && (sCurve->phase == SCURVE_IDLE)
+			&& (homingSteps != 0) && ((uint32_t) abs(homingSteps) <= ramp->homingDistance)
+			&& (ramp->stopVelocity > 0) && ((uint32_t) abs(velocity) <= ramp->stopVelocity);
+	if (sCurve->homing)
+	{
+		velocity = MIN(ramp->stopVelocity, (uint32_t) maxVelocity);
+		ramp->rampVelocity = (homingSteps < 0) ? -velocity : velocity;
+		sCurve->accumulatorVelocity = 0;
+
+		int32_t dx = integratePosition(channel, ramp->rampVelocity, precision);
+		if (ramp->rampPosition == ramp->targetPosition)
+			ramp->rampVelocity = 0;
+
+		return dx;
+	}
+	else if (wasHoming)
+	{	// Target moved away -> stop from the stop velocity, a new ramp starts from standstill
+		velocity = 0;
+		velocityFine = 0;
+	}
+
+	// Determine the velocity the generator heads for
+	int32_t velocityLimit;
+	if (ramp->rampMode == TMC_RAMP_LINEAR_MODE_VELOCITY)
+	{
+		sCurve->braking = false;
+		velocityLimit = ramp->targetVelocity;
+	}
+	else
+	{
+		if (sCurve->phase == SCURVE_IDLE)
+		{
+			if (velocity == 0)
+			{	// Standstill -> a new ramp starts here
+				sCurve->braking = false;
+			}
+			else if (((remaining > 0) != (velocity > 0)) || (((remaining < 0) ? -remaining : remaining) <= sCurve->decelerationDistance + abs(velocity) / 2))
+			{	// Cruising and the deceleration distance has been reached (or the target has been passed).
+				// Half a tick of travel rounds the start of the deceleration to the nearest tick.
+				sCurve->braking = true;
+			}
+		}
+
+		if (sCurve->braking)
+			velocityLimit = 0;
+		else if ((sCurve->phase == SCURVE_IDLE) && (velocity != 0))
+			velocityLimit = (velocity > 0) ? MIN(velocity, maxVelocity) : MAX(velocity, -maxVelocity);
+		else if (ramp->rampPosition != ramp->targetPosition)
+			velocityLimit = (remaining > 0) ? maxVelocity : -maxVelocity;
+		else
+			velocityLimit = 0;
+	}
+
+	bool done = false;
+	switch (sCurve->phase)
+	{
+	case SCURVE_IDLE:
+		if ((velocity == velocityLimit) || (ramp->acceleration == 0) || (sCurve->jerk == 0))
+			break;
+
+		// Start a new velocity change. Braking after an acceleration from
+		// standstill replays that acceleration, including its latched limits.
+		sCurve->mirror = sCurve->mirror && sCurve->braking;
+		if (!sCurve->mirror)
+		{
+			sCurve->accelerationLimit = ramp->acceleration;
+			sCurve->jerkLimit         = sCurve->jerk;
+		}
+		sCurve->direction               = (velocityLimit > velocity) ? 1 : -1;
+		sCurve->accumulatorAcceleration = 0;
+		sCurve->jerkTicks               = 0;
+		sCurve->constantTicks           = 0;
+		sCurve->startVelocity           = velocity;
+		sCurve->startVelocityFine       = velocityFine;
+		sCurve->startPosition           = position;
+		sCurve->phase                   = SCURVE_JERK_UP;
+		// fall through
+	case SCURVE_JERK_UP:
+		sCurve->jerkGain     = sCurve->direction * (velocity - sCurve->startVelocity);
+		sCurve->jerkGainFine = sCurve->direction * (velocityFine - sCurve->startVelocityFine);
+		sCurve->jerkDistance = sCurve->direction * (position - sCurve->startPosition);
+
+		sCurve->acceleration += jerkStep(sCurve, precision);
+		sCurve->jerkTicks++;
+
+		if ((uint32_t) abs(sCurve->acceleration) > sCurve->accelerationLimit)
+		{	// Acceleration limit reached -> revert the step of this tick
+			sCurve->acceleration -= jerkStepBack(sCurve, precision);
+			if (--sCurve->jerkTicks == 0)
+				sCurve->acceleration = sCurve->direction * (int32_t) sCurve->accelerationLimit;
+			sCurve->phase = SCURVE_CONSTANT;
+		}
+		break;
+	case SCURVE_CONSTANT:
+		break;
+	case SCURVE_JERK_DOWN:
+		// Replay the acceleration values of the jerk up phase backwards, so that
+		// the whole velocity change is symmetric. The change is done once the
+		// first value of the jerk up phase has been applied.
+		sCurve->acceleration -= jerkStepBack(sCurve, precision);
+		done = (--sCurve->jerkTicks <= 1);
+		break;
+	}
+
+	if (sCurve->phase == SCURVE_CONSTANT)
+		sCurve->constantTicks++;
+
+	if ((sCurve->phase == SCURVE_JERK_UP) || (sCurve->phase == SCURVE_CONSTANT))
+	{
+		bool fallDown;
+
+		if (sCurve->mirror)
+		{	// Replay the phase durations of the acceleration
+			fallDown = (sCurve->phase == SCURVE_JERK_UP)
+					? (sCurve->mirrorConstantTicks == 0) && (sCurve->jerkTicks >= sCurve->mirrorJerkTicks)
+					: (sCurve->constantTicks >= sCurve->mirrorConstantTicks);
+		}
+		else
+		{
+			// The jerk down phase replays the jerk up phase, so the velocity
+			// gained until the end of the change is the jerk up gain (including
+			// this tick when still rising). One more tick of margin avoids
+			// overshooting the velocity limit.
+			int64_t gain = sCurve->jerkGainFine + abs(sCurve->acceleration);
+			if (sCurve->phase == SCURVE_JERK_UP)
+				gain += abs(sCurve->acceleration);
+
+			fallDown = sCurve->direction * ((int64_t) velocityLimit * precision - velocityFine) <= gain;
+
+			// Positioning from standstill: The deceleration mirrors the acceleration,
+			// so the acceleration may only cover half of the distance.
+			// Distance of the jerk down phase: peak velocity * duration - jerk up distance
+			if (!fallDown && !sCurve->braking && (ramp->rampMode == TMC_RAMP_LINEAR_MODE_POSITION) && (sCurve->startVelocity == 0))
+			{
+				int64_t peakVelocity = abs(velocity) + sCurve->jerkGain;
+				int64_t accelerationDistance = sCurve->direction * (position - sCurve->startPosition)
+						+ peakVelocity * sCurve->jerkTicks
+						- sCurve->jerkDistance;
+
+				fallDown = 2 * accelerationDistance >= sCurve->direction * (remaining + position - sCurve->startPosition);
+			}
+		}
+
+		if (fallDown)
+		{
+			if (!sCurve->mirror)
+			{
+				sCurve->mirrorJerkTicks     = sCurve->jerkTicks;
+				sCurve->mirrorConstantTicks = sCurve->constantTicks;
+			}
+			sCurve->phase = SCURVE_JERK_DOWN;
+			done = (sCurve->jerkTicks <= 1);
+		}
+	}
+
+	// Acceleration -> velocity
+	// The velocity is rounded to the nearest integer (accumulator within
+	// [-precision/2, precision/2)), so that the rounding errors of accelerating
+	// and decelerating cancel out in both directions.
+	sCurve->accumulatorVelocity += sCurve->acceleration;
+	int32_t dv = sCurve->accumulatorVelocity / precision;
+	sCurve->accumulatorVelocity -= dv * precision;
+	if (sCurve->accumulatorVelocity >= precision / 2)
+	{
+		sCurve->accumulatorVelocity -= precision;
+		dv++;
+	}
+	else if (sCurve->accumulatorVelocity < -precision / 2)
+	{
+		sCurve->accumulatorVelocity += precision;
+		dv--;
+	}
+	velocity += dv;
+
+	if (done)
+	{	// Velocity change finished
+		sCurve->phase = SCURVE_IDLE;
+		sCurve->acceleration = 0;
+		sCurve->accumulatorAcceleration = 0;
+
+		if (sCurve->braking)
+		{	// Absorb the rounding errors at standstill
+			velocity = 0;
+			sCurve->accumulatorVelocity = 0;
+			sCurve->braking = false;
+			sCurve->mirror = false;
+			// The braking acceleration points towards the target -> it has been passed
+			sCurve->homing = (ramp->rampMode == TMC_RAMP_LINEAR_MODE_POSITION) && (sCurve->direction * homingSteps > 0);
+		}
+		else if (ramp->rampMode == TMC_RAMP_LINEAR_MODE_VELOCITY)
+		{	// Absorb the rounding errors at the target velocity
+			if (abs(velocityLimit - velocity) <= (sCurve->jerkGain >> 4) + 1)
+			{
+				velocity = velocityLimit;
+				sCurve->accumulatorVelocity = 0;
+			}
+		}
+		else
+		{	// Accelerated from standstill -> the deceleration replays the
+			// acceleration and takes the same distance (see below).
+			// Otherwise the stored distance is too long and the generator
+			// stops early, followed by a short ramp to the target.
+			sCurve->mirror = (sCurve->startVelocity == 0);
+		}
+	}
+
+	// Rounding errors must not break the velocity limit
+	if (ramp->rampMode == TMC_RAMP_LINEAR_MODE_POSITION)
+		velocity = MIN(MAX(velocity, -maxVelocity), maxVelocity);
+
+	// Nor pass the velocity the change heads for. With large jerk steps at a low
+	// precision, the end of a change can overshoot the target velocity, or
+	// briefly reverse the motor at the end of a braking ramp.
+	if ((sCurve->direction * (ramp->rampVelocity - velocityLimit) <= 0) && (sCurve->direction * (velocity - velocityLimit) > 0))
+		velocity = velocityLimit;
+	if (channel->mode == STEPDIR_INTERNAL)
+		velocity = MIN(MAX(velocity, -maxStepRate(channel)), maxStepRate(channel));
+	ramp->rampVelocity = velocity;
+
+	int32_t dx = integratePosition(channel, velocity, precision);
+
+	if (done && sCurve->mirror)
+	{	// Driving the same velocities in reverse order skips the last tick at the
+		// reached velocity and adds one at standstill instead.
+		position = (int64_t) ramp->rampPosition * precision + sCurve->accumulatorPosition;
+		sCurve->decelerationDistance = sCurve->direction * (position - sCurve->startPosition) - abs(velocity);
+	}
+
+	return dx;
+}
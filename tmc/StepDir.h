@@ -19,14 +19,53 @@
 	#define STEPDIR_MAX_ACCELERATION  2147418111        // Limit: Highest value above accumulator digits (0xFFFE0000).
 	                                                    // Any value above would lead to acceleration overflow whenever the accumulator digits overflow
 
+	#define STEPDIR_MAX_JERK          2147418111        // Limit: Same accumulator constraint as the acceleration
+
 	#define STEPDIR_DEFAULT_ACCELERATION 100000
 	#define STEPDIR_DEFAULT_VELOCITY STEPDIR_MAX_VELOCITY
+	#define STEPDIR_DEFAULT_JERK 1000000
+
+	// Number of StepDir channels. Boards driving more motors from the connector
+	// and extension header GPIOs can raise this at build time.
+	#ifndef STEPDIR_CHANNELS
+	#define STEPDIR_CHANNELS          2
+	#endif
+	#define STEPDIR_MAX_CHANNELS      32                // Limit: Width of the active channel bitmask
+
+	#if STEPDIR_CHANNELS > STEPDIR_MAX_CHANNELS
+	#error "STEPDIR_CHANNELS exceeds STEPDIR_MAX_CHANNELS"
+	#endif
+
+	// Interrupt cycle measurements are averaged over 2^STEPDIR_CYCLE_WINDOW ticks
+	#define STEPDIR_CYCLE_WINDOW      12
+
+	// Timer step output
+	#define STEPDIR_SEGMENT_FREQUENCY  (1 << 13)   // Ramp calculation rate, one pulse train segment each
+	#define STEPDIR_SEGMENTS           16          // Segment buffer, refilled in two halves
+	#define STEPDIR_TIMER_MAX_VELOCITY (1 << 18)   // Limit: Timing resolution of the step periods (see StepDir.c)
 
 	typedef enum {
 		STEPDIR_INTERNAL = 0,
 		STEPDIR_EXTERNAL = 1
 	} StepDirMode; // Has to be set explicitly here because IDE relies on this number.
 
+	typedef enum {
+		STEPDIR_RAMP_LINEAR = 0,
+		STEPDIR_RAMP_SCURVE = 1
+	} StepDirRampType; // Has to be set explicitly here because IDE relies on this number.
+
+	typedef enum {
+		STEPDIR_OUTPUT_INTERRUPT = 0,
+		STEPDIR_OUTPUT_TIMER     = 1
+	} StepDirOutput; // Has to be set explicitly here because IDE relies on this number.
+
+	typedef enum {
+		SCURVE_IDLE,       // Constant velocity (or standstill), acceleration is zero
+		SCURVE_JERK_UP,    // Acceleration magnitude rising with the jerk
+		SCURVE_CONSTANT,   // Acceleration magnitude at the acceleration limit
+		SCURVE_JERK_DOWN   // Acceleration magnitude falling back to zero
+	} StepDirSCurvePhase;
+
 	typedef enum {
 		STOP_NORMAL,
 		STOP_EMERGENCY,
@@ -40,6 +79,9 @@
 		SYNC_UPDATE_DATA          // Main code calculated an accelerationSteps difference which the interrupt needs to apply.
 	} StepDirSync;
 
+	// Called from the StepDir interrupt when a channel stops on a stall
+	typedef void (*StepDirStallCallback)(uint8_t channel);
+
 	// StepDir status bits
 	#define STATUS_EMERGENCY_STOP     0x01  // Halting condition - Emergency Off
 	#define STATUS_NO_STEP_PIN        0x02  // Halting condition - No pin set for Step output
@@ -49,6 +91,36 @@
 	#define STATUS_STALLGUARD_ACTIVE  0x20  // Stallguard status - Velocity threshold reached, Stallguard enabled
 	#define STATUS_MODE               0x40  // 0: Positioning mode, 1: Velocity mode
 
+	typedef struct
+	{	// Parameters
+		uint32_t            jerk;
+		// Velocity change in progress
+		StepDirSCurvePhase  phase;
+		int8_t              direction;              // Sign of the velocity change
+		bool                braking;                // Position mode: velocity change towards standstill at the target
+		bool                mirror;                 // Position mode: braking mirrors the acceleration from standstill
+		bool                homing;                 // Position mode: the last ramp passed the target, home in at the stop velocity
+		uint32_t            accelerationLimit;      // Acceleration and jerk are latched at the start of each velocity change
+		uint32_t            jerkLimit;
+		int32_t             acceleration;
+		uint32_t            accumulatorAcceleration;
+		int32_t             accumulatorVelocity;
+		int32_t             accumulatorPosition;
+		uint32_t            jerkTicks;              // Duration of the jerk up phase, replayed backwards by the jerk down phase
+		uint32_t            constantTicks;
+		uint32_t            mirrorJerkTicks;        // Phase durations of the acceleration from standstill
+		uint32_t            mirrorConstantTicks;
+		int32_t             jerkGain;               // Velocity gained during the jerk up phase
+		int32_t             startVelocity;
+		// Velocities in pps * precision (the velocity accumulator resolution)
+		int64_t             startVelocityFine;
+		int64_t             jerkGainFine;
+		// Position mode distances in steps * precision (the position accumulator resolution)
+		int64_t             startPosition;
+		int64_t             jerkDistance;           // Distance driven during the jerk up phase
+		int64_t             decelerationDistance;   // Distance of the acceleration from standstill
+	} StepDirSCurveTypedef;
+
 	typedef struct
 	{	// Generic parameters
 		uint8_t       haltingCondition;
@@ -70,8 +142,15 @@
 		int32_t       stepDifference;
 		StepDirMode   mode;
 		uint32_t      frequency;
+		StepDirOutput output;
 
+		StepDirRampType rampType;
 		TMC_LinearRamp ramp;
+		StepDirSCurveTypedef sCurve;
+
+		// Interrupt cycles spent on this channel
+		uint32_t      cycleSum;   // Sum of the current measurement window
+		uint32_t      cycles;     // Average per tick of the last measurement window
 	} StepDirectionTypedef;
 
 	void StepDir_rotate(uint8_t channel, int32_t velocity);
@@ -81,6 +160,7 @@
 	uint8_t StepDir_getStatus(uint8_t channel);
 	void StepDir_setPins(uint8_t channel, IOPinTypeDef *stepPin, IOPinTypeDef *dirPin, IOPinTypeDef *stallPin);
 	void StepDir_stallGuard(uint8_t channel, bool stall);
+	void StepDir_setStallCallback(StepDirStallCallback callback);
 
 	// ===== Setters =====
 	void StepDir_setActualPosition(uint8_t channel, int32_t actualPosition);
@@ -90,6 +170,9 @@
 	void StepDir_setMode(uint8_t channel, StepDirMode mode);
 	void StepDir_setFrequency(uint8_t channel, uint32_t frequency);
 	void StepDir_setPrecision(uint8_t channel, uint32_t precision);
+	bool StepDir_setRampType(uint8_t channel, StepDirRampType rampType);
+	void StepDir_setJerk(uint8_t channel, uint32_t jerk);
+	bool StepDir_setOutput(uint8_t channel, StepDirOutput output);
 	// ===== Getters =====
 	int32_t StepDir_getActualPosition(uint8_t channel);
 	int32_t StepDir_getTargetPosition(uint8_t channel);
@@ -102,6 +185,16 @@
 	uint32_t StepDir_getFrequency(uint8_t channel);
 	uint32_t StepDir_getPrecision(uint8_t channel);
 	int32_t StepDir_getMaxAcceleration(uint8_t channel);
+	StepDirRampType StepDir_getRampType(uint8_t channel);
+	uint32_t StepDir_getJerk(uint8_t channel);
+	StepDirOutput StepDir_getOutput(uint8_t channel);
+
+	// ===== Interrupt load =====
+	uint32_t StepDir_getChannelCycles(uint8_t channel);
+	uint32_t StepDir_getInterruptCycles(void);
+	uint32_t StepDir_getInterruptMaxCycles(void);
+	void StepDir_resetInterruptMaxCycles(void);
+	uint32_t StepDir_getInterruptLoad(void);
 
 	void StepDir_init(uint32_t precision);
 	void StepDir_deInit(void);
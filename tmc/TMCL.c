@@ -38,7 +38,6 @@
 #define SERIAL_MODULE_ADDRESS  1
 #define SERIAL_HOST_ADDRESS    2
 
-// todo CHECK 2: these are unused - delete? (LH) #11
 // tmcl interpreter states
 #define TM_IDLE      0
 #define TM_RUN       1
@@ -65,6 +64,82 @@
 #define MVP_REL  1
 #define MVP_PRF  2
 
+// Register block read variants
+#define REGISTER_BLOCK_USE_LIST   0x80000000 // Value flag: Read the addresses stored in the register list
+#define REGISTER_BLOCK_COUNT_MASK 0x0000FFFF
+
+// Register list
+#define REGISTER_LIST_SIZE        128
+#define REGISTER_LIST_CLEAR       0
+#define REGISTER_LIST_APPEND      1
+#define REGISTER_LIST_GET_COUNT   2
+#define REGISTER_LIST_APPLY       3
+
+// Register list apply options
+#define REGISTER_LIST_APPLY_DISABLE_DRIVER  0x00000001 // Keep the driver disabled while writing
+#define REGISTER_LIST_APPLY_VERIFY          0x00000002 // Read back each register and compare
+
+// Telemetry
+#define TELEMETRY_MAX_CHANNELS    16
+#define TELEMETRY_CLEAR           0
+#define TELEMETRY_ADD_CHANNEL     1
+#define TELEMETRY_SET_PERIOD      2
+#define TELEMETRY_GET_CHANNELS    3
+#define TELEMETRY_GET_PERIOD      4
+
+// Script engine
+#define SCRIPT_SIZE               256 // Instructions
+#define SCRIPT_STACK_SIZE         8   // Subroutine nesting depth
+#define SCRIPT_DEFAULT_BUDGET     16  // Instructions per tmcl_process() pass
+#define SCRIPT_WAIT_TICK          10  // ms per WAIT tick
+#define SCRIPT_AP_POSITION_REACHED 8  // Axis parameter: Position reached flag
+
+// WAIT conditions
+#define SCRIPT_WAIT_TICKS         0
+#define SCRIPT_WAIT_POSITION      1
+
+// JC conditions
+#define SCRIPT_JC_ZE              0
+#define SCRIPT_JC_NZ              1
+#define SCRIPT_JC_EQ              2
+#define SCRIPT_JC_NE              3
+#define SCRIPT_JC_GT              4
+#define SCRIPT_JC_GE              5
+#define SCRIPT_JC_LT              6
+#define SCRIPT_JC_LE              7
+#define SCRIPT_JC_ETO             8
+
+// CALC/CALCX operations
+#define SCRIPT_CALC_ADD           0
+#define SCRIPT_CALC_SUB           1
+#define SCRIPT_CALC_MUL           2
+#define SCRIPT_CALC_DIV           3
+#define SCRIPT_CALC_MOD           4
+#define SCRIPT_CALC_AND           5
+#define SCRIPT_CALC_OR            6
+#define SCRIPT_CALC_XOR           7
+#define SCRIPT_CALC_NOT           8
+#define SCRIPT_CALC_LOAD          9
+#define SCRIPT_CALC_SWAP          10 // CALCX only
+
+// Script error flags
+#define SCRIPT_FLAG_TIMEOUT       0x01 // A WAIT ran into its timeout
+
+// Events
+#define EVENT_GLOBAL              255  // EI/DI type: All events
+#define EVENT_NO_VECTOR           0xFFFF
+#define EVENT_INPUT_COUNT         (TMCL_EVENT_INPUT_1 - TMCL_EVENT_INPUT_0 + 1)
+
+// SetEvent value flags
+#define EVENT_NOTIFY_HOST         0x00000001 // Push a notification to the interface of the SetEvent command
+#define EVENT_WATCH_INPUT         0x00000002 // Input events only: Poll the GIO input given in bits 8..15 (type) and the motor parameter
+#define EVENT_WATCH_PIN           0x00000004 // Input events only: Watch the pin with the ID given in bits 8..15 with an edge interrupt
+#define EVENT_WATCH_TYPE_SHIFT    8
+
+// Host notifications carry the event number in bits 0..7 and the source
+// (StepDir channel of a stall event) in bits 8..15
+#define EVENT_ARGUMENT_SHIFT      8
+
 // GetVersion() Format types
 #define VERSION_FORMAT_ASCII      0
 #define VERSION_FORMAT_BINARY     1
@@ -81,19 +156,51 @@
 
 extern const char VersionString[8];
 extern void enterBootloader();
+extern void prepareBootloader();
+extern void startBootloader();
 
 void ExecuteActualCommand();
 uint8_t setTMCLStatus(uint8_t evalError);
-void rx(RXTXTypeDef *RXTX);
+bool rx(RXTXTypeDef *RXTX, TMCLCommandTypeDef *command);
 void tx(RXTXTypeDef *RXTX);
 
 // ToDo: Move this to the USB HAL?
 #define USB_BUFFER_SIZE 256
 // Maximum extra data to send, including the TMCL reply, excluding the CRC checksum
 #define USB_MAX_EXTRA_DATA (USB_BUFFER_SIZE - 9)
+// The serial interfaces share the replyBuffer. Their txN() takes an 8 bit length,
+// so the complete frame (TMCL reply, extra data, CRC checksum) has to fit into 255 bytes.
+#define SERIAL_MAX_EXTRA_DATA (USB_BUFFER_SIZE - 1 - 9)
 uint8_t replyBuffer[USB_BUFFER_SIZE];
 uint32_t extraDataSize = 0;
 
+// Command pipelining
+// Received datagrams are parsed into a per-interface command queue. Each
+// tmcl_process() call drains up to commandsPerPass queued commands (bounded
+// by processTimeBudget) and collects the replies in a per-interface reply
+// queue, which is sent out in one transfer at the end of the pass.
+#define TMCL_COMMAND_QUEUE_SIZE   8
+#define TMCL_REPLY_QUEUE_SIZE     8
+#define TMCL_DATAGRAM_SIZE        9
+
+#define TMCL_DEFAULT_COMMANDS_PER_PASS    TMCL_COMMAND_QUEUE_SIZE
+#define TMCL_DEFAULT_PROCESS_TIME_BUDGET  500 // µs, 0 = unlimited
+
+typedef struct
+{
+    TMCLCommandTypeDef commands[TMCL_COMMAND_QUEUE_SIZE];
+    uint32_t rxTick[TMCL_COMMAND_QUEUE_SIZE]; // Cycle tick of parsing the datagram
+    uint32_t read;
+    uint32_t count;
+} TMCLCommandQueueTypeDef;
+
+typedef struct
+{
+    uint8_t buffer[TMCL_REPLY_QUEUE_SIZE * TMCL_DATAGRAM_SIZE];
+    uint32_t rxTick[TMCL_REPLY_QUEUE_SIZE];   // Cycle tick of the answered command
+    uint32_t count;
+} TMCLReplyQueueTypeDef;
+
 static uint16_t getExtendedAddress(TMCLCommandTypeDef *tmclCommand)
 {
     return (((uint16_t) tmclCommand->Motor >> 4) << 8) | tmclCommand->Type;
@@ -110,7 +217,6 @@ static void boardsErrors(void);
 static void boardsReset(void);
 static void boardsMeasuredSpeed(void);
 static void setDriversEnable(void);
-static void checkIDs(void);
 static bool checkBoardTypes();
 static void SoftwareReset(void);
 static void GetVersion(void);
@@ -120,6 +226,62 @@ static void HandleWlanCommand(void);
 static int handleRamDebug(uint8_t type, uint8_t motor, uint32_t *data);
 static void handleGetInfo(void);
 static void handleOTP(void);
+static void readRegisterBlock(EvalboardFunctionsTypeDef *ch, uint32_t brownOutMask);
+static void handleRegisterList(void);
+static void appendRegisterListEntry(uint16_t address, uint8_t motor, int32_t value, bool write);
+static void applyRegisterList(void);
+static void handleTelemetry(void);
+static void telemetry_process(void);
+static void ramdebugStream_process(void);
+static void encodeReply(uint8_t *datagram);
+static void queueReply(uint32_t interface);
+static void flushReplies(uint32_t interface);
+static bool hasTxSpace(uint32_t interface, uint32_t bytes);
+static bool reportsTxSpace(uint32_t interface);
+static void stats_recordLatency(uint32_t rxTick);
+static void stats_recordPass(void);
+static void stats_reset(void);
+static void stats_appendBlock(void);
+static void handleTicket(void);
+static void processJobs(void);
+static void handleApplStop(void);
+static void handleApplRun(void);
+static void handleApplStep(void);
+static void handleApplReset(void);
+static void handleDownloadStart(void);
+static void handleDownloadEnd(void);
+static void handleReadMem(void);
+static void handleGetStatus(void);
+static void script_store(void);
+static void script_process(void);
+static void handleSetEvent(void);
+static void handleEI(void);
+static void handleDI(void);
+static void handleVECT(void);
+static void events_process(void);
+static void events_onEdge(IOPinTypeDef *pin);
+static void events_onStall(uint8_t channel);
+
+typedef void (*TMCLHandler)(void);
+static const TMCLHandler opcodeHandlers[256];
+
+// Commands that get routed to the Evalboard channel supporting them
+typedef enum {
+    ROUTE_ROR,
+    ROUTE_ROL,
+    ROUTE_MST,
+    ROUTE_MVP,
+    ROUTE_SAP,
+    ROUTE_GAP,
+    ROUTE_STAP,
+    ROUTE_MIN,
+    ROUTE_MAX,
+    ROUTE_UF4,
+
+    ROUTE_END
+} TMCLRoute;
+
+typedef uint32_t (*TMCLRoutedCall)(EvalboardFunctionsTypeDef *ch);
 
 TMCLCommandTypeDef ActualCommand;
 TMCLReplyTypeDef ActualReply;
@@ -129,6 +291,199 @@ uint32_t currentInterface = 0;
 uint32_t resetRequest = 0;
 uint32_t maxExtraData[ARRAY_SIZE(interfaces)];
 
+static TMCLCommandQueueTypeDef commandQueues[ARRAY_SIZE(interfaces)];
+static TMCLReplyQueueTypeDef replyQueues[ARRAY_SIZE(interfaces)];
+static uint32_t commandsPerPass    = TMCL_DEFAULT_COMMANDS_PER_PASS;
+static uint32_t processTimeBudget  = TMCL_DEFAULT_PROCESS_TIME_BUDGET;
+
+typedef struct
+{
+    uint16_t address;
+    uint8_t  motor;
+    int32_t  value;
+    bool     write; // Added by TMCL_writeRegisterListEntry, written by REGISTER_LIST_APPLY
+} RegisterListEntryTypeDef;
+
+static RegisterListEntryTypeDef registerList[REGISTER_LIST_SIZE];
+static uint32_t registerListCount = 0;
+
+// Channel routing bitmaps, indexed by route, motor and command type
+#define ROUTE_MOTORS 4 // Commands for higher motor numbers are not remembered
+static uint32_t routeKnown[ROUTE_END][ROUTE_MOTORS][256 / 32];  // Bit set: Supporting channel is known
+static uint32_t routeCh2[ROUTE_END][ROUTE_MOTORS][256 / 32];    // Bit set: ch2 supports the command, otherwise ch1
+
+// Executed commands per opcode
+static uint32_t opcodeHits[256];
+
+// Command path instrumentation
+// All times are taken in CPU cycles (wrap-safe for up to 2^32 cycles) and
+// converted to µs on readout. The latency is measured from parsing a datagram
+// out of the interface buffer until its reply is handed to the interface.
+// Latency histogram bucket n counts latencies below 2^n µs, the last bucket
+// counts all larger ones.
+#define TMCL_STATS_LATENCY_BUCKETS  16
+
+static uint32_t opcodeMaxCycles[256];   // Longest handler execution per opcode
+static uint64_t opcodeCycles[256];      // Summed handler execution per opcode
+
+static struct
+{
+    uint32_t commands[ARRAY_SIZE(interfaces)];        // Executed commands per interface
+    uint32_t checksumErrors[ARRAY_SIZE(interfaces)];  // Received datagrams with checksum error per interface
+    uint32_t replies;
+    uint64_t latencyCycles;
+    uint32_t latencyMaxCycles;
+    uint32_t latencyHistogram[TMCL_STATS_LATENCY_BUCKETS];
+    uint32_t passes;
+    uint64_t passCycles;
+    uint32_t passMinCycles;
+    uint32_t passMaxCycles;
+    uint32_t passLastCycles;
+    uint32_t lastPassTick;
+    bool     passStarted;     // lastPassTick is valid
+    uint32_t currentRxTick;   // Receive tick of the command being executed
+} stats = { .passMinCycles = UINT32_MAX };
+
+// Telemetry subscription
+typedef struct
+{
+    uint8_t type;          // RAMDebugSource
+    uint8_t eval_channel;
+    uint32_t address;
+} TelemetryChannelTypeDef;
+
+static struct
+{
+    TelemetryChannelTypeDef channels[TELEMETRY_MAX_CHANNELS];
+    uint32_t channelCount;
+    uint32_t period;        // ms, 0 = disabled
+    uint32_t lastTick;
+    uint32_t interface;
+    uint32_t sequence;
+} telemetry;
+
+// RAMDebug streaming
+// Streamed samples are sent as TMCL_RamDebugStream frames: The value holds a
+// frame sequence number, the extra data holds the amount of sampling points
+// dropped so far, followed by the samples. Frames are sent once they are
+// full or after RAMDEBUG_STREAM_FLUSH_INTERVAL.
+#define RAMDEBUG_STREAM_FLUSH_INTERVAL  10 // ms
+
+static struct
+{
+    uint32_t interface;
+    uint32_t sequence;
+    uint32_t lastTick;
+} ramdebugStream;
+
+// Asynchronous commands
+// Long running commands are split into steps. The first step runs right away,
+// the following ones get advanced once per tmcl_process() pass. If the command
+// does not finish within its first step, it is answered with REPLY_DELAYED and
+// a ticket number as value (ticket 0: No free job slot, retry later).
+// The result is collected with TMCL_Ticket (type 0, value = ticket) or by
+// sending the identical command again.
+#define TMCL_JOB_COUNT           4
+#define TMCL_JOB_RESULT_TIMEOUT  10000 // ms, unclaimed results are dropped afterwards
+#define TMCL_BOOT_DELAY          500   // ms, time for the host to notice the USB disconnect
+
+typedef struct TMCLJob TMCLJobTypeDef;
+
+// Advances a job by one step. Called with ActualCommand set to the command of the job.
+// Returns true once the job is finished, with the result in ActualReply.
+typedef bool (*TMCLJobStep)(TMCLJobTypeDef *job);
+
+struct TMCLJob
+{
+    TMCLCommandTypeDef command;
+    TMCLJobStep step;    // NULL: Slot unused
+    uint32_t state;      // Step function specific
+    uint32_t tick;       // Step function specific while running, completion time afterwards
+    uint32_t interface;
+    int32_t value;
+    uint8_t status;      // REPLY_DELAYED while running
+    uint8_t ticket;
+};
+
+static TMCLJobTypeDef jobs[TMCL_JOB_COUNT];
+static bool bootPending = false; // Boards and USB are shut down, only the boot job is left to run
+static uint8_t lastTicket = 0;
+
+// Script engine
+// Programs are downloaded into RAM between DownloadStart and DownloadEnd and
+// executed cooperatively: Each tmcl_process() pass runs up to script.budget
+// instructions. Instructions without special script semantics are executed
+// through the regular opcode handlers.
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t type;
+    uint8_t motor;
+    int32_t value;
+} TMCLInstructionTypeDef;
+
+static struct
+{
+    TMCLInstructionTypeDef program[SCRIPT_SIZE];
+    uint32_t state;            // TM_IDLE, TM_RUN, TM_STEP or TM_DOWNLOAD
+    uint32_t pc;
+    uint32_t downloadAddress;
+    int32_t accu;
+    int32_t x;
+    int32_t compare;           // Result of the last COMP/CALC: <0, 0, >0
+    uint32_t flags;
+    uint32_t stack[SCRIPT_STACK_SIZE];
+    uint32_t stackDepth;
+    bool waiting;              // A WAIT instruction is in progress
+    uint32_t waitStart;
+    uint32_t budget;
+    uint8_t errorStatus;       // Reply status of the instruction that stopped the script
+    uint32_t errorAddress;
+} script = { .budget = SCRIPT_DEFAULT_BUDGET, .errorStatus = REPLY_OK };
+
+// Events
+// Sources (interrupts included) only set a pending flag. events_process() then
+// pushes host notifications and runs the script interrupt vectors.
+// Input events either poll a GIO input each pass or get fired right from the
+// edge interrupt of a pin (see EVENT_WATCH_PIN).
+// The stall event is shared by all StepDir channels, each stalled channel
+// gets its own notification.
+static volatile uint8_t pendingEvents[TMCL_EVENT_COUNT];
+static volatile uint8_t stalledChannels[STEPDIR_CHANNELS];
+
+static struct
+{
+    uint16_t vector[TMCL_EVENT_COUNT];      // Script address, EVENT_NO_VECTOR = none
+    uint32_t enabled;                       // Bitmask of events allowed to interrupt the script
+    bool globalEnable;
+    uint32_t vectorPending;                 // Bitmask of events waiting for their vector to run
+    uint32_t notify;                        // Bitmask of events pushed to the host
+    uint32_t notifyPending;                 // Bitmask of notifications waiting for room on their interface
+    uint32_t stallNotifyPending;            // Bitmask of StepDir channels with a stall notification waiting
+    uint8_t notifyInterface[TMCL_EVENT_COUNT];
+    struct
+    {
+        IOPinTypeDef *pin;  // Pin watched with an edge interrupt, NULL: None
+        bool watched;       // GIO input polled
+        bool known;     // state holds a valid reading
+        uint8_t type;
+        uint8_t motor;
+        bool state;
+    } inputs[EVENT_INPUT_COUNT];
+
+    // Script context saved while an interrupt vector runs
+    bool inInterrupt;
+    uint32_t savedPC;
+    int32_t savedCompare;
+    bool savedWaiting;
+    uint32_t savedWaitStart;
+} events;
+
+static bool startJob(TMCLJobStep step);
+static bool idDetectionJob(TMCLJobTypeDef *job);
+static bool writeIdEepromJob(TMCLJobTypeDef *job);
+static bool bootJob(TMCLJobTypeDef *job);
+
 
 #if defined(Landungsbruecke) || defined(LandungsbrueckeSmall) || defined(LandungsbrueckeV3)
     extern struct BootloaderConfig BLConfig;
@@ -177,1101 +532,3022 @@ void ExecuteActualCommand()
         return;
     }
 
-    switch(ActualCommand.Opcode)
+    if (script.state == TM_DOWNLOAD && ActualCommand.Opcode != TMCL_DownloadEnd)
     {
-    case TMCL_ROR:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.right(ActualCommand.Motor, ActualCommand.Value.Int32)) & TMC_ERROR_FUNCTION)
-        {
-            setTMCLStatus(Evalboards.ch2.right(ActualCommand.Motor, ActualCommand.Value.Int32));
-        }
-        break;
-    case TMCL_ROL:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.left(ActualCommand.Motor, ActualCommand.Value.Int32)) & TMC_ERROR_FUNCTION)
-        {
-            setTMCLStatus(Evalboards.ch2.left(ActualCommand.Motor, ActualCommand.Value.Int32));
-        }
-        break;
-    case TMCL_MST:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.stop(ActualCommand.Motor)) & TMC_ERROR_FUNCTION)
-        {
-            setTMCLStatus(Evalboards.ch2.stop(ActualCommand.Motor));
-        }
-        break;
-    case TMCL_MVP:
-        // if function doesn't exist for ch1 try ch2
-        switch(ActualCommand.Type)
-        {
-        case MVP_ABS: // move absolute
-            if(setTMCLStatus(Evalboards.ch1.moveTo(ActualCommand.Motor, ActualCommand.Value.Int32)) & TMC_ERROR_FUNCTION)
-            {
-                setTMCLStatus(Evalboards.ch2.moveTo(ActualCommand.Motor, ActualCommand.Value.Int32));
-            }
-            break;
-        case MVP_REL: // move relative
-            if(setTMCLStatus(Evalboards.ch1.moveBy(ActualCommand.Motor, &ActualCommand.Value.Int32)) & TMC_ERROR_FUNCTION)
-            {
-                setTMCLStatus(Evalboards.ch2.moveBy(ActualCommand.Motor, &ActualCommand.Value.Int32));
-            }
-            ActualReply.Value.Int32 = ActualCommand.Value.Int32;
-            break;
-        case MVP_PRF:
-            if(setTMCLStatus(Evalboards.ch1.moveProfile(ActualCommand.Motor, ActualCommand.Value.Int32)) & TMC_ERROR_FUNCTION)
-            {
-                setTMCLStatus(Evalboards.ch2.moveProfile(ActualCommand.Motor, ActualCommand.Value.Int32));
-            }
-            break;
-        default:
-            ActualReply.Status = REPLY_INVALID_TYPE;
-            break;
-        }
-        break;
-    case TMCL_SAP:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.SAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32)) & (TMC_ERROR_TYPE | TMC_ERROR_FUNCTION))
-        {
-            setTMCLStatus(Evalboards.ch2.SAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32));
-        }
-        break;
-    case TMCL_GAP:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.GAP(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32)) & (TMC_ERROR_TYPE | TMC_ERROR_FUNCTION))
-        {
-            setTMCLStatus(Evalboards.ch2.GAP(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32));
-        }
-        break;
-    case TMCL_STAP:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.STAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32)) & (TMC_ERROR_TYPE | TMC_ERROR_FUNCTION))
-        {
-            setTMCLStatus(Evalboards.ch2.STAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32));
-        }
-        break;
-    case TMCL_SGP:
-        SetGlobalParameter();
-        break;
-    case TMCL_GGP:
-        GetGlobalParameter();
-        break;
-    case TMCL_SIO:
-        SetOutput();
-        break;
-    case TMCL_GIO:
-        GetInput();
-        break;
-    case TMCL_UF0:
-        setDriversEnable();
-        break;
-    case TMCL_UF1:
-        readIdEeprom();
-        break;
-    case TMCL_UF2:
-        writeIdEeprom();
-        break;
-    case TMCL_UF4:
-        // if function doesn't exist for ch1 try ch2
-        if(setTMCLStatus(Evalboards.ch1.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32)) & TMC_ERROR_FUNCTION)
-        {
-            setTMCLStatus(Evalboards.ch2.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32));
-        }
-        break;
-    case TMCL_UF5:
-        // if function doesn't exist for ch1 try ch2 // todo CHECK REM 2: We have TMCL_writeRegisterChannel_1, we dont need this. Make sure it isnt used in IDE (LH) #1
-        Evalboards.ch1.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
-        break;
-    case TMCL_UF6:
-        // if function doesn't exist for ch1 try ch2 // todo CHECK REM 2: We have TMCL_readRegisterChannel_1, we dont need this. Make sure it isnt used in IDE (LH) #2
-        Evalboards.ch1.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
-        break;
-    case TMCL_UF8:
-        // user function for reading Motor0_XActual and Motor1_XActual
-        Evalboards.ch1.userFunction(ActualCommand.Type, 0, &ActualCommand.Value.Int32);
-        int32_t m0XActual = ActualCommand.Value.Int32;
-        Evalboards.ch1.userFunction(ActualCommand.Type, 1, &ActualCommand.Value.Int32);
-        int32_t m1XActual = ActualCommand.Value.Int32;
-        ActualReply.Value.Byte[0]= m1XActual & 0xFF;
-        ActualReply.Value.Byte[1]= (m1XActual & 0xFF00)>>8;
-        ActualReply.Value.Byte[2]= (m1XActual & 0xFF0000)>>16;
-        ActualReply.Value.Byte[3]= m0XActual & 0xFF;
-        ActualReply.Opcode= (m0XActual & 0xFF00)>>8;
-        ActualReply.Status= (m0XActual & 0xFF0000)>>16;
-        break;
-    case TMCL_GetVersion:
-        GetVersion();
-        break;
-    case TMCL_GetIds:
-        boardAssignment();
-        break;
-    case TMCL_UF_CH1:
-        // user function for motionController board
-        setTMCLStatus(Evalboards.ch1.userFunction(ActualCommand.Type, ActualCommand.Motor, &ActualCommand.Value.Int32));
-        ActualReply.Value.Int32 = ActualCommand.Value.Int32;
-        break;
-    case TMCL_UF_CH2:
-        // user function for driver board
-        setTMCLStatus(Evalboards.ch2.userFunction(ActualCommand.Type, ActualCommand.Motor, &ActualCommand.Value.Int32));
-        ActualReply.Value.Int32 = ActualCommand.Value.Int32;
-        break;
-    case TMCL_writeRegisterChannel_1:
-            Evalboards.ch1.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
-        break;
-    case TMCL_writeRegisterChannel_2:
-        Evalboards.ch2.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
-        break;
-    case TMCL_readRegisterChannel_1:
-        // Do not allow reads during brownout to prevent garbage data being used
-        // in read-modify-write operations. Bypass this safety with motor = 255
-        if ((VitalSignsMonitor.brownOut & VSM_ERRORS_BROWNOUT_CH1) && ActualCommand.Motor != 255)
-        {
-            ActualReply.Status = REPLY_CHIP_READ_FAILED;
-        }
-        else
-        {
-                Evalboards.ch1.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
-        }
-        break;
-    case TMCL_readRegisterChannel_2:
-        // Do not allow reads during brownout to prevent garbage data being used
-        // in read-modify-write operations. Bypass this safety with motor = 255
-        if ((VitalSignsMonitor.brownOut & VSM_ERRORS_BROWNOUT_CH2) && ActualCommand.Motor != 255)
-            ActualReply.Status = REPLY_CHIP_READ_FAILED;
-        else
-        {
+        script_store();
+        return;
+    }
 
-            Evalboards.ch2.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
-        }
-        break;
-    case TMCL_BoardMeasuredSpeed:
-        // measured speed from motionController board or driver board depending on type
-        boardsMeasuredSpeed();
-        break;
-    case TMCL_BoardError:
-        // errors of motionController board or driver board depending on type
-        boardsErrors();
-        break;
-    case TMCL_BoardReset:
-        // reset of motionController board or driver board depending on type
-        boardsReset();
-        break;
-    case TMCL_GetInfo:
-        handleGetInfo();
-        break;
-    case TMCL_WLAN:
-        HandleWlanCommand();
-        break;
-    case TMCL_RamDebug:
-        ActualReply.Status = handleRamDebug(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.UInt32);
-        break;
-    case TMCL_OTP:
-        handleOTP();
-        break;
-    case TMCL_MIN:
-        if(setTMCLStatus(Evalboards.ch1.getMin(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32)) & (TMC_ERROR_TYPE | TMC_ERROR_FUNCTION))
-        {
-            setTMCLStatus(Evalboards.ch2.getMin(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32));
-        }
-        break;
-    case TMCL_MAX:
-        if(setTMCLStatus(Evalboards.ch1.getMax(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32)) & (TMC_ERROR_TYPE | TMC_ERROR_FUNCTION))
-        {
-            setTMCLStatus(Evalboards.ch2.getMax(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32));
-        }
-        break;
-    case TMCL_Boot:
-        if(ActualCommand.Type           != 0x81)  break;
-        if(ActualCommand.Motor          != 0x92)  break;
-        if(ActualCommand.Value.Byte[3]  != 0xA3)  break;
-        if(ActualCommand.Value.Byte[2]  != 0xB4)  break;
-        if(ActualCommand.Value.Byte[1]  != 0xC5)  break;
-        if(ActualCommand.Value.Byte[0]  != 0xD6)  break;
-        enterBootloader();
-        break;
-    case TMCL_SoftwareReset:
-        SoftwareReset();
-        break;
-    default:
+    opcodeHits[ActualCommand.Opcode]++;
+
+    TMCLHandler handler = opcodeHandlers[ActualCommand.Opcode];
+    if(handler)
+    {
+        uint32_t start = systick_getCycleTick();
+        handler();
+        uint32_t cycles = systick_getCycleTick() - start;
+
+        opcodeCycles[ActualCommand.Opcode] += cycles;
+        if(cycles > opcodeMaxCycles[ActualCommand.Opcode])
+            opcodeMaxCycles[ActualCommand.Opcode] = cycles;
+    }
+    else
+    {
         ActualReply.Status = REPLY_INVALID_CMD;
-        break;
     }
 }
 
-void tmcl_init()
-{
-    ActualCommand.Error  = TMCL_RX_ERROR_NODATA;
-    interfaces[0]        = *HAL.USB;
-    interfaces[1]        = *HAL.RS232;
-    interfaces[2]        = *HAL.WLAN;
-    numberOfInterfaces   = 3;
+// === Channel routing =========================================================
+// Motion commands and axis parameters are handled by whichever Evalboard channel
+// supports them. Originally every such command was tried on ch1 first and
+// retried on ch2 on TMC_ERROR_FUNCTION/TMC_ERROR_TYPE. The channel that accepted
+// a command is now remembered per opcode, motor and type in two bitmaps, so
+// following commands are sent to the right channel directly. The motor is part
+// of the key since boards may support a parameter on some of their motors only.
+// The bitmaps are reset whenever the Evalboard assignment changes.
 
-    maxExtraData[0] = USB_MAX_EXTRA_DATA;
-    maxExtraData[1] = 0;
-    maxExtraData[2] = 0;
+void tmcl_resetRouting(void)
+{
+    memset(routeKnown, 0, sizeof(routeKnown));
+    memset(routeCh2, 0, sizeof(routeCh2));
 }
 
-void tmcl_process()
+static void setRoute(TMCLRoute route, uint8_t motor, uint8_t type, EvalboardFunctionsTypeDef *ch)
 {
-    if(ActualCommand.Error != TMCL_RX_ERROR_NODATA)
-        tx(&interfaces[currentInterface]);
+    if(motor >= ROUTE_MOTORS)
+        return;
 
-    if(resetRequest)
-        HAL.reset(true);
+    routeKnown[route][motor][type / 32] |= 1u << (type % 32);
+
+    if(ch == &Evalboards.ch2)
+        routeCh2[route][motor][type / 32] |= 1u << (type % 32);
+    else
+        routeCh2[route][motor][type / 32] &= ~(1u << (type % 32));
+}
 
-    ActualReply.IsSpecial = 0;
+static void routeCommand(TMCLRoute route, uint8_t type, TMCLRoutedCall call, uint32_t fallbackErrors)
+{
+    uint8_t motor = ActualCommand.Motor;
+    uint32_t mask = 1u << (type % 32);
 
-    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+    if(motor < ROUTE_MOTORS && (routeKnown[route][motor][type / 32] & mask))
     {
-        rx(&interfaces[i]);
-        if(ActualCommand.Error != TMCL_RX_ERROR_NODATA)
-        {
-            currentInterface = i;
-            ExecuteActualCommand();
+        bool isCh2 = routeCh2[route][motor][type / 32] & mask;
+        EvalboardFunctionsTypeDef *ch    = (isCh2) ? &Evalboards.ch2 : &Evalboards.ch1;
+        EvalboardFunctionsTypeDef *other = (isCh2) ? &Evalboards.ch1 : &Evalboards.ch2;
+
+        if(!(setTMCLStatus(call(ch)) & fallbackErrors))
             return;
+
+        // The remembered channel rejected the command - forget it and try the other channel only
+        routeKnown[route][motor][type / 32] &= ~mask;
+
+        uint8_t status = ActualReply.Status;
+        if(!(setTMCLStatus(call(other)) & fallbackErrors))
+        {
+            setRoute(route, motor, type, other);
+        }
+        else if(isCh2)
+        {
+            // Both channels failed - report the ch2 error like the ch1 -> ch2 trial does
+            ActualReply.Status = status;
         }
+        return;
+    }
+
+    // if function doesn't exist for ch1 try ch2
+    if(!(setTMCLStatus(call(&Evalboards.ch1)) & fallbackErrors))
+    {
+        setRoute(route, motor, type, &Evalboards.ch1);
+    }
+    else if(!(setTMCLStatus(call(&Evalboards.ch2)) & fallbackErrors))
+    {
+        setRoute(route, motor, type, &Evalboards.ch2);
     }
 }
 
-uint32_t tmcl_getExtraDataLimit()
+static uint32_t callRight(EvalboardFunctionsTypeDef *ch)
 {
-    // 4 bytes are reserved for the CRC checksum
-    if (maxExtraData[currentInterface] < sizeof(uint32_t))
-        return 0;
+    return ch->right(ActualCommand.Motor, ActualCommand.Value.Int32);
+}
 
-    return maxExtraData[currentInterface] - sizeof(uint32_t);
+static uint32_t callLeft(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->left(ActualCommand.Motor, ActualCommand.Value.Int32);
 }
 
-bool tmcl_appendData(uint8_t *data, uint32_t length)
+static uint32_t callStop(EvalboardFunctionsTypeDef *ch)
 {
-    uint32_t total = extraDataSize + length;
+    return ch->stop(ActualCommand.Motor);
+}
 
-    // Overflow?
-    if (total < length)
-        return false;
+static uint32_t callMoveTo(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->moveTo(ActualCommand.Motor, ActualCommand.Value.Int32);
+}
 
-    // Enough space?
-    if (total > tmcl_getExtraDataLimit())
-        return false;
+static uint32_t callMoveBy(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->moveBy(ActualCommand.Motor, &ActualCommand.Value.Int32);
+}
 
-    // Append the data
-    memcpy(&replyBuffer[9 + extraDataSize], data, length);
-    extraDataSize += length;
+static uint32_t callMoveProfile(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->moveProfile(ActualCommand.Motor, ActualCommand.Value.Int32);
+}
 
-    return true;
+static uint32_t callSAP(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->SAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32);
 }
 
-void tx(RXTXTypeDef *RXTX)
+static uint32_t callGAP(EvalboardFunctionsTypeDef *ch)
 {
-    uint8_t checkSum = 0;
+    return ch->GAP(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32);
+}
 
-    if(ActualReply.IsSpecial)
-    {
-        for(uint8_t i = 0; i < 9; i++)
-            replyBuffer[i] = ActualReply.Special[i];
-    }
-    else
-    {
-        checkSum += SERIAL_HOST_ADDRESS;
-        checkSum += ActualReply.ModuleId;
-        checkSum += ActualReply.Status;
-        checkSum += ActualReply.Opcode;
-        checkSum += ActualReply.Value.Byte[3];
-        checkSum += ActualReply.Value.Byte[2];
-        checkSum += ActualReply.Value.Byte[1];
-        checkSum += ActualReply.Value.Byte[0];
-
-        replyBuffer[0] = SERIAL_HOST_ADDRESS;
-        replyBuffer[1] = ActualReply.ModuleId;
-        replyBuffer[2] = ActualReply.Status;
-        replyBuffer[3] = ActualReply.Opcode;
-        replyBuffer[4] = ActualReply.Value.Byte[3];
-        replyBuffer[5] = ActualReply.Value.Byte[2];
-        replyBuffer[6] = ActualReply.Value.Byte[1];
-        replyBuffer[7] = ActualReply.Value.Byte[0];
-        replyBuffer[8] = checkSum;
-    }
+static uint32_t callSTAP(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->STAP(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32);
+}
 
-    if (extraDataSize > 0)
-    {
-        // Append CRC32 checksum
-        uint32_t crc = crc_crc32(&replyBuffer[9], extraDataSize);
-        memcpy(&replyBuffer[9+extraDataSize], (uint8_t *) &crc, sizeof(crc));
-        extraDataSize += 4;
-    }
+static uint32_t callGetMin(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->getMin(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32);
+}
 
-    RXTX->txN(replyBuffer, 9 + extraDataSize);
-    extraDataSize = 0;
+static uint32_t callGetMax(EvalboardFunctionsTypeDef *ch)
+{
+    return ch->getMax(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32);
 }
 
-void rx(RXTXTypeDef *RXTX)
+static uint32_t callGetMeasuredSpeed(EvalboardFunctionsTypeDef *ch)
 {
-    uint8_t checkSum = 0;
-    uint8_t cmd[9];
+    return ch->getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32);
+}
 
-    if(!RXTX->rxN(cmd, 9))
-    {
-        ActualCommand.Error = TMCL_RX_ERROR_NODATA;
-        return;
-    }
+// === Opcode handlers =========================================================
 
-    // todo ADD CHECK 2: check for SERIAL_MODULE_ADDRESS byte ( cmd[0] ) ? (LH)
+static void handleROR(void)
+{
+    routeCommand(ROUTE_ROR, 0, callRight, TMC_ERROR_FUNCTION);
+}
 
-    for(uint8_t i = 0; i < 8; i++)
-        checkSum += cmd[i];
+static void handleROL(void)
+{
+    routeCommand(ROUTE_ROL, 0, callLeft, TMC_ERROR_FUNCTION);
+}
+
+static void handleMST(void)
+{
+    routeCommand(ROUTE_MST, 0, callStop, TMC_ERROR_FUNCTION);
+}
 
-    if(checkSum != cmd[8])
+static void handleMVP(void)
+{
+    switch(ActualCommand.Type)
     {
-        ActualCommand.Error	= TMCL_RX_ERROR_CHECKSUM;
-        return;
+    case MVP_ABS: // move absolute
+        routeCommand(ROUTE_MVP, MVP_ABS, callMoveTo, TMC_ERROR_FUNCTION);
+        break;
+    case MVP_REL: // move relative
+        routeCommand(ROUTE_MVP, MVP_REL, callMoveBy, TMC_ERROR_FUNCTION);
+        ActualReply.Value.Int32 = ActualCommand.Value.Int32;
+        break;
+    case MVP_PRF:
+        routeCommand(ROUTE_MVP, MVP_PRF, callMoveProfile, TMC_ERROR_FUNCTION);
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
     }
+}
 
-    ActualCommand.ModuleId       = cmd[0];
-    ActualCommand.Opcode         = cmd[1];
-    ActualCommand.Type           = cmd[2];
-    ActualCommand.Motor          = cmd[3];
-    ActualCommand.Value.Byte[3]  = cmd[4];
-    ActualCommand.Value.Byte[2]  = cmd[5];
-    ActualCommand.Value.Byte[1]  = cmd[6];
-    ActualCommand.Value.Byte[0]  = cmd[7];
-    ActualCommand.Error          = TMCL_RX_ERROR_NONE;
+static void handleSAP(void)
+{
+    routeCommand(ROUTE_SAP, ActualCommand.Type, callSAP, TMC_ERROR_TYPE | TMC_ERROR_FUNCTION);
 }
 
+static void handleGAP(void)
+{
+    routeCommand(ROUTE_GAP, ActualCommand.Type, callGAP, TMC_ERROR_TYPE | TMC_ERROR_FUNCTION);
+}
 
-/*
- * Reads four bytes from the eeprom.
- *
- * @param channel Id of SPI channel to be used with 1 = SPI.ch1 and 2 = SPI.ch2
- * @param address Address the byte should be read from.
- *
- * @return The bytes read with byte0 = lowest byte or 0 if reading went unsuccessful
- */
-static void readIdEeprom(void)
+static void handleSTAP(void)
 {
-    SPIChannelTypeDef *spi;
-    if(ActualCommand.Type == 1)
-        spi = &SPI.ch1;
-    else if(ActualCommand.Type == 2)
-        spi = &SPI.ch2;
-    else
-    {
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        return;
-    }
+    routeCommand(ROUTE_STAP, ActualCommand.Type, callSTAP, TMC_ERROR_TYPE | TMC_ERROR_FUNCTION);
+}
 
-    uint8_t array[4];
-    eeprom_read_array(spi, ActualCommand.Value.Int32, array, 4);
-    ActualReply.Value.Int32 = array[3] << 24 | array[2] << 16 | array[1] << 8 | array[0];
+static void handleMIN(void)
+{
+    routeCommand(ROUTE_MIN, ActualCommand.Type, callGetMin, TMC_ERROR_TYPE | TMC_ERROR_FUNCTION);
 }
 
-/*
- * Writes one byte into the eeprom for id detection.
- *
- * @param channel Id of SPI channel to be used with 1 = SPI.ch1 and 2 = SPI.ch2
- * @param address Address the byte should be written to.
- * @param bytes Pointer to byte array that are to be written. The first byte is always written
- * 				following bytes are written as long as they are not null.
- *
- * @return false if everything went successful
- * 		   1 if selected channel is not available
- * 		   the status bits of the eeprom if eeprom is not ready
- */
-static void writeIdEeprom(void)
+static void handleMAX(void)
 {
-    SPIChannelTypeDef *spi;
-    if(ActualCommand.Type == 1)
-        spi = &SPI.ch1;
-    else if(ActualCommand.Type == 2)
-        spi = &SPI.ch2;
+    routeCommand(ROUTE_MAX, ActualCommand.Type, callGetMax, TMC_ERROR_TYPE | TMC_ERROR_FUNCTION);
+}
+
+static void handleUF4(void)
+{
+    routeCommand(ROUTE_UF4, 0, callGetMeasuredSpeed, TMC_ERROR_FUNCTION);
+}
+
+static void handleUF5(void)
+{
+    // todo CHECK REM 2: We have TMCL_writeRegisterChannel_1, we dont need this. Make sure it isnt used in IDE (LH) #1
+    Evalboards.ch1.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
+}
+
+static void handleUF6(void)
+{
+    // todo CHECK REM 2: We have TMCL_readRegisterChannel_1, we dont need this. Make sure it isnt used in IDE (LH) #2
+    Evalboards.ch1.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
+}
+
+static void handleUF8(void)
+{
+    // user function for reading Motor0_XActual and Motor1_XActual
+    Evalboards.ch1.userFunction(ActualCommand.Type, 0, &ActualCommand.Value.Int32);
+    int32_t m0XActual = ActualCommand.Value.Int32;
+    Evalboards.ch1.userFunction(ActualCommand.Type, 1, &ActualCommand.Value.Int32);
+    int32_t m1XActual = ActualCommand.Value.Int32;
+    ActualReply.Value.Byte[0]= m1XActual & 0xFF;
+    ActualReply.Value.Byte[1]= (m1XActual & 0xFF00)>>8;
+    ActualReply.Value.Byte[2]= (m1XActual & 0xFF0000)>>16;
+    ActualReply.Value.Byte[3]= m0XActual & 0xFF;
+    ActualReply.Opcode= (m0XActual & 0xFF00)>>8;
+    ActualReply.Status= (m0XActual & 0xFF0000)>>16;
+}
+
+static void handleUserFunctionCh1(void)
+{
+    // user function for motionController board
+    setTMCLStatus(Evalboards.ch1.userFunction(ActualCommand.Type, ActualCommand.Motor, &ActualCommand.Value.Int32));
+    ActualReply.Value.Int32 = ActualCommand.Value.Int32;
+}
+
+static void handleUserFunctionCh2(void)
+{
+    // user function for driver board
+    setTMCLStatus(Evalboards.ch2.userFunction(ActualCommand.Type, ActualCommand.Motor, &ActualCommand.Value.Int32));
+    ActualReply.Value.Int32 = ActualCommand.Value.Int32;
+}
+
+static void writeRegisterCh1(void)
+{
+    Evalboards.ch1.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
+}
+
+static void writeRegisterCh2(void)
+{
+    Evalboards.ch2.writeRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), ActualCommand.Value.Int32);
+}
+
+static void readRegisterCh1(void)
+{
+    // Do not allow reads during brownout to prevent garbage data being used
+    // in read-modify-write operations. Bypass this safety with motor = 255
+    if ((VitalSignsMonitor.brownOut & VSM_ERRORS_BROWNOUT_CH1) && ActualCommand.Motor != 255)
+    {
+        ActualReply.Status = REPLY_CHIP_READ_FAILED;
+    }
     else
     {
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        return;
+        Evalboards.ch1.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
     }
+}
 
-    uint8_t out = eeprom_check(spi);
-    // ignore when check did not find magic number, quit on other errors
-    if(out != ID_CHECKERROR_MAGICNUMBER && out != 0)
+static void readRegisterCh2(void)
+{
+    // Do not allow reads during brownout to prevent garbage data being used
+    // in read-modify-write operations. Bypass this safety with motor = 255
+    if ((VitalSignsMonitor.brownOut & VSM_ERRORS_BROWNOUT_CH2) && ActualCommand.Motor != 255)
     {
-        ActualReply.Status = REPLY_EEPROM_LOCKED; // todo CHECK 2: Not sure which error to send here, this one sounded ok (LH)
-        return;
+        ActualReply.Status = REPLY_CHIP_READ_FAILED;
+    }
+    else
+    {
+        Evalboards.ch2.readRegister(ActualCommand.Motor & 0x0F, getExtendedAddress(&ActualCommand), &ActualReply.Value.Int32);
     }
+}
 
-    eeprom_write_byte(spi, ActualCommand.Value.Int32, ActualCommand.Motor);
+static void readRegisterBlockCh1(void)
+{
+    readRegisterBlock(&Evalboards.ch1, VSM_ERRORS_BROWNOUT_CH1);
+}
 
-    return;
+static void readRegisterBlockCh2(void)
+{
+    readRegisterBlock(&Evalboards.ch2, VSM_ERRORS_BROWNOUT_CH2);
 }
 
-static void SetGlobalParameter()
+static void writeRegisterListEntry(void)
 {
-    switch(ActualCommand.Type)
-    {
-    case 1:
-        VitalSignsMonitor.errorMask = ActualCommand.Value.Int32;
-        break;
-    case 2:
-        setDriversEnable();
-        break;
-    case 3:
-        switch(ActualCommand.Value.Int32)
-        {
-        case 0: // normal operation
-            VitalSignsMonitor.debugMode = 0;
-            break;
-        case 1: // FREE ERROR LED
-            VitalSignsMonitor.debugMode = 1;
-            HAL.LEDs->error.off();
-            break;
-        default:
-            ActualReply.Status = REPLY_INVALID_TYPE;
-            break;
-        }
-        break;
-    case 6:
-        if(Evalboards.ch1.onPinChange(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32)
-                && Evalboards.ch2.onPinChange(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32))
-            HAL.IOs->config->setToState(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32);
-        break;
-    case 7:
-        ActualReply.Value.UInt32 = spi_setFrequency(&HAL.SPI->ch1, ActualCommand.Value.UInt32);
-        break;
-    case 8:
-        ActualReply.Value.UInt32 = spi_setFrequency(&HAL.SPI->ch2, ActualCommand.Value.UInt32);
-        break;
-    case 9:
-        if (!spi_setMode(&HAL.SPI->ch1, ActualCommand.Value.UInt32))
-        {
-            ActualReply.Status = REPLY_INVALID_VALUE;
-            break;
-        }
-        break;
-    case 10:
-        if (!spi_setMode(&HAL.SPI->ch2, ActualCommand.Value.UInt32))
-        {
-            ActualReply.Status = REPLY_INVALID_VALUE;
-            break;
-        }
-        break;
-    case 11: // Bulk download maximum transmission unit (MTU) config
-        if (ActualCommand.Motor >= numberOfInterfaces + 1)
-        {
-            ActualReply.Status = REPLY_MAX_EXCEEDED;
-            break;
-        }
+    appendRegisterListEntry(getExtendedAddress(&ActualCommand), ActualCommand.Motor & 0x0F, ActualCommand.Value.Int32, true);
+}
 
-        // Motor argument selects what interface to configure.
-        // 0 refers to the interface used by the request.
-        switch ((ActualCommand.Motor == 0) ? currentInterface : ((uint32_t) ActualCommand.Motor - 1))
-        {
-        case 0: // USB
-            if (ActualCommand.Value.UInt32 > USB_MAX_EXTRA_DATA)
-            {
-                // Too much data requested - reply with error and how much is possible
-                ActualReply.Status = REPLY_INVALID_VALUE;
-                ActualReply.Value.UInt32 = USB_MAX_EXTRA_DATA;
-                break;
-            }
+static void handleTMCLRamDebug(void)
+{
+    ActualReply.Status = handleRamDebug(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.UInt32);
+}
 
-            maxExtraData[0] = ActualCommand.Value.UInt32;
-            break;
+static void handleBoot(void)
+{
+    if(ActualCommand.Type           != 0x81)  return;
+    if(ActualCommand.Motor          != 0x92)  return;
+    if(ActualCommand.Value.Byte[3]  != 0xA3)  return;
+    if(ActualCommand.Value.Byte[2]  != 0xB4)  return;
+    if(ActualCommand.Value.Byte[1]  != 0xC5)  return;
+    if(ActualCommand.Value.Byte[0]  != 0xD6)  return;
+
+    if(!startJob(bootJob))
+        enterBootloader();
 
-        default: // RS232, WLAN
-            // These interfaces currently don't support extra data,
-            // so anything beyond 0 is already requesting too much.
-            if (ActualCommand.Value.UInt32 > 0)
-            {
-                // Too much data requested - reply with error and how much is possible
-                ActualReply.Status = REPLY_INVALID_VALUE;
-                ActualReply.Value.UInt32 = 0;
-                break;
-            }
+    // The boot command does not get a reply
+    ActualCommand.Error = TMCL_RX_ERROR_NODATA;
+}
 
-            break;
-        }
-        break;
+// Opcode -> handler lookup. Opcodes without an entry are answered with REPLY_INVALID_CMD.
+static const TMCLHandler opcodeHandlers[256] =
+{
+    [TMCL_ROR]                          = handleROR,
+    [TMCL_ROL]                          = handleROL,
+    [TMCL_MST]                          = handleMST,
+    [TMCL_MVP]                          = handleMVP,
+    [TMCL_SAP]                          = handleSAP,
+    [TMCL_GAP]                          = handleGAP,
+    [TMCL_STAP]                         = handleSTAP,
+    [TMCL_SGP]                          = SetGlobalParameter,
+    [TMCL_GGP]                          = GetGlobalParameter,
+    [TMCL_SIO]                          = SetOutput,
+    [TMCL_GIO]                          = GetInput,
+    [TMCL_UF0]                          = setDriversEnable,
+    [TMCL_UF1]                          = readIdEeprom,
+    [TMCL_UF2]                          = writeIdEeprom,
+    [TMCL_UF4]                          = handleUF4,
+    [TMCL_UF5]                          = handleUF5,
+    [TMCL_UF6]                          = handleUF6,
+    [TMCL_UF8]                          = handleUF8,
+    [TMCL_ApplStop]                     = handleApplStop,
+    [TMCL_ApplRun]                      = handleApplRun,
+    [TMCL_ApplStep]                     = handleApplStep,
+    [TMCL_ApplReset]                    = handleApplReset,
+    [TMCL_DownloadStart]                = handleDownloadStart,
+    [TMCL_DownloadEnd]                  = handleDownloadEnd,
+    [TMCL_ReadMem]                      = handleReadMem,
+    [TMCL_GetStatus]                    = handleGetStatus,
+    [TMCL_SetEvent]                     = handleSetEvent,
+    [TMCL_EI]                           = handleEI,
+    [TMCL_DI]                           = handleDI,
+    [TMCL_VECT]                         = handleVECT,
+    [TMCL_GetVersion]                   = GetVersion,
+    [TMCL_GetIds]                       = boardAssignment,
+    [TMCL_UF_CH1]                       = handleUserFunctionCh1,
+    [TMCL_UF_CH2]                       = handleUserFunctionCh2,
+    [TMCL_writeRegisterChannel_1]       = writeRegisterCh1,
+    [TMCL_writeRegisterChannel_2]       = writeRegisterCh2,
+    [TMCL_readRegisterChannel_1]        = readRegisterCh1,
+    [TMCL_readRegisterChannel_2]        = readRegisterCh2,
+    [TMCL_readRegisterBlockChannel_1]   = readRegisterBlockCh1,
+    [TMCL_readRegisterBlockChannel_2]   = readRegisterBlockCh2,
+    [TMCL_RegisterList]                 = handleRegisterList,
+    [TMCL_writeRegisterListEntry]       = writeRegisterListEntry,
+    [TMCL_BoardMeasuredSpeed]           = boardsMeasuredSpeed,
+    [TMCL_BoardError]                   = boardsErrors,
+    [TMCL_BoardReset]                   = boardsReset,
+    [TMCL_GetInfo]                      = handleGetInfo,
+    [TMCL_Telemetry]                    = handleTelemetry,
+    [TMCL_Ticket]                       = handleTicket,
+    [TMCL_WLAN]                         = HandleWlanCommand,
+    [TMCL_RamDebug]                     = handleTMCLRamDebug,
+    [TMCL_OTP]                          = handleOTP,
+    [TMCL_MIN]                          = handleMIN,
+    [TMCL_MAX]                          = handleMAX,
+    [TMCL_Boot]                         = handleBoot,
+    [TMCL_SoftwareReset]                = SoftwareReset,
+};
 
-    case 12:
-        UART_setBaudrate(&UART, ActualCommand.Value.UInt32);
-        ActualReply.Value.UInt32 = UART_getActiveBaudrate();
-        break;
+void tmcl_init()
+{
+    ActualCommand.Error  = TMCL_RX_ERROR_NODATA;
+    interfaces[0]        = *HAL.USB;
+    interfaces[1]        = *HAL.RS232;
+    interfaces[2]        = *HAL.WLAN;
+    numberOfInterfaces   = 3;
 
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
+    maxExtraData[0] = USB_MAX_EXTRA_DATA;
+    maxExtraData[1] = 0;
+    maxExtraData[2] = 0;
+
+    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+    {
+        commandQueues[i].read   = 0;
+        commandQueues[i].count  = 0;
+        replyQueues[i].count    = 0;
     }
+
+    for(uint32_t i = 0; i < TMCL_EVENT_COUNT; i++)
+        events.vector[i] = EVENT_NO_VECTOR;
+
+    StepDir_setStallCallback(events_onStall);
 }
 
-static void GetGlobalParameter()
+void tmcl_process()
 {
-    switch(ActualCommand.Type)
-    {
-    case 1:
-        ActualReply.Value.Int32 = VitalSignsMonitor.errors;
-        break;
-    case 2:
-        ActualReply.Value.Int32 = (Evalboards.driverEnable == DRIVER_ENABLE)? 1:0;
-        break;
-    case 3:
-        ActualReply.Value.Int32 = VitalSignsMonitor.debugMode;
-        break;
-    case 4:
+    uint32_t startTick = systick_getCycleTick();
+    uint32_t executed = 0;
+
+    // No more commands, scripts or events once the boot has been started
+    if(bootPending)
     {
-        IdAssignmentTypeDef ids;
-        ids.ch1.id = Evalboards.ch1.id;
-        ids.ch2.id = Evalboards.ch2.id;
-        ActualReply.Value.Int32 = Board_supported(&ids);
+        processJobs();
+        return;
     }
-    break;
-    case 5: // Get hardware ID
-        ActualReply.Value.Int32 = hwid;
-        break;
-    case 6:
-        ActualReply.Value.UInt32 = HAL.IOs->config->getState(HAL.IOs->pins->pins[ActualCommand.Motor]);
-        break;
-    case 7:
-        ActualReply.Value.UInt32 = spi_getFrequency(&HAL.SPI->ch1);
-        break;
-    case 8:
-        ActualReply.Value.UInt32 = spi_getFrequency(&HAL.SPI->ch2);
-        break;
-    case 9:
-        ActualReply.Value.UInt32 = spi_getMode(&HAL.SPI->ch1);
-        break;
-    case 10:
-        ActualReply.Value.UInt32 = spi_getMode(&HAL.SPI->ch2);
-        break;
-    case 11:
-        if (ActualCommand.Motor >= numberOfInterfaces + 1)
+
+    stats_recordPass();
+
+    // Parse all available datagrams into the command queues
+    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+    {
+        TMCLCommandQueueTypeDef *queue = &commandQueues[i];
+
+        while(queue->count < TMCL_COMMAND_QUEUE_SIZE)
         {
-            ActualReply.Status = REPLY_MAX_EXCEEDED;
-            break;
+            uint32_t write = (queue->read + queue->count) % TMCL_COMMAND_QUEUE_SIZE;
+            if(!rx(&interfaces[i], &queue->commands[write]))
+                break;
+
+            queue->rxTick[write] = systick_getCycleTick();
+            if(queue->commands[write].Error == TMCL_RX_ERROR_CHECKSUM)
+                stats.checksumErrors[i]++;
+
+            queue->count++;
         }
+    }
 
-        // Motor argument selects what interface to read out.
-        // 0 refers to the interface used by the request.
-        switch ((ActualCommand.Motor == 0) ? currentInterface : ((uint32_t) ActualCommand.Motor - 1))
+    // Drain the command queues, alternating between the interfaces
+    while(executed < commandsPerPass)
+    {
+        bool found = false;
+
+        for(uint32_t i = 0; i < numberOfInterfaces; i++)
         {
-        case 0: // USB
-            ActualReply.Value.UInt32 = maxExtraData[0];
-            break;
-        default: // RS232, WLAN
-            // These interfaces currently don't support extra data
-            ActualReply.Value.UInt32 = 0;
-            break;
+            TMCLCommandQueueTypeDef *queue = &commandQueues[i];
+
+            if(queue->count == 0)
+                continue;
+
+            // Leave the command queued until the interface can take the
+            // pending replies plus the largest possible reply of this command
+            if(!hasTxSpace(i, (replyQueues[i].count + 1) * TMCL_DATAGRAM_SIZE + maxExtraData[i]))
+                continue;
+
+            ActualCommand = queue->commands[queue->read];
+            stats.currentRxTick = queue->rxTick[queue->read];
+            queue->read = (queue->read + 1) % TMCL_COMMAND_QUEUE_SIZE;
+            queue->count--;
+
+            currentInterface = i;
+            ActualReply.IsSpecial = 0;
+            ExecuteActualCommand();
+            executed++;
+            found = true;
+            stats.commands[i]++;
+
+            if(ActualCommand.Error != TMCL_RX_ERROR_NODATA)
+                queueReply(i);
+            else
+                extraDataSize = 0;
+
+            if(resetRequest || executed >= commandsPerPass)
+                break;
         }
-        break;
 
-    case 12:
-        ActualReply.Value.UInt32 = UART_getActiveBaudrate();
-        break;
+        if(!found || resetRequest)
+            break;
 
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
+        if(processTimeBudget && systick_cyclesToMicroseconds(systick_getCycleTick() - startTick) >= processTimeBudget)
+            break;
     }
+
+    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+        flushReplies(i);
+
+    if(resetRequest)
+        HAL.reset(true);
+
+    processJobs();
+    events_process();
+    script_process();
+    telemetry_process();
+    ramdebugStream_process();
 }
 
-static void boardAssignment(void)
+uint32_t tmcl_getExtraDataLimit()
 {
-    uint8_t testOnly = 0;
+    // 4 bytes are reserved for the CRC checksum
+    if (maxExtraData[currentInterface] < sizeof(uint32_t))
+        return 0;
 
-    IdAssignmentTypeDef ids;
-    ids.ch1.id     = (ActualCommand.Value.Int32 >> 0)   & 0xFF;
-    ids.ch1.state  = (ActualCommand.Value.Int32 >> 8)   & 0xFF;
-    ids.ch2.id     = (ActualCommand.Value.Int32 >> 16)  & 0xFF;
-    ids.ch2.state  = (ActualCommand.Value.Int32 >> 24)  & 0xFF;
+    return maxExtraData[currentInterface] - sizeof(uint32_t);
+}
 
-    switch(ActualCommand.Type)
-    {
-    case 0:  // auto detect and assign
-        checkIDs();
-        return;
-        break;
-    case 1:  // id for channel 2 not changed, reset maybe
-        ids.ch2.id     = Evalboards.ch2.id;
-        ids.ch2.state  = ID_STATE_WAIT_LOW;
-        break;
-    case 2:  // id for channel 1 not changed, reset maybe
-        ids.ch2.id     = (ActualCommand.Value.Int32 >> 0)  & 0xFF;
-        ids.ch2.state  = (ActualCommand.Value.Int32 >> 8)  & 0xFF;
-        ids.ch1.id     = Evalboards.ch1.id;
-        ids.ch1.state  = ID_STATE_WAIT_LOW;
-        break;
-    case 3:  // id for both channels
-        break;
-    case 4:  // test if ids are in firmware
-        testOnly = 1;
-        if(ActualReply.Value.Int32 == 0)
-        {
-            ids.ch1.id = Evalboards.ch1.id;
-            ids.ch2.id = Evalboards.ch2.id;
-        }
-        break;
-    case 5:  // Re-Check board types - but do not [de]init any boards
-        checkBoardTypes();
-        return;
-        break;
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        return;
-        break;
-    }
+bool tmcl_appendData(uint8_t *data, uint32_t length)
+{
+    uint32_t total = extraDataSize + length;
 
-    IdAssignmentTypeDef ids_buff;
-    ids_buff.ch1.id     = ids.ch1.id;
-    ids_buff.ch1.state  = ID_STATE_DONE;
-    ids_buff.ch2.id     = ids.ch2.id;
-    ids_buff.ch2.state  = ID_STATE_DONE;
+    // Overflow?
+    if (total < length)
+        return false;
 
-    if(!testOnly)
-        ActualReply.Value.Int32 = Board_assign(&ids_buff);
-    else
-        ActualReply.Value.Int32 = Board_supported(&ids_buff);
+    // Enough space?
+    if (total > tmcl_getExtraDataLimit())
+        return false;
+
+    // Append the data
+    memcpy(&replyBuffer[9 + extraDataSize], data, length);
+    extraDataSize += length;
+
+    return true;
 }
 
-static void boardsErrors(void)
+static void encodeReply(uint8_t *datagram)
 {
-    switch(ActualCommand.Type)
+    uint8_t checkSum = 0;
+
+    if(ActualReply.IsSpecial)
     {
-    case 0:
-        ActualReply.Value.Int32 = Evalboards.ch1.errors;
-        break;
-    case 1:
-        ActualReply.Value.Int32 = Evalboards.ch2.errors;
-        break;
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
+        for(uint8_t i = 0; i < 9; i++)
+            datagram[i] = ActualReply.Special[i];
+
+        return;
     }
+
+    checkSum += SERIAL_HOST_ADDRESS;
+    checkSum += ActualReply.ModuleId;
+    checkSum += ActualReply.Status;
+    checkSum += ActualReply.Opcode;
+    checkSum += ActualReply.Value.Byte[3];
+    checkSum += ActualReply.Value.Byte[2];
+    checkSum += ActualReply.Value.Byte[1];
+    checkSum += ActualReply.Value.Byte[0];
+
+    datagram[0] = SERIAL_HOST_ADDRESS;
+    datagram[1] = ActualReply.ModuleId;
+    datagram[2] = ActualReply.Status;
+    datagram[3] = ActualReply.Opcode;
+    datagram[4] = ActualReply.Value.Byte[3];
+    datagram[5] = ActualReply.Value.Byte[2];
+    datagram[6] = ActualReply.Value.Byte[1];
+    datagram[7] = ActualReply.Value.Byte[0];
+    datagram[8] = checkSum;
 }
 
-static void boardsReset(void)
+// Add the reply for ActualCommand to the reply queue of the given interface.
+// Replies carrying extra data use the shared replyBuffer and are sent out
+// directly - after the replies already queued, to preserve the order.
+static void queueReply(uint32_t interface)
 {
-    switch(ActualCommand.Type)
+    TMCLReplyQueueTypeDef *queue = &replyQueues[interface];
+
+    if(extraDataSize > 0)
     {
-    case 0:
-        if(!Evalboards.ch1.config->reset())
-            ActualReply.Status = REPLY_WRITE_PROTECTED;
-        break;
-    case 1:
-        if(!Evalboards.ch2.config->reset())
-            ActualReply.Status = REPLY_WRITE_PROTECTED;
-        break;
-    case 2:
-        if(!Evalboards.ch1.config->reset())
-            ActualReply.Status = REPLY_WRITE_PROTECTED;
-        if(!Evalboards.ch2.config->reset())
-            ActualReply.Status = REPLY_WRITE_PROTECTED;
-        break;
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
+        flushReplies(interface);
+        tx(&interfaces[interface]);
+        stats_recordLatency(stats.currentRxTick);
+        return;
     }
+
+    if(queue->count >= TMCL_REPLY_QUEUE_SIZE)
+        flushReplies(interface);
+
+    encodeReply(&queue->buffer[queue->count * TMCL_DATAGRAM_SIZE]);
+    queue->rxTick[queue->count] = stats.currentRxTick;
+    queue->count++;
 }
 
-static void boardsMeasuredSpeed(void)
+static void flushReplies(uint32_t interface)
 {
-    switch(ActualCommand.Type)
-    {
-    case 0:
-        ActualReply.Status = Evalboards.ch1.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32);
-        break;
-    case 1:
-        ActualReply.Status = Evalboards.ch2.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32);
-        break;
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
-    }
+    TMCLReplyQueueTypeDef *queue = &replyQueues[interface];
+
+    if(queue->count == 0)
+        return;
+
+    interfaces[interface].txN(queue->buffer, queue->count * TMCL_DATAGRAM_SIZE);
+
+    for(uint32_t i = 0; i < queue->count; i++)
+        stats_recordLatency(queue->rxTick[i]);
+
+    queue->count = 0;
 }
 
-static void setDriversEnable()
+// Check whether the transmit buffer of the given interface can take the given
+// amount of bytes. Interfaces without a free space report always can, their
+// txN() waits until the data fits.
+static bool hasTxSpace(uint32_t interface, uint32_t bytes)
 {
-    vitalsignsmonitor_clearOvervoltageErrors();
+    if(!reportsTxSpace(interface))
+        return true;
 
-    Evalboards.driverEnable = (ActualCommand.Value.Int32) ? DRIVER_ENABLE : DRIVER_DISABLE;
-    Evalboards.ch1.enableDriver(DRIVER_USE_GLOBAL_ENABLE);
-    Evalboards.ch2.enableDriver(DRIVER_USE_GLOBAL_ENABLE);
+    return interfaces[interface].txSpaceAvailable() >= bytes;
 }
 
-static void checkIDs(void)
+// Interfaces without a free space report stall the main loop while sending.
+// Unsolicited frames are limited to one per pass for them.
+static bool reportsTxSpace(uint32_t interface)
 {
-    IdAssignmentTypeDef ids = { 0 };
+    return interfaces[interface].txSpaceAvailable != NULL;
+}
 
-    // Backwards compatibility:
-    // For now we do this *before* scanning the bus since TMCL-IDE <= 4.6.0 will
-    // use this command (TMCL_GetIDs type 0) to switch the ID from TMC9660
-    // bootloader to param/reg. Later this will change to always do the generic
-    // ID detection first followed by identifying the board type here and using
-    // a different command (TMCL_GetIDs type 5) - but that change will break the
-    // old TMCL-IDE mechanism.
-    if (checkBoardTypes())
-        return;
+static void stats_recordLatency(uint32_t rxTick)
+{
+    uint32_t cycles = systick_getCycleTick() - rxTick;
+    uint32_t us = systick_cyclesToMicroseconds(cycles);
+    uint32_t bucket = 0;
+
+    while((bucket < TMCL_STATS_LATENCY_BUCKETS - 1) && (us >= (1UL << bucket)))
+        bucket++;
+
+    stats.replies++;
+    stats.latencyCycles += cycles;
+    stats.latencyHistogram[bucket]++;
+    if(cycles > stats.latencyMaxCycles)
+        stats.latencyMaxCycles = cycles;
+}
+
+// Measure the period between two tmcl_process() calls, i.e. the main loop period
+static void stats_recordPass(void)
+{
+    uint32_t now = systick_getCycleTick();
+    uint32_t cycles = now - stats.lastPassTick;
 
-    Evalboards.ch1.deInit();
-    Evalboards.ch2.deInit();
-    Evalboards.ch1.id = 0;
-    Evalboards.ch2.id = 0;
+    stats.lastPassTick = now;
 
-    // Try detecting the IDs
-    if (!IDDetection_detect(&ids))
+    // The first pass has no predecessor
+    if(!stats.passStarted)
     {
-        // Monoflop detection not yet finished
-        ActualReply.Status = REPLY_DELAYED;
+        stats.passStarted = true;
         return;
     }
 
-    // ID detection completed -> Assign the board
-    Board_assign(&ids);
-    ActualReply.Value.UInt32 = (uint32_t)(
-            (ids.ch1.id)
-            | (ids.ch1.state << 8)
-            | (ids.ch2.id    << 16)
-            | (ids.ch2.state << 24)
-    );
+    stats.passes++;
+    stats.passCycles += cycles;
+    stats.passLastCycles = cycles;
+    if(cycles < stats.passMinCycles)
+        stats.passMinCycles = cycles;
+    if(cycles > stats.passMaxCycles)
+        stats.passMaxCycles = cycles;
 }
 
-static bool checkBoardTypes()
+static void stats_reset(void)
 {
-    IdAssignmentTypeDef ids = { 0 };
-
-    switch(Evalboards.ch1.id)
-    {
-    case ID_TMC9660_3PH_BL_EVAL:
-    case ID_TMC9660_STEPPER_BL_EVAL:
-    case ID_TMC9660_3PH_PARAM_EVAL:
-    case ID_TMC9660_STEPPER_PARAM_EVAL:
-    case ID_TMC9660_3PH_REG_EVAL:
-    case ID_TMC9660_STEPPER_REG_EVAL:
-    {
-        int32_t val = 0;
-        bool isStepper = Evalboards.ch1.id >= ID_TMC9660_STEPPER_BL_EVAL;
+    uint32_t lastPassTick = stats.lastPassTick;
 
-        Evalboards.ch1.userFunction(0,0,&val);
-        if(val == TM01)
-        {
-            // Bootloader responded -> Chip is in bootloader mode
-            ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_BL_EVAL : ID_TMC9660_3PH_BL_EVAL;
-        }
-        else
-        {
-            val = 0;
-            Evalboards.ch1.userFunction(2,0,&val);
-            if (val == 51)
-            {
-                // Chip responded with parameter mode ID -> Chip is in parameter mode
-                ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_PARAM_EVAL : ID_TMC9660_3PH_PARAM_EVAL;
-            }
-            else if (val == 17)
-            {
-                ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_REG_EVAL : ID_TMC9660_3PH_REG_EVAL;
-            }
-            else
-            {
-                // Unknown
-                return false;
-            }
-        }
-        Evalboards.ch1.errors &= ~0x07;
+    memset(&stats, 0, sizeof(stats));
+    stats.passMinCycles = UINT32_MAX;
+    stats.lastPassTick  = lastPassTick;
+    stats.passStarted   = true;
 
-        Evalboards.ch1.id = ids.ch1.id;
-        ids.ch1.state = ID_STATE_DONE;
-        ActualReply.Value.Int32 = (uint32_t)(
-                (Evalboards.ch1.id)
-                | (ids.ch1.state << 8)
-                | (ids.ch2.id    << 16)
-                | (ids.ch2.state << 24)
-        );
-        return true;
-        break;
-    }
-    default:
-        return false;
-    }
+    memset(opcodeHits, 0, sizeof(opcodeHits));
+    memset(opcodeMaxCycles, 0, sizeof(opcodeMaxCycles));
+    memset(opcodeCycles, 0, sizeof(opcodeCycles));
 }
 
-static void SoftwareReset(void)
+static uint32_t stats_average(uint64_t cycles, uint32_t count)
 {
-    if(ActualCommand.Value.Int32 == 1234)
-        resetRequest = true;
+    if(count == 0)
+        return 0;
+
+    return systick_cyclesToMicroseconds((uint32_t) (cycles / count));
 }
 
-static void GetVersion(void)
+// Append the command path statistics as extra data:
+// interface count n, commands[n], checksum errors[n],
+// replies, latency avg/max µs, latency histogram[TMCL_STATS_LATENCY_BUCKETS],
+// main loop passes, period avg/min/max/last µs
+static void stats_appendBlock(void)
 {
-    if(ActualCommand.Type == VERSION_FORMAT_ASCII)
-    {
-        ActualReply.IsSpecial   = 1;
-        ActualReply.Special[0]  = SERIAL_HOST_ADDRESS;
+    uint32_t block[1 + 2 * ARRAY_SIZE(interfaces) + 3 + TMCL_STATS_LATENCY_BUCKETS + 5];
+    uint32_t count = 0;
 
-        for(uint8_t i = 0; i < 8; i++)
-            ActualReply.Special[i+1] = VersionString[i];
-    }
-    else if(ActualCommand.Type == VERSION_FORMAT_BINARY)
-    {
-        // module version high
-        ActualReply.Value.Byte[3] = MODULE_ID / 100;
+    block[count++] = numberOfInterfaces;
+    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+        block[count++] = stats.commands[i];
+    for(uint32_t i = 0; i < numberOfInterfaces; i++)
+        block[count++] = stats.checksumErrors[i];
 
-        // module version low
-        ActualReply.Value.Byte[2] = MODULE_ID % 100;
+    block[count++] = stats.replies;
+    block[count++] = stats_average(stats.latencyCycles, stats.replies);
+    block[count++] = systick_cyclesToMicroseconds(stats.latencyMaxCycles);
+    for(uint32_t i = 0; i < TMCL_STATS_LATENCY_BUCKETS; i++)
+        block[count++] = stats.latencyHistogram[i];
 
-        // fw version high
-        ActualReply.Value.Byte[1] = VERSION_MAJOR;
+    block[count++] = stats.passes;
+    block[count++] = stats_average(stats.passCycles, stats.passes);
+    block[count++] = (stats.passes) ? systick_cyclesToMicroseconds(stats.passMinCycles) : 0;
+    block[count++] = systick_cyclesToMicroseconds(stats.passMaxCycles);
+    block[count++] = (stats.passes) ? systick_cyclesToMicroseconds(stats.passLastCycles) : 0;
 
-        // fw version low
-        ActualReply.Value.Byte[0] = VERSION_MINOR;
-    }
-    //how were the boards detected?	// todo CHECK 2: Doesn't fit into GetVersion. Move somewhere else? Or maybe change GetVersion to GetBoardInfo or something (LH)
-    else if(ActualCommand.Type == VERSION_BOARD_DETECT_SRC)
+    if(!tmcl_appendData((uint8_t *) block, count * sizeof(uint32_t)))
     {
-        ActualReply.Value.Byte[0] = IdState.ch1.detectedBy;
-        ActualReply.Value.Byte[1] = IdState.ch2.detectedBy;
-    }
-    else if(ActualCommand.Type == VERSION_BUILD) {
-        ActualReply.Value.UInt32 = BUILD_VERSION;
-    }
-    else if(ActualCommand.Type == NUMBER_OF_MOTORS){
-        ActualReply.Value.UInt32 = Evalboards.ch1.numberOfMotors + Evalboards.ch2.numberOfMotors;
+        ActualReply.Status = REPLY_MAX_EXCEEDED;
+        return;
     }
+
+    ActualReply.Value.UInt32 = count;
 }
 
-static void handleGetInfo(void)
+void tx(RXTXTypeDef *RXTX)
 {
-    switch (ActualCommand.Type)
-    {
-    case 0: // FWModuleID
-        ActualReply.Value.Int32 = MODULE_ID;
-        break;
+    encodeReply(replyBuffer);
 
-    case 1: // FWVersion
-        // Major version
-        ActualReply.Value.Byte[2] = VERSION_MAJOR;
+    if (extraDataSize > 0)
+    {
+        // Append CRC32 checksum
+        uint32_t crc = crc_crc32(&replyBuffer[9], extraDataSize);
+        memcpy(&replyBuffer[9+extraDataSize], (uint8_t *) &crc, sizeof(crc));
+        extraDataSize += 4;
+    }
 
-        // Minor version
-        ActualReply.Value.Byte[0] = VERSION_MINOR;
-        break;
+    RXTX->txN(replyBuffer, 9 + extraDataSize);
+    extraDataSize = 0;
+}
 
-    case 2: // FWCapability
-        ActualReply.Value.Int32 = (GETINFO_FW_CAPABILITY_BITMASK_TMCL); // TMCL only firmware
-        break;
-
-    case 3: // FWReleaseType
-        ActualReply.Value.Int32 = GETINFO_RELEASE_TYPE;
-        break;
-
-    case 20: // APIndexBitWidth
-        ActualReply.Value.Int32 = 8;
-        break;
+bool rx(RXTXTypeDef *RXTX, TMCLCommandTypeDef *command)
+{
+    uint8_t checkSum = 0;
+    uint8_t cmd[9];
 
-    case 21: // RegAddrBitWidth
-        ActualReply.Value.UInt32 = 12;
-        break;
+    if(!RXTX->rxN(cmd, 9))
+        return false;
 
-    case 30: // Git info
-        if (GIT_VERSION_INFO == 0xFFFFFFFF)
-        {
-            // Illegal GIT_VERSION_INFO value -> Git info is disabled
-            ActualReply.Status = REPLY_INVALID_TYPE;
-            break;
-        }
+    // todo ADD CHECK 2: check for SERIAL_MODULE_ADDRESS byte ( cmd[0] ) ? (LH)
 
-        ActualReply.Value.Int32 = GIT_VERSION_INFO;
-        break;
+    for(uint8_t i = 0; i < 8; i++)
+        checkSum += cmd[i];
 
-    case 200: // DeviceSpecificArea: Patch version
-        ActualReply.Value.UInt32 = VERSION_PATCH;
-        break;
+    command->ModuleId       = cmd[0];
+    command->Opcode         = cmd[1];
+    command->Type           = cmd[2];
+    command->Motor          = cmd[3];
+    command->Value.Byte[3]  = cmd[4];
+    command->Value.Byte[2]  = cmd[5];
+    command->Value.Byte[1]  = cmd[6];
+    command->Value.Byte[0]  = cmd[7];
+    command->Error          = (checkSum != cmd[8]) ? TMCL_RX_ERROR_CHECKSUM : TMCL_RX_ERROR_NONE;
 
-    case 201: // DeviceSpecificArea: Attached Evalboard IDs
-        ActualReply.Value.UInt32 = Evalboards.ch1.id << 16 | Evalboards.ch2.id;
-        break;
+    return true;
+}
 
-    case 202: // DeviceSpecificArea: Attached Evalboard hardware versions
-        ActualReply.Value.UInt32 = Evalboards.ch1.hwVersion.major << 24
-                                 | Evalboards.ch1.hwVersion.minor << 16
-                                 | Evalboards.ch2.hwVersion.major <<  8
-                                 | Evalboards.ch2.hwVersion.minor;
-        break;
 
-    default:
+/*
+ * Reads four bytes from the eeprom.
+ *
+ * @param channel Id of SPI channel to be used with 1 = SPI.ch1 and 2 = SPI.ch2
+ * @param address Address the byte should be read from.
+ *
+ * @return The bytes read with byte0 = lowest byte or 0 if reading went unsuccessful
+ */
+static void readIdEeprom(void)
+{
+    SPIChannelTypeDef *spi;
+    if(ActualCommand.Type == 1)
+        spi = &SPI.ch1;
+    else if(ActualCommand.Type == 2)
+        spi = &SPI.ch2;
+    else
+    {
         ActualReply.Status = REPLY_INVALID_TYPE;
-        break;
+        return;
     }
+
+    uint8_t array[4];
+    eeprom_read_array(spi, ActualCommand.Value.Int32, array, 4);
+    ActualReply.Value.Int32 = array[3] << 24 | array[2] << 16 | array[1] << 8 | array[0];
 }
 
-static void SetOutput(void)
+/*
+ * Writes one byte into the eeprom for id detection.
+ *
+ * @param channel Id of SPI channel to be used with 1 = SPI.ch1 and 2 = SPI.ch2
+ * @param address Address the byte should be written to.
+ * @param bytes Pointer to byte array that are to be written. The first byte is always written
+ * 				following bytes are written as long as they are not null.
+ *
+ * @return false if everything went successful
+ * 		   1 if selected channel is not available
+ * 		   the status bits of the eeprom if eeprom is not ready
+ */
+static void writeIdEeprom(void)
 {
-    if((Evalboards.ch1.SIO(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32) == TMC_ERROR_NONE)
-        || (Evalboards.ch2.SIO(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32) == TMC_ERROR_NONE))
+    if(ActualCommand.Type != 1 && ActualCommand.Type != 2)
+    {
+        ActualReply.Status = REPLY_INVALID_TYPE;
         return;
+    }
+
+    // The write cycle of the eeprom takes a few milliseconds
+    startJob(writeIdEepromJob);
 }
 
-static void GetInput(void)
+static bool writeIdEepromJob(TMCLJobTypeDef *job)
 {
-    if((Evalboards.ch1.GIO(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32) == TMC_ERROR_NONE) || (Evalboards.ch2.GIO(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32) == TMC_ERROR_NONE))
-        return;
+    SPIChannelTypeDef *spi = (ActualCommand.Type == 1) ? &SPI.ch1 : &SPI.ch2;
+
+    if(job->state == 0)
+    {
+        uint8_t out = eeprom_check(spi);
+        // ignore when check did not find magic number, quit on other errors
+        if(out != ID_CHECKERROR_MAGICNUMBER && out != 0)
+        {
+            ActualReply.Status = REPLY_EEPROM_LOCKED; // todo CHECK 2: Not sure which error to send here, this one sounded ok (LH)
+            return true;
+        }
 
+        eeprom_startWriteByte(spi, ActualCommand.Value.Int32, ActualCommand.Motor);
+        job->state = 1;
+        return false;
+    }
+
+    return eeprom_isWriteDone(spi);
+}
+
+static void SetGlobalParameter()
+{
     switch(ActualCommand.Type)
     {
-    case 0:
-        ActualReply.Value.Int32 = *HAL.ADCs->AIN0;
-        break;
     case 1:
-        ActualReply.Value.Int32 = *HAL.ADCs->AIN1;
+        VitalSignsMonitor.errorMask = ActualCommand.Value.Int32;
         break;
     case 2:
-        ActualReply.Value.Int32 = *HAL.ADCs->AIN2;
+        setDriversEnable();
         break;
     case 3:
-        ActualReply.Value.Int32 = *HAL.ADCs->DIO4;
-        break;
-    case 4:
-        ActualReply.Value.Int32 = *HAL.ADCs->DIO5;
-        break;
-    case 5:
-        if(Evalboards.ch1.id == ID_TMC5241){
-            ActualReply.Value.Int32 = VitalSignsMonitor.VM + 7; // Rectifier diode lower the voltage to ~700mV
-        }
-        else
+        switch(ActualCommand.Value.Int32)
         {
-            ActualReply.Value.Int32 = VitalSignsMonitor.VM;
+        case 0: // normal operation
+            VitalSignsMonitor.debugMode = 0;
+            break;
+        case 1: // FREE ERROR LED
+            VitalSignsMonitor.debugMode = 1;
+            HAL.LEDs->error.off();
+            break;
+        default:
+            ActualReply.Status = REPLY_INVALID_TYPE;
+            break;
         }
         break;
-    case 6:	// Raw VM ADC value, no scaling calculation done // todo QOL 2: Switch this case with case 5? That way we have the raw Values from 0-5, then 6 for scaled VM value. Requires IDE changes (LH)
-        ActualReply.Value.Int32 = *HAL.ADCs->VM;
+    case 6:
+        if(Evalboards.ch1.onPinChange(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32)
+                && Evalboards.ch2.onPinChange(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32))
+            HAL.IOs->config->setToState(HAL.IOs->pins->pins[ActualCommand.Motor], ActualCommand.Value.UInt32);
         break;
     case 7:
-        ActualReply.Value.Int32 = *HAL.ADCs->AIN_EXT;
+        ActualReply.Value.UInt32 = spi_setFrequency(&HAL.SPI->ch1, ActualCommand.Value.UInt32);
         break;
-    default:
-        ActualReply.Status = REPLY_INVALID_TYPE;
+    case 8:
+        ActualReply.Value.UInt32 = spi_setFrequency(&HAL.SPI->ch2, ActualCommand.Value.UInt32);
+        break;
+    case 9:
+        if (!spi_setMode(&HAL.SPI->ch1, ActualCommand.Value.UInt32))
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+        break;
+    case 10:
+        if (!spi_setMode(&HAL.SPI->ch2, ActualCommand.Value.UInt32))
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+        break;
+    case 11: // Bulk download maximum transmission unit (MTU) config
+    {
+        if (ActualCommand.Motor >= numberOfInterfaces + 1)
+        {
+            ActualReply.Status = REPLY_MAX_EXCEEDED;
+            break;
+        }
+
+        // Motor argument selects what interface to configure.
+        // 0 refers to the interface used by the request.
+        uint32_t interface = (ActualCommand.Motor == 0) ? currentInterface : ((uint32_t) ActualCommand.Motor - 1);
+        // USB uses its own limit, RS232 and WLAN share the serial one
+        uint32_t limit = (interface == 0) ? USB_MAX_EXTRA_DATA : SERIAL_MAX_EXTRA_DATA;
+
+        if (ActualCommand.Value.UInt32 > limit)
+        {
+            // Too much data requested - reply with error and how much is possible
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            ActualReply.Value.UInt32 = limit;
+            break;
+        }
+
+        maxExtraData[interface] = ActualCommand.Value.UInt32;
         break;
     }
-}
 
-static void HandleWlanCommand(void)
-{
-    switch(ActualCommand.Type)
-    {
-    case 0:
-        ActualReply.Value.Int32 = handleWLANCommand(ActualCommand.Motor, ActualCommand.Value.Int32);
+    case 12:
+        UART_setBaudrate(&UART, ActualCommand.Value.UInt32);
+        ActualReply.Value.UInt32 = UART_getActiveBaudrate();
         break;
-    case 1:
-        enableWLANCommandMode();
+    case 13: // Maximum amount of commands processed per main loop pass
+        if (ActualCommand.Value.UInt32 == 0)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+
+        commandsPerPass = ActualCommand.Value.UInt32;
         break;
-    case 2:
-        ActualReply.Value.Int32 = checkReadyToSend();
+    case 14: // Command processing time budget per main loop pass in µs, 0 = unlimited
+        processTimeBudget = ActualCommand.Value.UInt32;
         break;
-    case 3:
-        ActualReply.Value.Int32 = checkCmdModeEnabled();
+    case 15: // Reset the per-opcode command counters and execution times
+        memset(opcodeHits, 0, sizeof(opcodeHits));
+        memset(opcodeMaxCycles, 0, sizeof(opcodeMaxCycles));
+        memset(opcodeCycles, 0, sizeof(opcodeCycles));
         break;
-    case 4:
-        ActualReply.Value.Int32 = getCMDReply();
+    case 16: // Maximum amount of script instructions executed per main loop pass
+        if (ActualCommand.Value.UInt32 == 0)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+
+        script.budget = ActualCommand.Value.UInt32;
+        break;
+    case 17: // Reset all command path statistics
+        stats_reset();
         break;
+
     default:
         ActualReply.Status = REPLY_INVALID_TYPE;
         break;
     }
 }
 
-static int handleRamDebug(uint8_t type, uint8_t motor, uint32_t *data)
+static void GetGlobalParameter()
 {
-    switch (type)
+    switch(ActualCommand.Type)
     {
-    case 0:
-        debug_init();
-        break;
     case 1:
-        debug_setSampleCount(*data);
+        ActualReply.Value.Int32 = VitalSignsMonitor.errors;
         break;
     case 2:
-        /* Placeholder: Set sampling time reference*/
-        if (*data != 0)
-            return REPLY_INVALID_VALUE;
+        ActualReply.Value.Int32 = (Evalboards.driverEnable == DRIVER_ENABLE)? 1:0;
         break;
     case 3:
-        // RAMDebug expects a divisor value where 1 is original capture frequency,
-        // 2 is halved capture frequency etc.
-        // The TMCL-IDE sends prescaling values that are one lower than that.
-        debug_setPrescaler(*data + 1);
+        ActualReply.Value.Int32 = VitalSignsMonitor.debugMode;
         break;
     case 4:
-        if (!debug_setChannel(motor, *data))
-            return REPLY_MAX_EXCEEDED;
-        break;
-    case 5:
-        if (!debug_setTriggerChannel(motor, *data))
-            return REPLY_MAX_EXCEEDED;
+    {
+        IdAssignmentTypeDef ids;
+        ids.ch1.id = Evalboards.ch1.id;
+        ids.ch2.id = Evalboards.ch2.id;
+        ActualReply.Value.Int32 = Board_supported(&ids);
+    }
+    break;
+    case 5: // Get hardware ID
+        ActualReply.Value.Int32 = hwid;
         break;
     case 6:
-        debug_setTriggerMaskShift(*data, motor);
+        ActualReply.Value.UInt32 = HAL.IOs->config->getState(HAL.IOs->pins->pins[ActualCommand.Motor]);
         break;
     case 7:
-        debug_enableTrigger(motor, *data);
+        ActualReply.Value.UInt32 = spi_getFrequency(&HAL.SPI->ch1);
         break;
     case 8:
-        *data = debug_getState();
+        ActualReply.Value.UInt32 = spi_getFrequency(&HAL.SPI->ch2);
         break;
     case 9:
-        if (!debug_getSample(*data, data))
-            return REPLY_MAX_EXCEEDED;
+        ActualReply.Value.UInt32 = spi_getMode(&HAL.SPI->ch1);
         break;
     case 10:
-        if (!debug_getInfo(*data, data))
-            return REPLY_MAX_EXCEEDED;
+        ActualReply.Value.UInt32 = spi_getMode(&HAL.SPI->ch2);
         break;
     case 11:
-        if (!debug_getChannelType(motor, (uint8_t *) data))
-            return REPLY_MAX_EXCEEDED;
-        break;
-    case 12:
-        if (!debug_getChannelAddress(motor, data))
-            return REPLY_MAX_EXCEEDED;
+        if (ActualCommand.Motor >= numberOfInterfaces + 1)
+        {
+            ActualReply.Status = REPLY_MAX_EXCEEDED;
+            break;
+        }
+
+        // Motor argument selects what interface to read out.
+        // 0 refers to the interface used by the request.
+        ActualReply.Value.UInt32 = maxExtraData[(ActualCommand.Motor == 0) ? currentInterface : ((uint32_t) ActualCommand.Motor - 1)];
+        break;
+
+    case 12:
+        ActualReply.Value.UInt32 = UART_getActiveBaudrate();
         break;
     case 13:
-        debug_setPretriggerSampleCount(*data);
+        ActualReply.Value.UInt32 = commandsPerPass;
         break;
     case 14:
-        *data = debug_getPretriggerSampleCount();
+        ActualReply.Value.UInt32 = processTimeBudget;
         break;
-    case 15:
-        if(Timer.initialized) {
-            Timer.setFrequency(TIMER_CHANNEL_2, *data);
-            *data = Timer.getPeriod(TIMER_CHANNEL_2);
-        }
+    case 15: // Commands executed with the opcode given as motor argument
+        ActualReply.Value.UInt32 = opcodeHits[ActualCommand.Motor];
         break;
     case 16:
-        if (!debug_setType(*data))
-            return REPLY_MAX_EXCEEDED;
+        ActualReply.Value.UInt32 = script.budget;
         break;
-    case 17:
-        if (!debug_setEvalChannel(*data))
-            return REPLY_MAX_EXCEEDED;
+    case 17: // Executed commands of an interface
+    case 18: // Received datagrams with checksum error of an interface
+    {
+        // Motor argument selects the interface like for type 11
+        uint32_t interface = (ActualCommand.Motor == 0) ? currentInterface : ((uint32_t) ActualCommand.Motor - 1);
+        if (interface >= numberOfInterfaces)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+
+        ActualReply.Value.UInt32 = (ActualCommand.Type == 17) ? stats.commands[interface] : stats.checksumErrors[interface];
         break;
-    case 18:
-        if (!debug_setAddress(*data))
-            return REPLY_MAX_EXCEEDED;
+    }
+    case 19: // Command to reply latency in µs. Motor argument: 0: Average, 1: Maximum
+        if (ActualCommand.Motor == 0)
+            ActualReply.Value.UInt32 = stats_average(stats.latencyCycles, stats.replies);
+        else if (ActualCommand.Motor == 1)
+            ActualReply.Value.UInt32 = systick_cyclesToMicroseconds(stats.latencyMaxCycles);
+        else
+            ActualReply.Status = REPLY_INVALID_VALUE;
         break;
-    case 19:
-        if (!debug_setTriggerType(*data))
-            return REPLY_MAX_EXCEEDED;
+    case 20: // Latency histogram bucket given as motor argument
+        if (ActualCommand.Motor >= TMCL_STATS_LATENCY_BUCKETS)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+
+        ActualReply.Value.UInt32 = stats.latencyHistogram[ActualCommand.Motor];
         break;
-    case 20:
-        if (!debug_setTriggerEvalChannel(*data))
-            return REPLY_MAX_EXCEEDED;
+    case 21: // Maximum execution time in µs of the opcode given as motor argument
+        ActualReply.Value.UInt32 = systick_cyclesToMicroseconds(opcodeMaxCycles[ActualCommand.Motor]);
         break;
-    case 21:
-        if (!debug_setTriggerAddress(*data))
-            return REPLY_MAX_EXCEEDED;
+    case 22: // Average execution time in µs of the opcode given as motor argument
+        ActualReply.Value.UInt32 = stats_average(opcodeCycles[ActualCommand.Motor], opcodeHits[ActualCommand.Motor]);
         break;
-    case 22:
-        if (!debug_bulkDownload(*data, data))
-            return REPLY_CMD_NOT_AVAILABLE;
+    case 23: // Main loop period in µs. Motor argument: 0: Average, 1: Minimum, 2: Maximum, 3: Last
+        switch(ActualCommand.Motor)
+        {
+        case 0:
+            ActualReply.Value.UInt32 = stats_average(stats.passCycles, stats.passes);
+            break;
+        case 1:
+            ActualReply.Value.UInt32 = (stats.passes) ? systick_cyclesToMicroseconds(stats.passMinCycles) : 0;
+            break;
+        case 2:
+            ActualReply.Value.UInt32 = systick_cyclesToMicroseconds(stats.passMaxCycles);
+            break;
+        case 3:
+            ActualReply.Value.UInt32 = (stats.passes) ? systick_cyclesToMicroseconds(stats.passLastCycles) : 0;
+            break;
+        default:
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+        break;
+    case 24: // All command path statistics as extra data, value: Amount of words
+        stats_appendBlock();
+        break;
+
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void boardAssignment(void)
+{
+    uint8_t testOnly = 0;
+
+    IdAssignmentTypeDef ids;
+    ids.ch1.id     = (ActualCommand.Value.Int32 >> 0)   & 0xFF;
+    ids.ch1.state  = (ActualCommand.Value.Int32 >> 8)   & 0xFF;
+    ids.ch2.id     = (ActualCommand.Value.Int32 >> 16)  & 0xFF;
+    ids.ch2.state  = (ActualCommand.Value.Int32 >> 24)  & 0xFF;
+
+    switch(ActualCommand.Type)
+    {
+    case 0:  // auto detect and assign
+        startJob(idDetectionJob);
+        return;
+        break;
+    case 1:  // id for channel 2 not changed, reset maybe
+        ids.ch2.id     = Evalboards.ch2.id;
+        ids.ch2.state  = ID_STATE_WAIT_LOW;
+        break;
+    case 2:  // id for channel 1 not changed, reset maybe
+        ids.ch2.id     = (ActualCommand.Value.Int32 >> 0)  & 0xFF;
+        ids.ch2.state  = (ActualCommand.Value.Int32 >> 8)  & 0xFF;
+        ids.ch1.id     = Evalboards.ch1.id;
+        ids.ch1.state  = ID_STATE_WAIT_LOW;
+        break;
+    case 3:  // id for both channels
+        break;
+    case 4:  // test if ids are in firmware
+        testOnly = 1;
+        if(ActualReply.Value.Int32 == 0)
+        {
+            ids.ch1.id = Evalboards.ch1.id;
+            ids.ch2.id = Evalboards.ch2.id;
+        }
+        break;
+    case 5:  // Re-Check board types - but do not [de]init any boards
+        checkBoardTypes();
+        return;
         break;
     default:
-        return REPLY_INVALID_TYPE;
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
         break;
     }
 
-    return REPLY_OK;
+    IdAssignmentTypeDef ids_buff;
+    ids_buff.ch1.id     = ids.ch1.id;
+    ids_buff.ch1.state  = ID_STATE_DONE;
+    ids_buff.ch2.id     = ids.ch2.id;
+    ids_buff.ch2.state  = ID_STATE_DONE;
+
+    if(!testOnly)
+        ActualReply.Value.Int32 = Board_assign(&ids_buff);
+    else
+        ActualReply.Value.Int32 = Board_supported(&ids_buff);
+}
+
+static void boardsErrors(void)
+{
+    switch(ActualCommand.Type)
+    {
+    case 0:
+        ActualReply.Value.Int32 = Evalboards.ch1.errors;
+        break;
+    case 1:
+        ActualReply.Value.Int32 = Evalboards.ch2.errors;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void boardsReset(void)
+{
+    switch(ActualCommand.Type)
+    {
+    case 0:
+        if(!Evalboards.ch1.config->reset())
+            ActualReply.Status = REPLY_WRITE_PROTECTED;
+        break;
+    case 1:
+        if(!Evalboards.ch2.config->reset())
+            ActualReply.Status = REPLY_WRITE_PROTECTED;
+        break;
+    case 2:
+        if(!Evalboards.ch1.config->reset())
+            ActualReply.Status = REPLY_WRITE_PROTECTED;
+        if(!Evalboards.ch2.config->reset())
+            ActualReply.Status = REPLY_WRITE_PROTECTED;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void boardsMeasuredSpeed(void)
+{
+    switch(ActualCommand.Type)
+    {
+    case 0:
+        ActualReply.Status = Evalboards.ch1.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32);
+        break;
+    case 1:
+        ActualReply.Status = Evalboards.ch2.getMeasuredSpeed(ActualCommand.Motor, &ActualReply.Value.Int32);
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void setDriversEnable()
+{
+    vitalsignsmonitor_clearOvervoltageErrors();
+
+    Evalboards.driverEnable = (ActualCommand.Value.Int32) ? DRIVER_ENABLE : DRIVER_DISABLE;
+    Evalboards.ch1.enableDriver(DRIVER_USE_GLOBAL_ENABLE);
+    Evalboards.ch2.enableDriver(DRIVER_USE_GLOBAL_ENABLE);
+}
+
+static bool idDetectionJob(TMCLJobTypeDef *job)
+{
+    IdAssignmentTypeDef ids = { 0 };
+
+    if(job->state == 0)
+    {
+        // Backwards compatibility:
+        // For now we do this *before* scanning the bus since TMCL-IDE <= 4.6.0 will
+        // use this command (TMCL_GetIDs type 0) to switch the ID from TMC9660
+        // bootloader to param/reg. Later this will change to always do the generic
+        // ID detection first followed by identifying the board type here and using
+        // a different command (TMCL_GetIDs type 5) - but that change will break the
+        // old TMCL-IDE mechanism.
+        if (checkBoardTypes())
+            return true;
+
+        Evalboards.ch1.deInit();
+        Evalboards.ch2.deInit();
+        Evalboards.ch1.id = 0;
+        Evalboards.ch2.id = 0;
+
+        job->state = 1;
+    }
+
+    // Try detecting the IDs
+    if (!IDDetection_detect(&ids))
+    {
+        // Monoflop detection not yet finished
+        return false;
+    }
+
+    // ID detection completed -> Assign the board
+    Board_assign(&ids);
+    ActualReply.Value.UInt32 = (uint32_t)(
+            (ids.ch1.id)
+            | (ids.ch1.state << 8)
+            | (ids.ch2.id    << 16)
+            | (ids.ch2.state << 24)
+    );
+    return true;
+}
+
+static bool checkBoardTypes()
+{
+    IdAssignmentTypeDef ids = { 0 };
+
+    switch(Evalboards.ch1.id)
+    {
+    case ID_TMC9660_3PH_BL_EVAL:
+    case ID_TMC9660_STEPPER_BL_EVAL:
+    case ID_TMC9660_3PH_PARAM_EVAL:
+    case ID_TMC9660_STEPPER_PARAM_EVAL:
+    case ID_TMC9660_3PH_REG_EVAL:
+    case ID_TMC9660_STEPPER_REG_EVAL:
+    {
+        int32_t val = 0;
+        bool isStepper = Evalboards.ch1.id >= ID_TMC9660_STEPPER_BL_EVAL;
+
+        Evalboards.ch1.userFunction(0,0,&val);
+        if(val == TM01)
+        {
+            // Bootloader responded -> Chip is in bootloader mode
+            ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_BL_EVAL : ID_TMC9660_3PH_BL_EVAL;
+        }
+        else
+        {
+            val = 0;
+            Evalboards.ch1.userFunction(2,0,&val);
+            if (val == 51)
+            {
+                // Chip responded with parameter mode ID -> Chip is in parameter mode
+                ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_PARAM_EVAL : ID_TMC9660_3PH_PARAM_EVAL;
+            }
+            else if (val == 17)
+            {
+                ids.ch1.id = (isStepper) ? ID_TMC9660_STEPPER_REG_EVAL : ID_TMC9660_3PH_REG_EVAL;
+            }
+            else
+            {
+                // Unknown
+                return false;
+            }
+        }
+        Evalboards.ch1.errors &= ~0x07;
+
+        Evalboards.ch1.id = ids.ch1.id;
+        tmcl_resetRouting();
+        ids.ch1.state = ID_STATE_DONE;
+        ActualReply.Value.Int32 = (uint32_t)(
+                (Evalboards.ch1.id)
+                | (ids.ch1.state << 8)
+                | (ids.ch2.id    << 16)
+                | (ids.ch2.state << 24)
+        );
+        return true;
+        break;
+    }
+    default:
+        return false;
+    }
+}
+
+static void SoftwareReset(void)
+{
+    if(ActualCommand.Value.Int32 == 1234)
+        resetRequest = true;
+}
+
+static void GetVersion(void)
+{
+    if(ActualCommand.Type == VERSION_FORMAT_ASCII)
+    {
+        ActualReply.IsSpecial   = 1;
+        ActualReply.Special[0]  = SERIAL_HOST_ADDRESS;
+
+        for(uint8_t i = 0; i < 8; i++)
+            ActualReply.Special[i+1] = VersionString[i];
+    }
+    else if(ActualCommand.Type == VERSION_FORMAT_BINARY)
+    {
+        // module version high
+        ActualReply.Value.Byte[3] = MODULE_ID / 100;
+
+        // module version low
+        ActualReply.Value.Byte[2] = MODULE_ID % 100;
+
+        // fw version high
+        ActualReply.Value.Byte[1] = VERSION_MAJOR;
+
+        // fw version low
+        ActualReply.Value.Byte[0] = VERSION_MINOR;
+    }
+    //how were the boards detected?	// todo CHECK 2: Doesn't fit into GetVersion. Move somewhere else? Or maybe change GetVersion to GetBoardInfo or something (LH)
+    else if(ActualCommand.Type == VERSION_BOARD_DETECT_SRC)
+    {
+        ActualReply.Value.Byte[0] = IdState.ch1.detectedBy;
+        ActualReply.Value.Byte[1] = IdState.ch2.detectedBy;
+    }
+    else if(ActualCommand.Type == VERSION_BUILD) {
+        ActualReply.Value.UInt32 = BUILD_VERSION;
+    }
+    else if(ActualCommand.Type == NUMBER_OF_MOTORS){
+        ActualReply.Value.UInt32 = Evalboards.ch1.numberOfMotors + Evalboards.ch2.numberOfMotors;
+    }
+}
+
+static void handleGetInfo(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case 0: // FWModuleID
+        ActualReply.Value.Int32 = MODULE_ID;
+        break;
+
+    case 1: // FWVersion
+        // Major version
+        ActualReply.Value.Byte[2] = VERSION_MAJOR;
+
+        // Minor version
+        ActualReply.Value.Byte[0] = VERSION_MINOR;
+        break;
+
+    case 2: // FWCapability
+        ActualReply.Value.Int32 = (GETINFO_FW_CAPABILITY_BITMASK_TMCL); // TMCL only firmware
+        break;
+
+    case 3: // FWReleaseType
+        ActualReply.Value.Int32 = GETINFO_RELEASE_TYPE;
+        break;
+
+    case 20: // APIndexBitWidth
+        ActualReply.Value.Int32 = 8;
+        break;
+
+    case 21: // RegAddrBitWidth
+        ActualReply.Value.UInt32 = 12;
+        break;
+
+    case 30: // Git info
+        if (GIT_VERSION_INFO == 0xFFFFFFFF)
+        {
+            // Illegal GIT_VERSION_INFO value -> Git info is disabled
+            ActualReply.Status = REPLY_INVALID_TYPE;
+            break;
+        }
+
+        ActualReply.Value.Int32 = GIT_VERSION_INFO;
+        break;
+
+    case 200: // DeviceSpecificArea: Patch version
+        ActualReply.Value.UInt32 = VERSION_PATCH;
+        break;
+
+    case 201: // DeviceSpecificArea: Attached Evalboard IDs
+        ActualReply.Value.UInt32 = Evalboards.ch1.id << 16 | Evalboards.ch2.id;
+        break;
+
+    case 202: // DeviceSpecificArea: Attached Evalboard hardware versions
+        ActualReply.Value.UInt32 = Evalboards.ch1.hwVersion.major << 24
+                                 | Evalboards.ch1.hwVersion.minor << 16
+                                 | Evalboards.ch2.hwVersion.major <<  8
+                                 | Evalboards.ch2.hwVersion.minor;
+        break;
+
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void SetOutput(void)
+{
+    if((Evalboards.ch1.SIO(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32) == TMC_ERROR_NONE)
+        || (Evalboards.ch2.SIO(ActualCommand.Type, ActualCommand.Motor, ActualCommand.Value.Int32) == TMC_ERROR_NONE))
+        return;
+}
+
+static void GetInput(void)
+{
+    if((Evalboards.ch1.GIO(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32) == TMC_ERROR_NONE) || (Evalboards.ch2.GIO(ActualCommand.Type, ActualCommand.Motor, &ActualReply.Value.Int32) == TMC_ERROR_NONE))
+        return;
+
+    switch(ActualCommand.Type)
+    {
+    case 0:
+        ActualReply.Value.Int32 = *HAL.ADCs->AIN0;
+        break;
+    case 1:
+        ActualReply.Value.Int32 = *HAL.ADCs->AIN1;
+        break;
+    case 2:
+        ActualReply.Value.Int32 = *HAL.ADCs->AIN2;
+        break;
+    case 3:
+        ActualReply.Value.Int32 = *HAL.ADCs->DIO4;
+        break;
+    case 4:
+        ActualReply.Value.Int32 = *HAL.ADCs->DIO5;
+        break;
+    case 5:
+        if(Evalboards.ch1.id == ID_TMC5241){
+            ActualReply.Value.Int32 = VitalSignsMonitor.VM + 7; // Rectifier diode lower the voltage to ~700mV
+        }
+        else
+        {
+            ActualReply.Value.Int32 = VitalSignsMonitor.VM;
+        }
+        break;
+    case 6:	// Raw VM ADC value, no scaling calculation done // todo QOL 2: Switch this case with case 5? That way we have the raw Values from 0-5, then 6 for scaled VM value. Requires IDE changes (LH)
+        ActualReply.Value.Int32 = *HAL.ADCs->VM;
+        break;
+    case 7:
+        ActualReply.Value.Int32 = *HAL.ADCs->AIN_EXT;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void HandleWlanCommand(void)
+{
+    switch(ActualCommand.Type)
+    {
+    case 0:
+        ActualReply.Value.Int32 = handleWLANCommand(ActualCommand.Motor, ActualCommand.Value.Int32);
+        break;
+    case 1:
+        enableWLANCommandMode();
+        break;
+    case 2:
+        ActualReply.Value.Int32 = checkReadyToSend();
+        break;
+    case 3:
+        ActualReply.Value.Int32 = checkCmdModeEnabled();
+        break;
+    case 4:
+        ActualReply.Value.Int32 = getCMDReply();
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static int handleRamDebug(uint8_t type, uint8_t motor, uint32_t *data)
+{
+    switch (type)
+    {
+    case 0:
+        debug_init();
+        break;
+    case 1:
+        debug_setSampleCount(*data);
+        break;
+    case 2:
+        /* Placeholder: Set sampling time reference*/
+        if (*data != 0)
+            return REPLY_INVALID_VALUE;
+        break;
+    case 3:
+        // RAMDebug expects a divisor value where 1 is original capture frequency,
+        // 2 is halved capture frequency etc.
+        // The TMCL-IDE sends prescaling values that are one lower than that.
+        debug_setPrescaler(*data + 1);
+        break;
+    case 4:
+        if (!debug_setChannel(motor, *data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 5:
+        if (!debug_setTriggerChannel(motor, *data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 6:
+        debug_setTriggerMaskShift(*data, motor);
+        break;
+    case 7:
+        debug_enableTrigger(motor, *data);
+        break;
+    case 8:
+        *data = debug_getState();
+        break;
+    case 9:
+        if (!debug_getSample(*data, data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 10:
+        if (!debug_getInfo(*data, data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 11:
+        if (!debug_getChannelType(motor, (uint8_t *) data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 12:
+        if (!debug_getChannelAddress(motor, data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 13:
+        debug_setPretriggerSampleCount(*data);
+        break;
+    case 14:
+        *data = debug_getPretriggerSampleCount();
+        break;
+    case 15:
+        if(Timer.initialized) {
+            Timer.setFrequency(TIMER_CHANNEL_2, *data);
+            *data = Timer.getPeriod(TIMER_CHANNEL_2);
+        }
+        break;
+    case 16:
+        if (!debug_setType(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 17:
+        if (!debug_setEvalChannel(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 18:
+        if (!debug_setAddress(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 19:
+        if (!debug_setTriggerType(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 20:
+        if (!debug_setTriggerEvalChannel(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 21:
+        if (!debug_setTriggerAddress(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 22:
+        if (!debug_bulkDownload(*data, data))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 23: // Streaming mode. 1: Stream the next capture to this interface, 0: End the stream
+        if (*data != 0)
+        {
+            // Frames have to fit the dropped point counter and a sampling point of all channels
+            if (tmcl_getExtraDataLimit() < (RAMDEBUG_MAX_CHANNELS + 1) * sizeof(uint32_t))
+                return REPLY_CMD_NOT_AVAILABLE;
+
+            ramdebugStream.interface = currentInterface;
+            ramdebugStream.sequence  = 0;
+            ramdebugStream.lastTick  = systick_getTick();
+        }
+
+        if (!debug_setStreaming(*data != 0))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 24:
+        *data = debug_getStreamOverflows();
+        break;
+    case 25:
+        *data = debug_getStreamPending();
+        break;
+    case 26: // Sample encoding of the capture channel given as motor argument. Value: Encoding | (width << 8), width 0: 32 bits
+    {
+        uint8_t width = (*data >> 8) & 0xFF;
+        if (!debug_setChannelEncoding(motor, *data & 0xFF, (width == 0) ? 32 : width))
+            return REPLY_INVALID_VALUE;
+        break;
+    }
+    case 27:
+    {
+        uint8_t encoding, width;
+        if (!debug_getChannelEncoding(motor, &encoding, &width))
+            return REPLY_MAX_EXCEEDED;
+
+        *data = encoding | ((uint32_t) width << 8);
+        break;
+    }
+    case 28: // Storage width (8, 16, 32) of the capture channel given as motor argument
+        if (*data > 32 || !debug_setStorageWidth(motor, *data))
+            return REPLY_INVALID_VALUE;
+        break;
+    case 29: // Storage layout of the capture channel given as motor argument. Value: Width | (byte offset << 8)
+    {
+        uint8_t width, offset;
+        if (!debug_getStorageLayout(motor, &width, &offset))
+            return REPLY_MAX_EXCEEDED;
+
+        *data = width | ((uint32_t) offset << 8);
+        break;
+    }
+    case 30: // Select the trigger condition (0 - 3) configured by the trigger commands
+        if (!debug_selectTriggerCondition(*data))
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 31: // Type of the selected trigger condition
+        if (!debug_setTriggerCondition(*data))
+            return REPLY_INVALID_VALUE;
+        break;
+    case 32: // Threshold (lower window limit) of the selected trigger condition
+        if (!debug_setTriggerThreshold(*data))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 33: // Upper window limit of the selected trigger condition
+        if (!debug_setTriggerThresholdHigh(*data))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 34: // Hysteresis of the selected trigger condition
+        if (!debug_setTriggerHysteresis(*data))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 35: // Combination of the trigger conditions. 0: AND, 1: OR
+        if (!debug_setTriggerCombine(*data))
+            return REPLY_INVALID_VALUE;
+        break;
+    case 36: // Trigger holdoff: Evaluations to ignore after arming
+        debug_setTriggerHoldoff(*data);
+        break;
+    case 37: // Minimum trigger duration: Consecutive evaluations the conditions have to hold
+        debug_setTriggerMinDuration(*data);
+        break;
+    case 38: // Decimation mode of the capture channel given as motor argument
+        if (!debug_setChannelDecimation(motor, *data))
+            return REPLY_INVALID_VALUE;
+        break;
+    case 39:
+    {
+        uint8_t mode;
+        if (!debug_getChannelDecimation(motor, &mode))
+            return REPLY_MAX_EXCEEDED;
+
+        *data = mode;
+        break;
+    }
+    case 40: // Amount of capture segments (multi-shot capture)
+        if (!debug_setSegments(*data))
+            return REPLY_INVALID_VALUE;
+        break;
+    case 41:
+        *data = debug_getSegments();
+        break;
+    case 42: // Amount of filled segments
+        *data = debug_getFilledSegments();
+        break;
+    case 43: // Trigger systick of the segment given as motor argument
+    case 44: // Packing padding before the trigger point of the segment given as motor argument
+    {
+        uint32_t triggerTick, padding;
+        if (!debug_getSegmentInfo(motor, &triggerTick, &padding))
+            return REPLY_MAX_EXCEEDED;
+
+        *data = (type == 43) ? triggerTick : padding;
+        break;
+    }
+    case 45: // DMA capture of the analog input given as motor argument at the given frequency, 0: Disabled
+        if (!debug_setAdcCapture(motor, *data))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 46: // DMA capture frequency, 0: Disabled
+    {
+        uint8_t input;
+        *data = debug_getAdcCapture(&input);
+        break;
+    }
+    case 47: // Statistics mode. 1: Feed the next capture into the statistics, 0: End the capture
+        if (!debug_setStatistics(*data != 0))
+            return REPLY_CMD_NOT_AVAILABLE;
+        break;
+    case 48: // Amount of sampling points in the statistics
+        *data = debug_getStatisticsCount();
+        break;
+    case 49: // Statistics block as extra data, value: Amount of words
+        if (!debug_isStatistics())
+            return REPLY_CMD_NOT_AVAILABLE;
+
+        *data = debug_statisticsAppend();
+        if (*data == 0)
+            return REPLY_MAX_EXCEEDED;
+        break;
+    case 50: // Histogram of the capture channel given as motor argument as extra data
+        if (!debug_histogramAppend(motor))
+            return REPLY_MAX_EXCEEDED;
+
+        *data = RAMDEBUG_HISTOGRAM_BINS;
+        break;
+    case 51: // Histogram of the capture channel given as motor argument. Value: Lower bound (signed 24 bit) | (shift << 24)
+        if (!debug_setHistogram(motor, ((int32_t) (*data << 8)) >> 8, *data >> 24))
+            return REPLY_INVALID_VALUE;
+        break;
+    default:
+        return REPLY_INVALID_TYPE;
+        break;
+    }
+
+    return REPLY_OK;
+}
+
+/*
+ * Reads multiple registers with a single command and returns the values as extra data.
+ *
+ * The register address and motor are encoded like for TMCL_readRegisterChannel_X.
+ * The lower 16 bits of the value hold the amount of registers to read. Without
+ * REGISTER_BLOCK_USE_LIST the consecutive registers starting at the given address
+ * are read. With REGISTER_BLOCK_USE_LIST the addresses are taken from the register
+ * list (see handleRegisterList()), starting at the list index given as address.
+ *
+ * The reply value holds the amount of register values sent. If that is less than
+ * requested, the host continues with another request for the remaining registers.
+ */
+static void readRegisterBlock(EvalboardFunctionsTypeDef *ch, uint32_t brownOutMask)
+{
+    uint8_t motor     = ActualCommand.Motor & 0x0F;
+    uint16_t address  = getExtendedAddress(&ActualCommand);
+    bool useList      = ActualCommand.Value.UInt32 & REGISTER_BLOCK_USE_LIST;
+    uint32_t count    = ActualCommand.Value.UInt32 & REGISTER_BLOCK_COUNT_MASK;
+
+    // Do not allow reads during brownout to prevent garbage data being used
+    // in read-modify-write operations. Bypass this safety with motor = 255
+    if ((VitalSignsMonitor.brownOut & brownOutMask) && ActualCommand.Motor != 255)
+    {
+        ActualReply.Status = REPLY_CHIP_READ_FAILED;
+        return;
+    }
+
+    // Without extra data support there is no way to send the values
+    uint32_t maxCount = tmcl_getExtraDataLimit() / sizeof(uint32_t);
+    if (maxCount == 0)
+    {
+        ActualReply.Status = REPLY_CMD_NOT_AVAILABLE;
+        return;
+    }
+
+    if (useList)
+    {
+        if (address > registerListCount)
+        {
+            ActualReply.Status = REPLY_INVALID_TYPE;
+            return;
+        }
+
+        count = MIN(count, registerListCount - address);
+    }
+    else
+    {
+        // Do not read beyond the extended address range
+        count = MIN(count, 0x1000 - (uint32_t) address);
+    }
+
+    count = MIN(count, maxCount);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t value = 0;
+        ch->readRegister(motor, (useList) ? registerList[address + i].address : (address + i), &value);
+        tmcl_appendData((uint8_t *) &value, sizeof(value));
+    }
+
+    ActualReply.Value.UInt32 = count;
+}
+
+/*
+ * Manages the register list.
+ *
+ * The list holds the addresses read by TMCL_readRegisterBlockChannel_X, which
+ * allows reading arbitrary, non-consecutive register sets in one request.
+ * Entries added with TMCL_writeRegisterListEntry additionally hold a motor and
+ * a value and can be written to an Evalboard in one go with REGISTER_LIST_APPLY.
+ * Entries added with REGISTER_LIST_APPEND are only read, never written.
+ */
+static void handleRegisterList(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case REGISTER_LIST_CLEAR:
+        registerListCount = 0;
+        break;
+    case REGISTER_LIST_APPEND:
+        appendRegisterListEntry(ActualCommand.Value.UInt32 & 0x0FFF, 0, 0, false);
+        break;
+    case REGISTER_LIST_GET_COUNT:
+        ActualReply.Value.UInt32 = registerListCount;
+        break;
+    case REGISTER_LIST_APPLY:
+        applyRegisterList();
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static void appendRegisterListEntry(uint16_t address, uint8_t motor, int32_t value, bool write)
+{
+    if (registerListCount >= REGISTER_LIST_SIZE)
+    {
+        ActualReply.Status = REPLY_MAX_EXCEEDED;
+        return;
+    }
+
+    registerList[registerListCount].address  = address;
+    registerList[registerListCount].motor    = motor;
+    registerList[registerListCount].value    = value;
+    registerList[registerListCount].write    = write;
+    registerListCount++;
+
+    ActualReply.Value.UInt32 = registerListCount;
+}
+
+/*
+ * Writes all register list entries added with TMCL_writeRegisterListEntry to
+ * the Evalboard selected by the motor argument (0: ch1, 1: ch2).
+ *
+ * With REGISTER_LIST_APPLY_DISABLE_DRIVER the driver is held disabled until all
+ * writes are done, so the motor never runs with a partially applied register set.
+ * With REGISTER_LIST_APPLY_VERIFY every register is read back after writing and
+ * entries with a differing value are marked as failed. This is only meaningful
+ * for registers that read back the written value.
+ *
+ * The reply value holds the failure bitmap of the first 32 entries (bit n set:
+ * entry n failed). Bits of entries that are only read stay cleared. For longer lists the full bitmap is also sent as extra data,
+ * if the interface supports it.
+ */
+static void applyRegisterList(void)
+{
+    EvalboardFunctionsTypeDef *ch = (ActualCommand.Motor == 1) ? &Evalboards.ch2 : &Evalboards.ch1;
+    uint32_t brownOutMask = (ActualCommand.Motor == 1) ? VSM_ERRORS_BROWNOUT_CH2 : VSM_ERRORS_BROWNOUT_CH1;
+    bool disableDriver = ActualCommand.Value.UInt32 & REGISTER_LIST_APPLY_DISABLE_DRIVER;
+    bool verify = ActualCommand.Value.UInt32 & REGISTER_LIST_APPLY_VERIFY;
+    uint32_t failed[REGISTER_LIST_SIZE / 32] = { 0 };
+
+    if (disableDriver)
+        ch->enableDriver(DRIVER_DISABLE);
+
+    for (uint32_t i = 0; i < registerListCount; i++)
+    {
+        RegisterListEntryTypeDef *entry = &registerList[i];
+
+        if (!entry->write)
+            continue;
+
+        ch->writeRegister(entry->motor, entry->address, entry->value);
+
+        if (!verify)
+            continue;
+
+        // Read back values are unreliable during brownout - report those writes as failed
+        int32_t value = 0;
+        if (!(VitalSignsMonitor.brownOut & brownOutMask))
+            ch->readRegister(entry->motor, entry->address, &value);
+
+        if ((VitalSignsMonitor.brownOut & brownOutMask) || value != entry->value)
+            failed[i / 32] |= 1u << (i % 32);
+    }
+
+    if (disableDriver)
+        ch->enableDriver(DRIVER_USE_GLOBAL_ENABLE);
+
+    ActualReply.Value.UInt32 = failed[0];
+
+    if (registerListCount > 32)
+        tmcl_appendData((uint8_t *) failed, ((registerListCount + 31) / 32) * sizeof(uint32_t));
+}
+
+/*
+ * Configures the telemetry subscription.
+ *
+ * The subscribed channels use the RAMDebug channel format: The motor argument
+ * holds the capture type (RAMDebugSource), the value holds the channel value
+ * as used for RAMDebug channels (eval channel in bit 16).
+ * Setting a nonzero period (in ms) starts pushing telemetry frames on the
+ * interface the command was received on. A period of 0 stops it.
+ */
+static void handleTelemetry(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case TELEMETRY_CLEAR:
+        telemetry.channelCount  = 0;
+        telemetry.period        = 0;
+        break;
+    case TELEMETRY_ADD_CHANNEL:
+        if (ActualCommand.Motor == CAPTURE_DISABLED || ActualCommand.Motor >= CAPTURE_END)
+        {
+            ActualReply.Status = REPLY_INVALID_TYPE;
+            break;
+        }
+
+        if (telemetry.channelCount >= TELEMETRY_MAX_CHANNELS)
+        {
+            ActualReply.Status = REPLY_MAX_EXCEEDED;
+            break;
+        }
+
+        telemetry.channels[telemetry.channelCount].type          = ActualCommand.Motor;
+        telemetry.channels[telemetry.channelCount].eval_channel  = (ActualCommand.Value.UInt32 >> 16) & 0x01;
+        telemetry.channels[telemetry.channelCount].address       = ActualCommand.Value.UInt32;
+        telemetry.channelCount++;
+        ActualReply.Value.UInt32 = telemetry.channelCount;
+        break;
+    case TELEMETRY_SET_PERIOD:
+        if (ActualCommand.Value.UInt32 == 0)
+        {
+            telemetry.period = 0;
+            break;
+        }
+
+        // Timestamp + samples have to fit into a single extra data reply
+        if (tmcl_getExtraDataLimit() < (telemetry.channelCount + 1) * sizeof(uint32_t))
+        {
+            ActualReply.Status = REPLY_CMD_NOT_AVAILABLE;
+            break;
+        }
+
+        telemetry.interface  = currentInterface;
+        telemetry.sequence   = 0;
+        telemetry.lastTick   = systick_getTick();
+        telemetry.period     = ActualCommand.Value.UInt32;
+        break;
+    case TELEMETRY_GET_CHANNELS:
+        ActualReply.Value.UInt32 = telemetry.channelCount;
+        break;
+    case TELEMETRY_GET_PERIOD:
+        ActualReply.Value.UInt32 = telemetry.period;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+/*
+ * Samples the subscribed channels and pushes them to the host once per period.
+ *
+ * The frame is a regular TMCL reply with the TMCL_Telemetry opcode and the
+ * frame sequence number as value, followed by the systick timestamp and one
+ * 32 bit value per channel as extra data with the usual CRC32 checksum.
+ * Called after the queued command replies were flushed. At most one frame is
+ * sent per call, and only if the transmit buffer of the interface has room
+ * for it besides those replies.
+ */
+static void telemetry_process(void)
+{
+    if (telemetry.period == 0)
+        return;
+
+    uint32_t tick = systick_getTick();
+    if ((tick - telemetry.lastTick) < telemetry.period)
+        return;
+
+    telemetry.lastTick += telemetry.period;
+
+    // Do not try to catch up on missed periods
+    if ((tick - telemetry.lastTick) >= telemetry.period)
+        telemetry.lastTick = tick;
+
+    uint32_t previousInterface = currentInterface;
+    currentInterface = telemetry.interface;
+
+    // The extra data size may have been reduced after starting the telemetry
+    if (tmcl_getExtraDataLimit() < (telemetry.channelCount + 1) * sizeof(uint32_t))
+    {
+        telemetry.period = 0;
+        currentInterface = previousInterface;
+        return;
+    }
+
+    // Drop the frame while the interface is still busy with previous data,
+    // e.g. the V3 USB waiting for the host to fetch its transmit buffer.
+    // The sequence number is advanced anyway, so the host can detect the gap.
+    if (!hasTxSpace(telemetry.interface, 9 + (telemetry.channelCount + 2) * sizeof(uint32_t)))
+    {
+        telemetry.sequence++;
+        currentInterface = previousInterface;
+        return;
+    }
+
+    tmcl_appendData((uint8_t *) &tick, sizeof(tick));
+    for (uint32_t i = 0; i < telemetry.channelCount; i++)
+    {
+        TelemetryChannelTypeDef *channel = &telemetry.channels[i];
+        uint32_t sample = debug_readChannel(channel->type, channel->eval_channel, channel->address);
+        tmcl_appendData((uint8_t *) &sample, sizeof(sample));
+    }
+
+    ActualReply.ModuleId     = SERIAL_MODULE_ADDRESS;
+    ActualReply.Status       = REPLY_OK;
+    ActualReply.Opcode       = TMCL_Telemetry;
+    ActualReply.Value.UInt32 = telemetry.sequence++;
+    ActualReply.IsSpecial    = 0;
+
+    tx(&interfaces[telemetry.interface]);
+
+    currentInterface = previousInterface;
+}
+
+static void ramdebugStream_process(void)
+{
+    if (!debug_isStreaming())
+        return;
+
+    uint32_t pending = debug_getStreamPending();
+    if (pending == 0)
+        return;
+
+    uint32_t previousInterface = currentInterface;
+    currentInterface = ramdebugStream.interface;
+
+    // The extra data size may have been reduced after starting the stream
+    uint32_t frameSamples = tmcl_getExtraDataLimit() / sizeof(uint32_t);
+    if (frameSamples < RAMDEBUG_MAX_CHANNELS + 1)
+    {
+        debug_setStreaming(false);
+        currentInterface = previousInterface;
+        return;
+    }
+
+    // One word is taken by the dropped point counter
+    frameSamples -= 1;
+    frameSamples -= frameSamples % debug_getStreamSetSize();
+
+    uint32_t tick = systick_getTick();
+    while (pending >= frameSamples || (pending > 0 && (tick - ramdebugStream.lastTick) >= RAMDEBUG_STREAM_FLUSH_INTERVAL))
+    {
+        uint32_t samples = MIN(pending, frameSamples);
+
+        // Keep the samples buffered while a slow interface is busy
+        if (!hasTxSpace(ramdebugStream.interface, 9 + (samples + 2) * sizeof(uint32_t)))
+            break;
+
+        uint32_t overflows = debug_getStreamOverflows();
+        tmcl_appendData((uint8_t *) &overflows, sizeof(overflows));
+        debug_streamAppend(samples);
+
+        ActualReply.ModuleId     = SERIAL_MODULE_ADDRESS;
+        ActualReply.Status       = REPLY_OK;
+        ActualReply.Opcode       = TMCL_RamDebugStream;
+        ActualReply.Value.UInt32 = ramdebugStream.sequence++;
+        ActualReply.IsSpecial    = 0;
+
+        tx(&interfaces[ramdebugStream.interface]);
+
+        ramdebugStream.lastTick = tick;
+
+        // The remaining samples stay in the ring buffer until the next pass
+        if (!reportsTxSpace(ramdebugStream.interface))
+            break;
+
+        pending = debug_getStreamPending();
+    }
+
+    currentInterface = previousInterface;
+}
+
+static TMCLJobTypeDef *findJob(uint8_t ticket)
+{
+    for (uint32_t i = 0; i < TMCL_JOB_COUNT; i++)
+    {
+        if (jobs[i].step && jobs[i].ticket == ticket)
+            return &jobs[i];
+    }
+
+    return NULL;
+}
+
+// Reply with the state of the job. A finished job is removed once its result got reported.
+static void reportJob(TMCLJobTypeDef *job)
+{
+    ActualReply.Status = job->status;
+
+    if (job->status == REPLY_DELAYED)
+    {
+        ActualReply.Value.UInt32 = job->ticket;
+        return;
+    }
+
+    ActualReply.Value.Int32 = job->value;
+    job->step = NULL;
+}
+
+/*
+ * Executes ActualCommand as asynchronous job, starting with the first step.
+ *
+ * Sending the same command again while its job exists reports the job state
+ * instead of starting another one.
+ *
+ * @return false if no job slot was free - ActualCommand did not get executed
+ */
+static bool startJob(TMCLJobStep step)
+{
+    TMCLJobTypeDef *job = NULL;
+
+    for (uint32_t i = 0; i < TMCL_JOB_COUNT; i++)
+    {
+        if (!jobs[i].step)
+        {
+            if (!job)
+                job = &jobs[i];
+
+            continue;
+        }
+
+        if (jobs[i].interface     == currentInterface
+         && jobs[i].command.Opcode == ActualCommand.Opcode
+         && jobs[i].command.Type   == ActualCommand.Type
+         && jobs[i].command.Motor  == ActualCommand.Motor
+         && jobs[i].command.Value.Int32 == ActualCommand.Value.Int32)
+        {
+            reportJob(&jobs[i]);
+            return true;
+        }
+    }
+
+    if (!job)
+    {
+        ActualReply.Status = REPLY_DELAYED;
+        ActualReply.Value.UInt32 = 0;
+        return false;
+    }
+
+    // Skip ticket 0 and tickets still in use after a wraparound
+    do
+    {
+        lastTicket++;
+    } while (lastTicket == 0 || findJob(lastTicket));
+
+    job->command    = ActualCommand;
+    job->state      = 0;
+    job->tick       = systick_getTick();
+    job->interface  = currentInterface;
+    job->ticket     = lastTicket;
+
+    // Commands finishing within their first step are answered directly
+    if (step(job))
+        return true;
+
+    job->step    = step;
+    job->status  = REPLY_DELAYED;
+    job->value   = 0;
+
+    ActualReply.Status = REPLY_DELAYED;
+    ActualReply.Value.UInt32 = job->ticket;
+
+    return true;
+}
+
+// Advance every running job by one step and drop results nobody collected
+static void processJobs(void)
+{
+    for (uint32_t i = 0; i < TMCL_JOB_COUNT; i++)
+    {
+        TMCLJobTypeDef *job = &jobs[i];
+
+        if (!job->step)
+            continue;
+
+        if (job->status != REPLY_DELAYED)
+        {
+            if (timeSince(job->tick) > TMCL_JOB_RESULT_TIMEOUT)
+                job->step = NULL;
+
+            continue;
+        }
+
+        ActualCommand             = job->command;
+        ActualReply.ModuleId      = ActualCommand.ModuleId;
+        ActualReply.Opcode        = ActualCommand.Opcode;
+        ActualReply.Status        = REPLY_OK;
+        ActualReply.Value.Int32   = ActualCommand.Value.Int32;
+        ActualReply.IsSpecial     = 0;
+        currentInterface          = job->interface;
+
+        if (!job->step(job))
+            continue;
+
+        job->status  = ActualReply.Status;
+        job->value   = ActualReply.Value.Int32;
+        job->tick    = systick_getTick();
+    }
+}
+
+static void handleTicket(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case 0: // Get the state or result of the job with the given ticket
+    {
+        TMCLJobTypeDef *job = (ActualCommand.Value.UInt32 <= 0xFF) ? findJob(ActualCommand.Value.UInt32) : NULL;
+        if (!job)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            break;
+        }
+
+        reportJob(job);
+        break;
+    }
+    case 1: // Get the amount of used job slots
+        ActualReply.Value.UInt32 = 0;
+        for (uint32_t i = 0; i < TMCL_JOB_COUNT; i++)
+        {
+            if (jobs[i].step)
+                ActualReply.Value.UInt32++;
+        }
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static bool bootJob(TMCLJobTypeDef *job)
+{
+    if (job->state == 0)
+    {
+        // Drop all other jobs, they would access the shut down boards
+        for (uint32_t i = 0; i < TMCL_JOB_COUNT; i++)
+        {
+            if (&jobs[i] != job)
+                jobs[i].step = NULL;
+        }
+
+        prepareBootloader();
+        bootPending = true;
+        job->tick   = systick_getTick();
+        job->state  = 1;
+        return false;
+    }
+
+    if (timeSince(job->tick) < TMCL_BOOT_DELAY)
+        return false;
+
+    startBootloader();
+    return true;
+}
+
+static void script_stop(uint8_t status)
+{
+    script.state    = TM_IDLE;
+    script.waiting  = false;
+
+    if (status != REPLY_OK)
+    {
+        script.errorStatus   = status;
+        script.errorAddress  = script.pc;
+    }
+}
+
+static void handleApplStop(void)
+{
+    if (script.state == TM_RUN || script.state == TM_STEP)
+        script_stop(REPLY_OK);
+}
+
+static void handleApplRun(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case 0: // Continue at the current program counter
+        break;
+    case 1: // Start at the given address
+        if (ActualCommand.Value.UInt32 >= SCRIPT_SIZE)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            return;
+        }
+
+        script.pc          = ActualCommand.Value.UInt32;
+        script.stackDepth  = 0;
+        events.inInterrupt = false;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
+    }
+
+    script.waiting      = false;
+    script.errorStatus  = REPLY_OK;
+    script.state        = TM_RUN;
+}
+
+static void handleApplStep(void)
+{
+    if (script.state == TM_RUN)
+    {
+        ActualReply.Status = REPLY_CMD_NOT_AVAILABLE;
+        return;
+    }
+
+    // The instruction is executed in script_process() to keep ActualReply intact
+    script.state = TM_STEP;
+}
+
+static void handleApplReset(void)
+{
+    script_stop(REPLY_OK);
+
+    script.pc           = 0;
+    script.accu         = 0;
+    script.x            = 0;
+    script.compare      = 0;
+    script.flags        = 0;
+    script.stackDepth   = 0;
+    script.errorStatus  = REPLY_OK;
+    events.inInterrupt  = false;
+}
+
+static void handleDownloadStart(void)
+{
+    if (ActualCommand.Type != 0)
+    {
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
+    }
+
+    if (ActualCommand.Value.UInt32 >= SCRIPT_SIZE)
+    {
+        ActualReply.Status = REPLY_INVALID_VALUE;
+        return;
+    }
+
+    script_stop(REPLY_OK);
+    events.inInterrupt      = false;
+    script.downloadAddress  = ActualCommand.Value.UInt32;
+    script.state            = TM_DOWNLOAD;
+}
+
+static void handleDownloadEnd(void)
+{
+    if (script.state == TM_DOWNLOAD)
+        script.state = TM_IDLE;
+}
+
+// Store ActualCommand at the download address. Used instead of executing commands while downloading.
+static void script_store(void)
+{
+    if (script.downloadAddress >= SCRIPT_SIZE)
+    {
+        ActualReply.Status = REPLY_CMD_LOAD_ERROR;
+        return;
+    }
+
+    TMCLInstructionTypeDef *instruction = &script.program[script.downloadAddress++];
+    instruction->opcode  = ActualCommand.Opcode;
+    instruction->type    = ActualCommand.Type;
+    instruction->motor   = ActualCommand.Motor;
+    instruction->value   = ActualCommand.Value.Int32;
+
+    ActualReply.Status = REPLY_CMD_LOADED;
+}
+
+// Reply with the instruction stored at the given address.
+// The reply carries opcode, type and motor in place of module id, status and opcode.
+static void handleReadMem(void)
+{
+    if (ActualCommand.Value.UInt32 >= SCRIPT_SIZE)
+    {
+        ActualReply.Status = REPLY_INVALID_VALUE;
+        return;
+    }
+
+    TMCLInstructionTypeDef *instruction = &script.program[ActualCommand.Value.UInt32];
+    ActualReply.ModuleId     = instruction->opcode;
+    ActualReply.Status       = instruction->type;
+    ActualReply.Opcode       = instruction->motor;
+    ActualReply.Value.Int32  = instruction->value;
+}
+
+static void handleGetStatus(void)
+{
+    switch (ActualCommand.Type)
+    {
+    case 0: // Interpreter state
+        ActualReply.Value.UInt32 = script.state;
+        break;
+    case 1: // Program counter
+        ActualReply.Value.UInt32 = script.pc;
+        break;
+    case 2: // Accumulator
+        ActualReply.Value.Int32 = script.accu;
+        break;
+    case 3: // X register
+        ActualReply.Value.Int32 = script.x;
+        break;
+    case 4: // Status of the instruction that stopped the script - address in the upper 16 bits
+        ActualReply.Value.UInt32 = script.errorStatus | (script.errorAddress << 16);
+        break;
+    case 5: // Error flags
+        ActualReply.Value.UInt32 = script.flags;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+}
+
+static bool script_checkCondition(uint8_t condition)
+{
+    switch (condition)
+    {
+    case SCRIPT_JC_ZE:
+    case SCRIPT_JC_EQ:
+        return script.compare == 0;
+    case SCRIPT_JC_NZ:
+    case SCRIPT_JC_NE:
+        return script.compare != 0;
+    case SCRIPT_JC_GT:
+        return script.compare > 0;
+    case SCRIPT_JC_GE:
+        return script.compare >= 0;
+    case SCRIPT_JC_LT:
+        return script.compare < 0;
+    case SCRIPT_JC_LE:
+        return script.compare <= 0;
+    case SCRIPT_JC_ETO:
+        return script.flags & SCRIPT_FLAG_TIMEOUT;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return false;
+    }
+}
+
+static void script_calc(uint8_t operation, int32_t operand)
+{
+    switch (operation)
+    {
+    case SCRIPT_CALC_ADD:
+        script.accu += operand;
+        break;
+    case SCRIPT_CALC_SUB:
+        script.accu -= operand;
+        break;
+    case SCRIPT_CALC_MUL:
+        script.accu *= operand;
+        break;
+    case SCRIPT_CALC_DIV:
+    case SCRIPT_CALC_MOD:
+        if (operand == 0)
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            return;
+        }
+
+        script.accu = (operation == SCRIPT_CALC_DIV) ? script.accu / operand : script.accu % operand;
+        break;
+    case SCRIPT_CALC_AND:
+        script.accu &= operand;
+        break;
+    case SCRIPT_CALC_OR:
+        script.accu |= operand;
+        break;
+    case SCRIPT_CALC_XOR:
+        script.accu ^= operand;
+        break;
+    case SCRIPT_CALC_NOT:
+        script.accu = ~script.accu;
+        break;
+    case SCRIPT_CALC_LOAD:
+        script.accu = operand;
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
+    }
+
+    script.compare = (script.accu > 0) - (script.accu < 0);
+}
+
+// Returns true once the wait condition of the instruction is met
+static bool script_wait(TMCLInstructionTypeDef *instruction)
+{
+    if (!script.waiting)
+    {
+        script.waiting    = true;
+        script.waitStart  = systick_getTick();
+    }
+
+    uint32_t elapsed = timeSince(script.waitStart);
+
+    switch (instruction->type)
+    {
+    case SCRIPT_WAIT_TICKS:
+        if (elapsed < (uint32_t) instruction->value * SCRIPT_WAIT_TICK)
+            return false;
+        break;
+    case SCRIPT_WAIT_POSITION: // Value: Timeout in ticks, 0 = none
+        ActualCommand.Opcode  = TMCL_GAP;
+        ActualCommand.Type    = SCRIPT_AP_POSITION_REACHED;
+        handleGAP();
+
+        if (ActualReply.Status == REPLY_OK && ActualReply.Value.Int32 == 0)
+        {
+            if (instruction->value == 0 || elapsed < (uint32_t) instruction->value * SCRIPT_WAIT_TICK)
+                return false;
+
+            script.flags |= SCRIPT_FLAG_TIMEOUT;
+        }
+        break;
+    default:
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        break;
+    }
+
+    script.waiting = false;
+    return true;
+}
+
+// Execute the instruction at the program counter.
+// Returns false if the script has to wait for something or got stopped.
+static bool script_step(void)
+{
+    TMCLInstructionTypeDef *instruction = &script.program[script.pc];
+    uint32_t next = script.pc + 1;
+
+    ActualCommand.ModuleId     = SERIAL_MODULE_ADDRESS;
+    ActualCommand.Opcode       = instruction->opcode;
+    ActualCommand.Type         = instruction->type;
+    ActualCommand.Motor        = instruction->motor;
+    ActualCommand.Value.Int32  = instruction->value;
+    ActualCommand.Error        = TMCL_RX_ERROR_NONE;
+
+    ActualReply.ModuleId     = SERIAL_MODULE_ADDRESS;
+    ActualReply.Opcode       = instruction->opcode;
+    ActualReply.Status       = REPLY_OK;
+    ActualReply.Value.Int32  = instruction->value;
+    ActualReply.IsSpecial    = 0;
+
+    switch (instruction->opcode)
+    {
+    case TMCL_JA:
+        next = instruction->value;
+        break;
+    case TMCL_JC:
+        if (script_checkCondition(instruction->type))
+            next = instruction->value;
+        break;
+    case TMCL_COMP:
+        script.compare = (script.accu > instruction->value) - (script.accu < instruction->value);
+        break;
+    case TMCL_CALC:
+        script_calc(instruction->type, instruction->value);
+        break;
+    case TMCL_CALCX:
+        if (instruction->type == SCRIPT_CALC_SWAP)
+        {
+            int32_t tmp = script.accu;
+            script.accu = script.x;
+            script.x = tmp;
+        }
+        else if (instruction->type == SCRIPT_CALC_LOAD)
+        {
+            script.x = script.accu;
+        }
+        else
+        {
+            script_calc(instruction->type, script.x);
+        }
+        break;
+    case TMCL_CSUB:
+        if (script.stackDepth >= SCRIPT_STACK_SIZE)
+        {
+            ActualReply.Status = REPLY_MAX_EXCEEDED;
+            break;
+        }
+
+        script.stack[script.stackDepth++] = next;
+        next = instruction->value;
+        break;
+    case TMCL_RSUB:
+        if (script.stackDepth == 0)
+        {
+            ActualReply.Status = REPLY_INVALID_CMD;
+            break;
+        }
+
+        next = script.stack[--script.stackDepth];
+        break;
+    case TMCL_WAIT:
+        if (!script_wait(instruction))
+            return false;
+        break;
+    case TMCL_STOP:
+        script_stop(REPLY_OK);
+        return false;
+    case TMCL_RETI: // Return from an event vector
+        if (!events.inInterrupt)
+        {
+            ActualReply.Status = REPLY_INVALID_CMD;
+            break;
+        }
+
+        next               = events.savedPC;
+        script.compare     = events.savedCompare;
+        script.waiting     = events.savedWaiting;
+        script.waitStart   = events.savedWaitStart;
+        events.inInterrupt = false;
+        break;
+    case TMCL_CLE:
+        script.flags = 0;
+        break;
+    case TMCL_AAP: // Accumulator to axis parameter
+        ActualCommand.Opcode       = TMCL_SAP;
+        ActualCommand.Value.Int32  = script.accu;
+        handleSAP();
+        break;
+    case TMCL_AGP: // Accumulator to global parameter
+        ActualCommand.Opcode       = TMCL_SGP;
+        ActualCommand.Value.Int32  = script.accu;
+        SetGlobalParameter();
+        break;
+    case TMCL_ApplStop:
+    case TMCL_ApplRun:
+    case TMCL_ApplStep:
+    case TMCL_ApplReset:
+    case TMCL_DownloadStart:
+    case TMCL_DownloadEnd:
+        // Scripts can not control themselves
+        ActualReply.Status = REPLY_INVALID_CMD;
+        break;
+    default:
+    {
+        TMCLHandler handler = opcodeHandlers[instruction->opcode];
+        if (!handler)
+        {
+            ActualReply.Status = REPLY_INVALID_CMD;
+            break;
+        }
+
+        handler();
+
+        // Read commands load the accumulator
+        switch (instruction->opcode)
+        {
+        case TMCL_GAP:
+        case TMCL_GGP:
+        case TMCL_GIO:
+        case TMCL_readRegisterChannel_1:
+        case TMCL_readRegisterChannel_2:
+            script.accu = ActualReply.Value.Int32;
+            break;
+        }
+        break;
+    }
+    }
+
+    // Scripts have no host to send extra data to
+    extraDataSize = 0;
+
+    if (ActualReply.Status != REPLY_OK)
+    {
+        script_stop(ActualReply.Status);
+        return false;
+    }
+
+    if (next >= SCRIPT_SIZE)
+    {
+        script_stop(REPLY_INVALID_VALUE);
+        return false;
+    }
+
+    script.pc = next;
+    return true;
+}
+
+static void script_process(void)
+{
+    for (uint32_t i = 0; i < script.budget; i++)
+    {
+        if (script.state != TM_RUN && script.state != TM_STEP)
+            return;
+
+        if (!script_step())
+            return;
+
+        if (script.state == TM_STEP)
+        {
+            script.state = TM_IDLE;
+            return;
+        }
+    }
+}
+
+// Mark an event as pending. Safe to call from interrupts.
+void tmcl_fireEvent(TMCLEvent event)
+{
+    if (event >= TMCL_EVENT_COUNT)
+        return;
+
+    pendingEvents[event] = 1;
+}
+
+static void handleSetEvent(void)
+{
+    if (ActualCommand.Type >= TMCL_EVENT_COUNT)
+    {
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
+    }
+
+    uint8_t event = ActualCommand.Type;
+
+    if (ActualCommand.Value.UInt32 & EVENT_NOTIFY_HOST)
+    {
+        events.notify |= (1 << event);
+        events.notifyInterface[event] = currentInterface;
+    }
+    else
+    {
+        events.notify &= ~(1 << event);
+        events.notifyPending &= ~(1 << event);
+        if (event == TMCL_EVENT_STALL)
+            events.stallNotifyPending = 0;
+    }
+
+    if (event >= TMCL_EVENT_INPUT_0 && event <= TMCL_EVENT_INPUT_1)
+    {
+        uint32_t input = event - TMCL_EVENT_INPUT_0;
+        uint8_t type = (ActualCommand.Value.UInt32 >> EVENT_WATCH_TYPE_SHIFT) & 0xFF;
+
+        events.inputs[input].watched  = false;
+        if (events.inputs[input].pin)
+        {
+            HAL.IOs->config->setEdgeCallback(events.inputs[input].pin, NULL);
+            events.inputs[input].pin = NULL;
+        }
+
+        if ((ActualCommand.Value.UInt32 & EVENT_WATCH_INPUT) && (ActualCommand.Value.UInt32 & EVENT_WATCH_PIN))
+        {
+            ActualReply.Status = REPLY_INVALID_VALUE;
+            return;
+        }
+
+        if (ActualCommand.Value.UInt32 & EVENT_WATCH_PIN)
+        {
+            // Every edge of the pin fires the event right from the pin interrupt
+            if (type >= HAL.IOs->pins->pinCount)
+            {
+                ActualReply.Status = REPLY_INVALID_VALUE;
+                return;
+            }
+
+            IOPinTypeDef *pin = HAL.IOs->pins->pins[type];
+            for (uint32_t i = 0; i < EVENT_INPUT_COUNT; i++)
+            {
+                if (events.inputs[i].pin == pin)
+                {
+                    // Already watched by the other input event
+                    ActualReply.Status = REPLY_INVALID_VALUE;
+                    return;
+                }
+            }
+
+            events.inputs[input].pin = pin;
+            if (!HAL.IOs->config->setEdgeCallback(pin, events_onEdge))
+            {
+                events.inputs[input].pin = NULL;
+                ActualReply.Status = REPLY_INVALID_VALUE;
+            }
+            return;
+        }
+
+        events.inputs[input].type     = type;
+        events.inputs[input].motor    = ActualCommand.Motor;
+        events.inputs[input].known    = false;
+        events.inputs[input].watched  = (ActualCommand.Value.UInt32 & EVENT_WATCH_INPUT) != 0;
+    }
+    else if (ActualCommand.Value.UInt32 & (EVENT_WATCH_INPUT | EVENT_WATCH_PIN))
+    {
+        ActualReply.Status = REPLY_INVALID_VALUE;
+    }
+}
+
+// Fire the input event of a watched pin. Called from the pin interrupt.
+static void events_onEdge(IOPinTypeDef *pin)
+{
+    for (uint32_t i = 0; i < EVENT_INPUT_COUNT; i++)
+    {
+        if (events.inputs[i].pin == pin)
+            tmcl_fireEvent(TMCL_EVENT_INPUT_0 + i);
+    }
+}
+
+// Fire the stall event for a StepDir channel. Called from the StepDir interrupt.
+static void events_onStall(uint8_t channel)
+{
+    if (channel >= STEPDIR_CHANNELS)
+        return;
+
+    stalledChannels[channel] = 1;
+    tmcl_fireEvent(TMCL_EVENT_STALL);
+}
+
+// Returns the bitmask of the channels that stalled since the last call.
+// One flag per channel, so no stall gets lost to an interrupt between reading
+// and clearing.
+static uint32_t events_takeStalledChannels(void)
+{
+    uint32_t channels = 0;
+
+    for (uint32_t channel = 0; channel < STEPDIR_CHANNELS; channel++)
+    {
+        if (!stalledChannels[channel])
+            continue;
+
+        stalledChannels[channel] = 0;
+        channels |= (1u << channel);
+    }
+
+    return channels;
+}
+
+static void handleEI(void)
+{
+    if (ActualCommand.Type == EVENT_GLOBAL)
+        events.globalEnable = true;
+    else if (ActualCommand.Type < TMCL_EVENT_COUNT)
+        events.enabled |= (1 << ActualCommand.Type);
+    else
+        ActualReply.Status = REPLY_INVALID_TYPE;
+}
+
+static void handleDI(void)
+{
+    if (ActualCommand.Type == EVENT_GLOBAL)
+        events.globalEnable = false;
+    else if (ActualCommand.Type < TMCL_EVENT_COUNT)
+        events.enabled &= ~(1 << ActualCommand.Type);
+    else
+        ActualReply.Status = REPLY_INVALID_TYPE;
+}
+
+static void handleVECT(void)
+{
+    if (ActualCommand.Type >= TMCL_EVENT_COUNT)
+    {
+        ActualReply.Status = REPLY_INVALID_TYPE;
+        return;
+    }
+
+    if (ActualCommand.Value.UInt32 >= SCRIPT_SIZE)
+    {
+        ActualReply.Status = REPLY_INVALID_VALUE;
+        return;
+    }
+
+    events.vector[ActualCommand.Type] = ActualCommand.Value.UInt32;
+}
+
+// Fire the input events on every change of their watched GIO input
+static void events_pollInputs(void)
+{
+    for (uint32_t i = 0; i < EVENT_INPUT_COUNT; i++)
+    {
+        if (!events.inputs[i].watched)
+            continue;
+
+        ActualCommand.Opcode  = TMCL_GIO;
+        ActualCommand.Type    = events.inputs[i].type;
+        ActualCommand.Motor   = events.inputs[i].motor;
+        ActualReply.Status    = REPLY_OK;
+        GetInput();
+
+        if (ActualReply.Status != REPLY_OK)
+            continue;
+
+        bool state = ActualReply.Value.Int32 != 0;
+        if (!events.inputs[i].known)
+        {
+            // First reading after configuring the watch - nothing changed yet
+            events.inputs[i].known = true;
+            events.inputs[i].state = state;
+        }
+        else if (state != events.inputs[i].state)
+        {
+            events.inputs[i].state = state;
+            tmcl_fireEvent(TMCL_EVENT_INPUT_0 + i);
+        }
+    }
+}
+
+static void events_process(void)
+{
+    events_pollInputs();
+
+    for (uint32_t i = 0; i < TMCL_EVENT_COUNT; i++)
+    {
+        if (!pendingEvents[i])
+            continue;
+
+        pendingEvents[i] = 0;
+
+        uint32_t channels = 0;
+        if (i == TMCL_EVENT_STALL)
+        {
+            channels = events_takeStalledChannels();
+            // Channels stalling after the flag was cleared were taken along already
+            if (!channels)
+                continue;
+        }
+
+        if (events.notify & (1 << i))
+        {
+            events.notifyPending |= (1 << i);
+            events.stallNotifyPending |= channels;
+        }
+
+        if (events.vector[i] != EVENT_NO_VECTOR && (events.enabled & (1 << i)))
+            events.vectorPending |= (1 << i);
+    }
+
+    // Notifications stay pending until their interface has room for them.
+    // Interfaces without a free space report get one notification per pass.
+    uint32_t notifiedInterfaces = 0;
+    for (uint32_t i = 0; i < TMCL_EVENT_COUNT; i++)
+    {
+        uint32_t interface = events.notifyInterface[i];
+        while ((events.notifyPending & (1 << i)) && hasTxSpace(interface, TMCL_DATAGRAM_SIZE))
+        {
+            if (!reportsTxSpace(interface) && (notifiedInterfaces & (1 << interface)))
+                break;
+
+            uint32_t value = i;
+
+            if (i == TMCL_EVENT_STALL)
+            {   // One notification per stalled channel
+                uint32_t channel = __builtin_ctz(events.stallNotifyPending);
+                events.stallNotifyPending &= ~(1u << channel);
+                value |= channel << EVENT_ARGUMENT_SHIFT;
+            }
+
+            if (i != TMCL_EVENT_STALL || !events.stallNotifyPending)
+                events.notifyPending &= ~(1 << i);
+
+            ActualReply.ModuleId     = SERIAL_MODULE_ADDRESS;
+            ActualReply.Status       = REPLY_OK;
+            ActualReply.Opcode       = TMCL_SetEvent;
+            ActualReply.Value.UInt32 = value;
+            ActualReply.IsSpecial    = 0;
+            tx(&interfaces[interface]);
+
+            notifiedInterfaces |= (1 << interface);
+        }
+    }
+
+    // Vectors only interrupt a running script
+    if (script.state != TM_RUN)
+    {
+        events.vectorPending = 0;
+        return;
+    }
+
+    // Vectors do not nest - the remaining ones run after RETI
+    if (!events.globalEnable || events.inInterrupt || !events.vectorPending)
+        return;
+
+    uint32_t event = __builtin_ctz(events.vectorPending);
+    events.vectorPending &= ~(1 << event);
+
+    events.savedPC         = script.pc;
+    events.savedCompare    = script.compare;
+    events.savedWaiting    = script.waiting;
+    events.savedWaitStart  = script.waitStart;
+    events.inInterrupt     = true;
+
+    script.pc       = events.vector[event];
+    script.waiting  = false;
 }
 
 static void handleOTP(void)
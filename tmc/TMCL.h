@@ -89,13 +89,20 @@
 #define TMCL_BoardMeasuredSpeed      150
 #define TMCL_BoardError              151
 #define TMCL_BoardReset              152
+#define TMCL_readRegisterBlockChannel_1  153
+#define TMCL_readRegisterBlockChannel_2  154
+#define TMCL_RegisterList            155
+#define TMCL_writeRegisterListEntry  156
 #define TMCL_GetInfo                 157
+#define TMCL_Telemetry               158
+#define TMCL_Ticket                  159
 
 #define TMCL_WLAN                    160
 #define TMCL_WLAN_CMD                160
 #define TMCL_WLAN_IS_RTS             161
 #define TMCL_WLAN_CMDMODE_EN         162
 #define TMCL_WLAN_IS_CMDMODE         163
+#define TMCL_RamDebugStream          164 // Opcode of the RAMDebug streaming frames
 
 #define TMCL_MIN                     170
 #define TMCL_MAX                     171
@@ -176,8 +183,24 @@ typedef struct
     uint8_t IsSpecial;  // next transfer will not use the serial address and the checksum bytes - instead the whole datagram is filled with data (used to transmit ASCII version string)
 } TMCLReplyTypeDef;
 
+// Events, fired into the TMCL stack with tmcl_fireEvent().
+// See TMCL_SetEvent for host notifications and TMCL_EI/DI/VECT for script interrupts.
+typedef enum {
+    TMCL_EVENT_STALL,        // A StepDir channel stopped on a stall
+    TMCL_EVENT_BROWNOUT,     // Motor supply VM dropped below a board minimum
+    TMCL_EVENT_OVERVOLTAGE,  // Motor supply VM exceeded a board maximum
+    TMCL_EVENT_ERROR_CH1,    // New error bits on the motion controller board
+    TMCL_EVENT_ERROR_CH2,    // New error bits on the driver board
+    TMCL_EVENT_INPUT_0,      // Watched input 0 changed
+    TMCL_EVENT_INPUT_1,      // Watched input 1 changed
+
+    TMCL_EVENT_COUNT
+} TMCLEvent;
+
 void tmcl_init();
 void tmcl_process();
+void tmcl_resetRouting(void);
+void tmcl_fireEvent(TMCLEvent event);
 
 uint32_t tmcl_getExtraDataLimit();
 bool tmcl_appendData(uint8_t *data, uint32_t length);
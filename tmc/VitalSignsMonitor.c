@@ -11,6 +11,7 @@
 #include "hal/derivative.h"
 #include "boards/Board.h"
 #include "hal/HAL.h"
+#include "TMCL.h"
 
 #define VM_MIN_INTERFACE_BOARD  70   // minimum motor supply voltage for system in [100mV]
 #define VM_MAX_INTERFACE_BOARD  700  // maximum motor supply voltage for system in [100mV]
@@ -68,6 +69,8 @@ void checkVM()
 	int32_t VM;
 	static uint8_t stable = VSM_BROWNOUT_DELAY + 1; // delay value + 1 is the state during normal voltage levels - set here to prevent restore shortly after boot
 	static uint8_t vio_state = 1;
+	uint8_t previousBrownOut     = VitalSignsMonitor.brownOut;
+	uint8_t previousOverVoltage  = VitalSignsMonitor.overVoltage;
 
 	VM = *HAL.ADCs->VM;              // read ADC value for motor supply VM
 	VM = (VM*VM_FACTOR)/ADC_VM_RES;  // calculate voltage from ADC value
@@ -90,6 +93,11 @@ void checkVM()
 	if(Evalboards.ch1.VMMin && Evalboards.ch2.VMMin)
 		if(VM <	VM_MIN_INTERFACE_BOARD)  VitalSignsMonitor.brownOut  |= VSM_CHX;
 
+	if(VitalSignsMonitor.brownOut && !previousBrownOut)
+		tmcl_fireEvent(TMCL_EVENT_BROWNOUT);
+	if(VitalSignsMonitor.overVoltage && !previousOverVoltage)
+		tmcl_fireEvent(TMCL_EVENT_OVERVOLTAGE);
+
 	if((VitalSignsMonitor.errors & VSM_ERRORS_CH1) || (VitalSignsMonitor.errors & VSM_ERRORS_CH2)) // VIO low in CH1
 	{
 		if((Evalboards.ch1.errors & VSM_ERRORS_VIO_LOW) || (Evalboards.ch2.errors & VSM_ERRORS_VIO_LOW))
@@ -131,6 +139,8 @@ void vitalsignsmonitor_checkVitalSigns()
 {
 	int32_t errors = 0;
 	static uint32_t lastTick = 0;
+	static uint32_t lastErrorsCh1 = 0;
+	static uint32_t lastErrorsCh2 = 0;
 	uint32_t tick;
 
 	tick = systick_getTick();
@@ -146,6 +156,14 @@ void vitalsignsmonitor_checkVitalSigns()
 	Evalboards.ch2.checkErrors(tick);
 	Evalboards.ch1.checkErrors(tick);
 
+	// Fire events for newly set error bits
+	if(Evalboards.ch1.errors & ~lastErrorsCh1)
+		tmcl_fireEvent(TMCL_EVENT_ERROR_CH1);
+	if(Evalboards.ch2.errors & ~lastErrorsCh2)
+		tmcl_fireEvent(TMCL_EVENT_ERROR_CH2);
+	lastErrorsCh1 = Evalboards.ch1.errors;
+	lastErrorsCh2 = Evalboards.ch2.errors;
+
 	// Status LED
 	heartBeat(tick);
 